@@ -0,0 +1,49 @@
+/**
+ * @file console.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Scrolling text console for gui module
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+
+#include "gui/color.h"
+#include "gui/font.h"
+
+#ifndef CONSOLE_LINE_COUNT
+ #define CONSOLE_LINE_COUNT 16
+#endif
+#define CONSOLE_LINE_SIZE 48
+
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    const Font *font;
+    Color fgColor;
+    Color bgColor;
+
+    // ring of screen lines, long texts are wrapped at the console width
+    char lines[CONSOLE_LINE_COUNT][CONSOLE_LINE_SIZE];
+    uint8_t first;      // oldest line
+    uint8_t count;      // stored lines
+    uint8_t rows;       // visible rows
+    uint8_t shown;      // rows drawn on screen
+    uint8_t origin;     // screen row of the oldest visible line, moves if the
+                        // controller cannot scroll
+    uint16_t lineWidth; // pixel width of the last line
+} Console;
+
+// colors are the current pen (text) and brush (background) colors
+void console_init(Console *console, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const Font *font);
+void console_clear(Console *console);
+void console_write(Console *console, const char *txt);
+void console_redraw(Console *console);
+
+#endif // CONSOLE_H
@@ -20,6 +20,72 @@
   #define __space_prog__
 #endif
 
+/**
+ * @brief Picture data encoding
+ * Pixels are always stored column by column (x major, y minor), in the
+ * order screen controllers expect them in a window.
+ */
+typedef enum
+{
+    PictureFormatRaw565 = 0,  ///< one uint16_t RGB565 word per pixel
+    PictureFormatRle565,      ///< run length encoded RGB565 words
+    PictureFormatQoi565,      ///< QOI like byte stream of RGB565 pixels
+    PictureFormatIndexed1,    ///< 1 bit palette index per pixel
+    PictureFormatIndexed2,    ///< 2 bits palette index per pixel
+    PictureFormatIndexed4,    ///< 4 bits palette index per pixel
+    PictureFormatIndexed8     ///< 8 bits palette index per pixel
+} PictureFormat;
+
+/**
+ * PictureFormatIndexed* bytes stream, pixels indexes are packed in bytes
+ * without padding between columns, the first pixel in the least significant
+ * bits. Colors are given by the palette table of the Picture, which holds
+ * 1 << bpp entries.
+ */
+#define PICTURE_INDEXED_BPP(format) (1 << ((format) - PictureFormatIndexed1))
+
+/**
+ * PictureFormatRle565 stream, one control word followed by data words :
+ *  - bit 15 set : run, next word is repeated (control & 0x7FFF) + 1 times
+ *  - bit 15 clear : literal, (control & 0x7FFF) + 1 raw words follow
+ */
+#define PICTURE_RLE_RUN       0x8000
+#define PICTURE_RLE_COUNTMASK 0x7FFF
+
+/**
+ * PictureFormatQoi565 byte stream, decoder state is the previous pixel and a
+ * 64 entries table of recently seen colors indexed by PICTURE_QOI_HASH :
+ *  - 00iiiiii         : index, color of table entry i
+ *  - 01rrggbb         : diff, r/g/b 565 components delta of -2..1 (+2 bias)
+ *  - 10gggggg rrrrbbbb: luma, g delta of -32..31, r-dg and b-dg of -8..7
+ *  - 11nnnnnn         : run, previous pixel repeated n + 1 times (n < 62)
+ *  - 11111110 hi lo   : full RGB565 color, big endian
+ */
+#define PICTURE_QOI_OP_INDEX  0x00
+#define PICTURE_QOI_OP_DIFF   0x40
+#define PICTURE_QOI_OP_LUMA   0x80
+#define PICTURE_QOI_OP_RUN    0xC0
+#define PICTURE_QOI_OP_565    0xFE
+#define PICTURE_QOI_MASK      0xC0
+#define PICTURE_QOI_HASH(c)   ((((c) >> 11) * 3 + (((c) >> 5) & 0x3F) * 5 + ((c) & 0x1F) * 7) & 0x3F)
+
+/**
+ * @brief Picture transparency, transparent pixels are skipped when the
+ * picture is displayed and the background stays visible
+ */
+typedef enum
+{
+    PictureTransparencyNone = 0,  ///< opaque picture
+    PictureTransparencyKey,       ///< pixels of the key color are transparent
+    PictureTransparencyMask       ///< 1 bit per pixel mask, bit clear is transparent
+} PictureTransparency;
+
+/**
+ * PictureTransparencyMask bytes, one bit per pixel in the pixels order, the
+ * first pixel in the least significant bit, without padding between columns
+ */
+#define PICTURE_MASK_OPAQUE(mask, index) (((mask)[(index) >> 3] >> ((index) & 0x07)) & 0x01)
+
 /**
  * @brief Picture struct
  * contains data and metadata (width, height...)
@@ -33,6 +99,17 @@ typedef struct
     //data
     __prog__ const uint16_t *data;
 
+    // encoding of data (PictureFormat), raw if omitted
+    uint8_t format;
+
+    // RGB565 colors table of indexed formats
+    __prog__ const uint16_t *palette;
+
+    // transparency mode (PictureTransparency), opaque if omitted
+    uint8_t transparency;
+    uint16_t key;
+    __prog__ const uint8_t *mask;
+
 } Picture;
 
 #endif // PICTURE_H
@@ -0,0 +1,54 @@
+/**
+ * @file sim.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Simulator only functions of the gui module, screen dump, controller
+ * accesses statistics and trace
+ */
+
+#ifndef GUI_SIMULATOR_H
+#define GUI_SIMULATOR_H
+
+#include <stdint.h>
+
+// dumps the screen content to a PPM image
+int gui_sim_saveImage(const char *fileName);
+// compares the screen content to a PPM image written by gui_sim_saveImage,
+// returns the count of different pixels, -1 if the image cannot be read
+int gui_sim_compareImage(const char *fileName);
+
+// controller accesses counted since the last reset. Bytes are the bus traffic
+// of a 16 bits parallel controller (d51e5ta7601) : 2 bytes per command or
+// data word.
+typedef struct
+{
+    uint32_t setRect;   // window commands
+    uint32_t setPos;    // cursor commands
+    uint32_t writes;    // write_data, write_burst and write_repeat calls
+    uint32_t reads;     // readRect calls
+    uint32_t scrolls;   // scrollRect calls
+    uint32_t pixels;    // pixels written
+    uint32_t bytes;     // bus bytes
+} GuiSimStats;
+void gui_sim_resetStats(void);
+const GuiSimStats *gui_sim_stats(void);
+
+// headless, nothing is sent to the simulator, the screen is only mirrored and
+// counted, timings then measure the gui module alone
+void gui_sim_setHeadless(uint8_t headless);
+
+// controller features. GuiSimMirror scrolls and reads back the local copy of
+// the screen, GuiSimD51e5ta7601 has neither, as the d51e5ta7601, to run and
+// measure the fallback paths of console and sprites
+typedef enum
+{
+    GuiSimMirror = 0,
+    GuiSimD51e5ta7601
+} GuiSimModel;
+void gui_sim_setModel(GuiSimModel model);
+
+// appends every controller call as a text line to fileName, NULL to stop
+int gui_sim_record(const char *fileName);
+
+#endif // GUI_SIMULATOR_H
@@ -0,0 +1,46 @@
+/**
+ * @file sprite.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Moving pictures with background restore for gui module
+ */
+
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <stdint.h>
+
+#include "gui/color.h"
+#include "gui/picture.h"
+
+typedef struct
+{
+    const Picture *picture;     // usually a transparent picture
+    uint16_t x;
+    uint16_t y;
+    uint8_t shown;
+
+    // save-under buffer of width * height pixels of the largest picture, NULL
+    // if not used or if the controller cannot read back its memory
+    uint16_t *saveUnder;
+    uint8_t saved;              // saveUnder holds the pixels under the sprite
+
+    // background restored without save-under, picture or plain color
+    const Picture *background;
+    uint16_t bgX;
+    uint16_t bgY;
+    Color bgColor;
+} Sprite;
+
+// background color is the current brush color
+void sprite_init(Sprite *sprite, const Picture *picture, uint16_t *saveUnder);
+void sprite_setBackground(Sprite *sprite, const Picture *background, uint16_t x, uint16_t y);
+void sprite_setBackgroundColor(Sprite *sprite, Color color);
+void sprite_setPicture(Sprite *sprite, const Picture *picture);
+
+// overlapping sprites have to be hidden in the reverse order of showing
+void sprite_show(Sprite *sprite, uint16_t x, uint16_t y);
+void sprite_hide(Sprite *sprite);
+
+#endif // SPRITE_H
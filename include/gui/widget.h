@@ -11,24 +11,80 @@
 #ifndef WIDGET_H
 #define WIDGET_H
 
+#include <stdint.h>
+
+#include "gui/color.h"
+#include "gui/picture.h"
+
 // widget type enum
 #define WIDGET_TYPE_BUTTON   0x01
 #define WIDGET_TYPE_LABEL    0x02
 #define WIDGET_TYPE_IMAGE    0x03
 #define WIDGET_TYPE_SLIDER   0x04
+#define WIDGET_TYPE_BARGRAPH 0x05
+#define WIDGET_TYPE_PANEL    0x06
+
+// widget flags
+#define WIDGET_FLAG_DIRTY    0x01   // needs to be redrawn on next widget_update
+#define WIDGET_FLAG_HIDDEN   0x02   // not drawn, with its children
+#define WIDGET_FLAG_PRESSED  0x04   // button pressed state
+#define WIDGET_FLAG_VERTICAL 0x08   // slider and bar graph orientation, min at bottom
+#define WIDGET_FLAG_BORDER   0x10   // panel and bar graph frame with foreground color
+
+#ifndef WIDGET_COUNT
+ #define WIDGET_COUNT 32
+#endif
+#define WIDGET_TEXT_SIZE 20
 
 typedef struct widget_t
 {
 	uint8_t type;
-	uint16_t x;
+	uint8_t flags;
+	uint16_t x;     // screen coordinates
 	uint16_t y;
 	uint16_t w;
 	uint16_t h;
+	struct widget_t *parent;
+	Color fgColor;
+	Color bgColor;
+	char text[WIDGET_TEXT_SIZE];
+	uint8_t textAlign;
+	const Picture *picture;
+	int16_t value;
+	int16_t min;
+	int16_t max;
 	void *data;
 	void (*action_callback)(struct widget_t *widget);
 } Widget;
 
 void widget_init();
-void widget_addButton(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+void widget_setBackground(Color color);
+
+// widgets creation, (x, y) relative to the parent, NULL parent for screen
+// colors are the current pen (foreground) and brush (background) colors
+// return NULL if the pool of WIDGET_COUNT widgets is full
+Widget *widget_addPanel(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+Widget *widget_addLabel(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text);
+Widget *widget_addButton(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text);
+Widget *widget_addImage(Widget *parent, uint16_t x, uint16_t y, const Picture *picture);
+Widget *widget_addSlider(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t min, int16_t max);
+Widget *widget_addBarGraph(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t min, int16_t max);
+
+// state, widgets are invalidated only if the state changes
+void widget_setText(Widget *widget, const char *text);
+void widget_setTextAlign(Widget *widget, uint8_t flags);
+void widget_setValue(Widget *widget, int16_t value);
+void widget_setPicture(Widget *widget, const Picture *picture);
+void widget_setColors(Widget *widget, Color fgColor, Color bgColor);
+void widget_setFlag(Widget *widget, uint8_t flag, uint8_t enable);
+void widget_setVisible(Widget *widget, uint8_t visible);
+void widget_setCallback(Widget *widget, void (*action_callback)(Widget *widget));
+
+// redraw
+void widget_invalidate(Widget *widget);
+uint8_t widget_update();
+
+// input
+Widget *widget_click(uint16_t x, uint16_t y);
 
 #endif // WIDGET_H
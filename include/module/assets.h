@@ -0,0 +1 @@
+#include "../../support/module/assets/assets.h"
@@ -48,6 +48,18 @@ int uart_transmitFinished(rt_dev_t device);
 ssize_t uart_read(rt_dev_t device, char *data, size_t size_max);
 ssize_t uart_datardy(rt_dev_t device);
 
+// ========== simulator ==========
+#ifdef SIMULATOR
+// device emulated by the simulator program on a uart, its data does not go
+// to udk-sim
+typedef struct
+{
+    ssize_t (*write)(const char *data, size_t size);
+    ssize_t (*read)(char *data, size_t size_max);
+} UART_SIM_DEVICE;
+int uart_sim_attach(rt_dev_t device, const UART_SIM_DEVICE *emulated);
+#endif
+
 // ======= specific include =======
 #if defined(ARCHI_pic24ep) || defined(ARCHI_pic24f) || defined(ARCHI_pic24fj) \
  || defined(ARCHI_pic24hj) || defined(ARCHI_dspic33fj) || defined(ARCHI_dspic33ep) \
@@ -41,6 +41,8 @@ uart_dev uarts[] = {
 #endif
 };
 
+const UART_SIM_DEVICE *uart_sim_devices[UART_COUNT];
+
 void uart_sendconfig(uint8_t uart)
 {
     simulator_send(UART_SIM_MODULE, uart, UART_SIM_CONFIG, (char*)&uarts[uart], sizeof(uart_dev));
@@ -200,6 +202,8 @@ ssize_t uart_write(rt_dev_t device, const char *data, size_t size)
     uint8_t uart = MINOR(device);
     if (uart >= UART_COUNT)
         return -1;
+    if (uart_sim_devices[uart] != NULL)
+        return (*uart_sim_devices[uart]->write)(data, size);
 
     simulator_send(UART_SIM_MODULE, uart, UART_SIM_WRITE, data, size);
 
@@ -212,6 +216,8 @@ ssize_t uart_read(rt_dev_t device, char *data, size_t size_max)
     uint8_t uart = MINOR(device);
     if (uart >= UART_COUNT)
         return -1;
+    if (uart_sim_devices[uart] != NULL)
+        return (*uart_sim_devices[uart]->read)(data, size_max);
 
     // TODO
     simulator_rec_task();
@@ -221,3 +227,19 @@ ssize_t uart_read(rt_dev_t device, char *data, size_t size_max)
 
     return size_read;
 }
+
+/**
+ * @brief uart_sim_attach connects a uart to a device emulated by the program
+ * instead of udk-sim, as the ESP8266 AT firmware emulator
+ * @param emulated device, NULL to go back to udk-sim
+ * @return 0 if success, -1 if the uart does not exist
+ */
+int uart_sim_attach(rt_dev_t device, const UART_SIM_DEVICE *emulated)
+{
+    uint8_t uart = MINOR(device);
+    if (uart >= UART_COUNT)
+        return -1;
+
+    uart_sim_devices[uart] = emulated;
+    return 0;
+}
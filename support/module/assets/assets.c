@@ -0,0 +1,223 @@
+/**
+ * @file assets.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Binary asset packs index and stream reader, storage independent
+ */
+
+#include "assets.h"
+
+#include <string.h>
+
+static uint16_t assets_packCount = 0;
+static uint32_t assets_packSize = 0;
+
+// internal functions
+static uint16_t assets_le16(const uint8_t *data);
+static uint32_t assets_le32(const uint8_t *data);
+static int assets_readEntry(uint16_t id, Asset *asset, char *name);
+
+static uint16_t assets_le16(const uint8_t *data)
+{
+    return (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+}
+
+static uint32_t assets_le32(const uint8_t *data)
+{
+    return (uint32_t)assets_le16(data) | ((uint32_t)assets_le16(data + 2) << 16);
+}
+
+/**
+ * @brief assets_init reads and checks the pack header, called by the
+ * storage backends once the storage is opened
+ * @return 0 if success, -1 if no valid pack is found
+ */
+int assets_init(void)
+{
+    uint8_t header[sizeof(AssetsHeader)];
+
+    assets_packCount = 0;
+    assets_packSize = 0;
+    if (assets_storageRead(0, header, sizeof(header)) < 0)
+        return -1;
+
+    if (assets_le32(header) != ASSETS_MAGIC
+     || assets_le16(header + 4) != ASSETS_VERSION
+     || assets_le16(header + 14) != sizeof(AssetsEntry))
+        return -1;
+
+    assets_packCount = assets_le16(header + 6);
+    assets_packSize = assets_le32(header + 8);
+    return 0;
+}
+
+/**
+ * @brief assets_count number of assets in the opened pack
+ */
+uint16_t assets_count(void)
+{
+    return assets_packCount;
+}
+
+static int assets_readEntry(uint16_t id, Asset *asset, char *name)
+{
+    uint8_t entry[sizeof(AssetsEntry)];
+    uint32_t address = sizeof(AssetsHeader) + (uint32_t)id * sizeof(AssetsEntry);
+
+    if (assets_storageRead(address, entry, sizeof(entry)) < 0)
+        return -1;
+
+    if (name != NULL)
+    {
+        memcpy(name, entry, ASSETS_NAME_SIZE);
+        name[ASSETS_NAME_SIZE - 1] = '\0';
+    }
+    if (asset != NULL)
+    {
+        asset->metaSize = assets_le16(entry + ASSETS_NAME_SIZE + 10);
+        asset->offset = assets_le32(entry + ASSETS_NAME_SIZE) + asset->metaSize;
+        asset->size = assets_le32(entry + ASSETS_NAME_SIZE + 4);
+        asset->type = assets_le16(entry + ASSETS_NAME_SIZE + 8);
+        asset->flags = assets_le16(entry + ASSETS_NAME_SIZE + 12);
+        asset->pos = 0;
+        if (asset->offset + asset->size > assets_packSize)
+            return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief assets_find binary search of an asset by name in the pack index,
+ * one storage read per step
+ * @param asset opened asset if found
+ * @param name asset name, as given to the pack tools
+ * @return asset id, -1 if not found
+ */
+int assets_find(Asset *asset, const char *name)
+{
+    char entryName[ASSETS_NAME_SIZE];
+    uint16_t min = 0, max = assets_packCount;
+
+    while (min < max)
+    {
+        uint16_t mid = min + (max - min) / 2;
+        int cmp;
+
+        if (assets_readEntry(mid, NULL, entryName) < 0)
+            return -1;
+
+        cmp = strcmp(name, entryName);
+        if (cmp == 0)
+        {
+            if (asset != NULL && assets_readEntry(mid, asset, NULL) < 0)
+                return -1;
+            return mid;
+        }
+        if (cmp < 0)
+            max = mid;
+        else
+            min = mid + 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief assets_get opens an asset by its index, to list the pack
+ * @param asset opened asset, can be NULL
+ * @param id asset id, from 0 to assets_count() - 1
+ * @param name ASSETS_NAME_SIZE bytes buffer for the name, can be NULL
+ * @return 0 if success, -1 in case of error
+ */
+int assets_get(Asset *asset, uint16_t id, char *name)
+{
+    if (id >= assets_packCount)
+        return -1;
+    return assets_readEntry(id, asset, name);
+}
+
+/**
+ * @brief assets_readMeta reads the metadata of an asset
+ * @return size of read metadata, -1 in case of error
+ */
+ssize_t assets_readMeta(const Asset *asset, void *meta, size_t size)
+{
+    if (size > asset->metaSize)
+        size = asset->metaSize;
+    if (assets_storageRead(asset->offset - asset->metaSize, meta, size) < 0)
+        return -1;
+    return size;
+}
+
+/**
+ * @brief assets_read reads the payload of an asset from its current position
+ * @return size of read data, 0 at the end of the asset, -1 in case of error
+ */
+ssize_t assets_read(Asset *asset, void *data, size_t size)
+{
+    if (asset->pos >= asset->size)
+        return 0;
+    if (size > asset->size - asset->pos)
+        size = asset->size - asset->pos;
+    if (assets_storageRead(asset->offset + asset->pos, data, size) < 0)
+        return -1;
+    asset->pos += size;
+    return size;
+}
+
+/**
+ * @brief assets_seek sets the read position of an asset
+ * @return 0 if success, -1 if the position is after the end
+ */
+int assets_seek(Asset *asset, uint32_t pos)
+{
+    if (pos > asset->size)
+        return -1;
+    asset->pos = pos;
+    return 0;
+}
+
+/**
+ * @brief assets_map direct pointer to the payload of an asset
+ * @return NULL if the storage is not memory mapped
+ */
+const void *assets_map(const Asset *asset)
+{
+    return assets_storageMap(asset->offset);
+}
+
+/**
+ * @brief assets_picture fills a Picture from a ASSETS_TYPE_PICTURE asset, to
+ * display it with gui_dispImage. Needs a memory mapped storage, pictures
+ * on SPI flash are read with assets_read
+ * @return 0 if success, -1 in case of error
+ */
+int assets_picture(const Asset *asset, Picture *picture)
+{
+    uint8_t meta[sizeof(AssetsPicture)];
+    const uint8_t *data;
+    uint32_t paletteOffset, maskOffset;
+
+    if (asset->type != ASSETS_TYPE_PICTURE || asset->metaSize < sizeof(meta))
+        return -1;
+    data = (const uint8_t *)assets_map(asset);
+    if (data == NULL)
+        return -1;
+    if (assets_readMeta(asset, meta, sizeof(meta)) < 0)
+        return -1;
+
+    paletteOffset = assets_le32(meta + 8);
+    maskOffset = assets_le32(meta + 12);
+    if (paletteOffset >= asset->size || maskOffset >= asset->size)
+        return -1;
+
+    picture->width = assets_le16(meta);
+    picture->height = assets_le16(meta + 2);
+    picture->format = meta[4];
+    picture->transparency = meta[5];
+    picture->key = assets_le16(meta + 6);
+    picture->data = (const uint16_t *)data;
+    picture->palette = paletteOffset ? (const uint16_t *)(data + paletteOffset) : NULL;
+    picture->mask = maskOffset ? data + maskOffset : NULL;
+    return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @file assets.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Binary asset packs stored out of the program flash
+ *
+ * Packs are written by img2raw and htmlGen (--pack option). Firmwares read
+ * them from an external SPI NOR flash, the simulator maps them from a file.
+ */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include <driver/device.h>
+
+#include "gui/picture.h"
+
+/**
+ * Pack layout, all fields little endian :
+ *  - AssetsHeader
+ *  - count AssetsEntry, sorted by name in strcmp order
+ *  - blobs aligned on header.align bytes, each blob is metaSize bytes of
+ *    metadata followed by size bytes of payload
+ */
+#define ASSETS_MAGIC      0x414B4455UL  // "UDKA"
+#define ASSETS_VERSION    1
+#define ASSETS_NAME_SIZE  32
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t size;          // whole pack size
+    uint16_t align;
+    uint16_t entrySize;     // sizeof(AssetsEntry)
+} AssetsHeader;
+
+typedef struct
+{
+    char name[ASSETS_NAME_SIZE];    // NUL padded
+    uint32_t offset;        // blob offset from the pack start
+    uint32_t size;          // payload size
+    uint16_t type;
+    uint16_t metaSize;
+    uint16_t flags;
+    uint16_t reserved;
+} AssetsEntry;
+
+// asset types
+#define ASSETS_TYPE_RAW     0x0000  // no metadata
+#define ASSETS_TYPE_PICTURE 0x0001  // AssetsPicture metadata
+#define ASSETS_TYPE_FILE    0x0002  // web file, metadata is the NUL terminated mime type
+
+/**
+ * @brief AssetsPicture metadata of ASSETS_TYPE_PICTURE, payload is the Picture
+ * data, then the palette and the mask at their offsets
+ */
+typedef struct
+{
+    uint16_t width;
+    uint16_t height;
+    uint8_t format;         // PictureFormat
+    uint8_t transparency;   // PictureTransparency
+    uint16_t key;
+    uint32_t paletteOffset; // from the payload start, 0 if none
+    uint32_t maskOffset;    // from the payload start, 0 if none
+} AssetsPicture;
+
+/**
+ * @brief Asset opened asset, read as a stream
+ */
+typedef struct
+{
+    uint32_t offset;        // payload address in the pack
+    uint32_t size;
+    uint32_t pos;           // read position in the payload
+    uint16_t type;
+    uint16_t metaSize;
+    uint16_t flags;
+} Asset;
+
+// storage, pack location
+#ifdef SIMULATOR
+int assets_openFile(const char *fileName);
+#else
+int assets_openSpiFlash(rt_dev_t spi, rt_dev_t cs, uint32_t address);
+#endif
+void assets_close(void);
+
+// index
+uint16_t assets_count(void);
+int assets_find(Asset *asset, const char *name);
+int assets_get(Asset *asset, uint16_t id, char *name);
+
+// content
+ssize_t assets_readMeta(const Asset *asset, void *meta, size_t size);
+ssize_t assets_read(Asset *asset, void *data, size_t size);
+int assets_seek(Asset *asset, uint32_t pos);
+const void *assets_map(const Asset *asset);
+int assets_picture(const Asset *asset, Picture *picture);
+
+// storage backends, assets_spiflash.c on targets, assets_sim.c on simulator
+int assets_init(void);
+int assets_storageRead(uint32_t address, void *data, size_t size);
+const void *assets_storageMap(uint32_t address);
+
+#endif // ASSETS_H
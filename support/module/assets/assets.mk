@@ -0,0 +1,15 @@
+ifndef ASSETS_MODULE
+ASSETS_MODULE=
+
+vpath %.c $(MODULEPATH)
+vpath %.h $(MODULEPATH)
+
+HEADER += assets.h
+SRC += assets.c
+SIM_SRC += assets_sim.c
+
+# external SPI NOR flash storage on targets
+DRIVERS += spi gpio
+ARCHI_SRC += assets_spiflash.c
+
+endif
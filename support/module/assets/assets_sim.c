@@ -0,0 +1,76 @@
+/**
+ * @file assets_sim.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Asset pack storage for simulator, the pack file is memory mapped
+ */
+
+#include "assets.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const uint8_t *assets_sim_data = NULL;
+static size_t assets_sim_size = 0;
+
+/**
+ * @brief assets_openFile maps a pack file built by img2raw or htmlGen
+ * @return 0 if success, -1 in case of error
+ */
+int assets_openFile(const char *fileName)
+{
+    struct stat st;
+    void *data;
+    int fd;
+
+    assets_close();
+
+    fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+        close(fd);
+        return -1;
+    }
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return -1;
+
+    assets_sim_data = (const uint8_t *)data;
+    assets_sim_size = st.st_size;
+    if (assets_init() < 0)
+    {
+        assets_close();
+        return -1;
+    }
+    return 0;
+}
+
+void assets_close(void)
+{
+    if (assets_sim_data != NULL)
+        munmap((void *)assets_sim_data, assets_sim_size);
+    assets_sim_data = NULL;
+    assets_sim_size = 0;
+}
+
+int assets_storageRead(uint32_t address, void *data, size_t size)
+{
+    if (assets_sim_data == NULL || address > assets_sim_size || size > assets_sim_size - address)
+        return -1;
+    memcpy(data, assets_sim_data + address, size);
+    return 0;
+}
+
+const void *assets_storageMap(uint32_t address)
+{
+    if (assets_sim_data == NULL || address > assets_sim_size)
+        return NULL;
+    return assets_sim_data + address;
+}
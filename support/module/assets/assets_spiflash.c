@@ -0,0 +1,96 @@
+/**
+ * @file assets_spiflash.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Asset pack storage on an external SPI NOR flash (25 series)
+ */
+
+#include "assets.h"
+
+#include <driver/spi.h>
+#include <driver/gpio.h>
+
+#define ASSETS_SPIFLASH_READ 0x03   // read data, 24 bits address
+#define ASSETS_SPIFLASH_SPIN 1000   // max polls of the spi receive fifo per byte
+
+static rt_dev_t assets_spiflash_spi = NULLDEV;
+static rt_dev_t assets_spiflash_cs = NULLDEV;
+static uint32_t assets_spiflash_address = 0;
+
+/**
+ * @brief assets_openSpiFlash sets the flash where the pack is written
+ * @param spi opened and enabled spi device, 8 bits
+ * @param cs chip select gpio, active low
+ * @param address pack address in the flash
+ * @return 0 if success, -1 if no valid pack is found
+ */
+int assets_openSpiFlash(rt_dev_t spi, rt_dev_t cs, uint32_t address)
+{
+    assets_spiflash_spi = spi;
+    assets_spiflash_cs = cs;
+    assets_spiflash_address = address;
+    gpio_setBitConfig(cs, GPIO_OUTPUT);
+    gpio_setBit(cs);
+
+    if (assets_init() < 0)
+    {
+        assets_close();
+        return -1;
+    }
+    return 0;
+}
+
+void assets_close(void)
+{
+    assets_spiflash_spi = NULLDEV;
+    assets_spiflash_cs = NULLDEV;
+}
+
+int assets_storageRead(uint32_t address, void *data, size_t size)
+{
+    char cmd[4], echo;
+    char *ptr = (char *)data;
+    size_t i;
+    uint16_t spin;
+
+    if (assets_spiflash_spi == NULLDEV)
+        return -1;
+
+    address += assets_spiflash_address;
+    cmd[0] = ASSETS_SPIFLASH_READ;
+    cmd[1] = (address >> 16) & 0xFF;
+    cmd[2] = (address >> 8) & 0xFF;
+    cmd[3] = address & 0xFF;
+
+    gpio_clearBit(assets_spiflash_cs);
+    for (i = 0; i < 4; i++)
+        spi_write(assets_spiflash_spi, cmd + i, 1);
+    spi_flush(assets_spiflash_spi);
+    while (spi_read(assets_spiflash_spi, &echo, 1) > 0); // drop command echo
+
+    // one dummy byte clocked out per data byte
+    for (i = 0; i < size; i++)
+    {
+        spi_write(assets_spiflash_spi, "\xFF", 1);
+        spi_flush(assets_spiflash_spi);
+        for (spin = 0; spin < ASSETS_SPIFLASH_SPIN; spin++)
+        {
+            if (spi_read(assets_spiflash_spi, ptr + i, 1) == 1)
+                break;
+        }
+        if (spin == ASSETS_SPIFLASH_SPIN)
+        {
+            gpio_setBit(assets_spiflash_cs);
+            return -1;
+        }
+    }
+    gpio_setBit(assets_spiflash_cs);
+    return 0;
+}
+
+const void *assets_storageMap(uint32_t address)
+{
+    (void)address;
+    return NULL;    // SPI flash is not memory mapped
+}
@@ -0,0 +1,174 @@
+/**
+ * @file console.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Scrolling text console for gui module
+ *
+ * Text is stored as screen lines in a ring buffer. Appending text only draws
+ * the lines it changes, when the console is full the content is scrolled by
+ * the screen controller and only the new bottom line is drawn. Controllers
+ * without scroll (d51e5ta7601) roll the rows instead: the new line is drawn
+ * over the oldest one and the visible origin of the ring moves one row down.
+ */
+
+#include <module/gui.h>
+#include <gui/console.h>
+
+#include <string.h>
+
+// internal functions
+char *console_lastLine(Console *console);
+void console_newLine(Console *console);
+void console_drawLine(Console *console, uint8_t row);
+
+void console_init(Console *console, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const Font *font)
+{
+    console->x = x;
+    console->y = y;
+    console->w = w;
+    console->h = h;
+    console->font = font;
+    console->fgColor = gui_penColor();
+    console->bgColor = gui_brushColor();
+
+    console->rows = (font->height > 0) ? h / font->height : 0;
+    if (console->rows > CONSOLE_LINE_COUNT)
+        console->rows = CONSOLE_LINE_COUNT;
+
+    console_clear(console);
+}
+
+void console_clear(Console *console)
+{
+    Color brushColor = gui_brushColor();
+
+    console->first = 0;
+    console->count = 1;
+    console->shown = 0;
+    console->origin = 0;
+    console->lineWidth = 0;
+    console->lines[0][0] = '\0';
+
+    gui_setBrushColor(console->bgColor);
+    gui_drawFillRect(console->x, console->y, console->w, console->h);
+    gui_setBrushColor(brushColor);
+}
+
+char *console_lastLine(Console *console)
+{
+    return console->lines[(console->first + console->count - 1) % CONSOLE_LINE_COUNT];
+}
+
+/**
+ * @brief console_newLine
+ * starts a new line, scrolls the screen if the last row is used, or rolls
+ * the rows if the controller cannot scroll
+ */
+void console_newLine(Console *console)
+{
+    uint8_t height = console->font->height;
+
+    if (console->count < CONSOLE_LINE_COUNT)
+        console->count++;
+    else
+        console->first = (console->first + 1) % CONSOLE_LINE_COUNT;
+    console_lastLine(console)[0] = '\0';
+    console->lineWidth = 0;
+
+    if (console->shown < console->rows)
+        return;
+
+    // scroll one row, the new line is drawn on the last row
+    console->shown = console->rows - 1;
+    if (console->origin == 0 && gui_scrollRect(console->x, console->y, console->w, console->rows * height, height))
+        return;
+
+    // no scroll, the new line takes the screen row of the oldest one
+    console->origin = (console->origin + 1) % console->rows;
+}
+
+/**
+ * @brief console_drawLine
+ * draws the row-th visible line at its screen row, the text rect clears the
+ * end of the row
+ */
+void console_drawLine(Console *console, uint8_t row)
+{
+    uint8_t index, visible, screenRow;
+
+    visible = (console->count < console->rows) ? console->count : console->rows;
+    if (row >= visible)
+        return;
+    index = (console->first + console->count - visible + row) % CONSOLE_LINE_COUNT;
+    screenRow = (console->origin + row) % console->rows;
+    gui_drawTextRect(console->x, console->y + screenRow * console->font->height, console->w, console->font->height,
+                     console->lines[index], GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
+}
+
+/**
+ * @brief console_write
+ * appends text to the console, '\n' starts a new line and lines wider than
+ * the console are wrapped. Only the modified rows are drawn.
+ */
+void console_write(Console *console, const char *txt)
+{
+    const Font *font = gui_font();
+    Color penColor = gui_penColor(), brushColor = gui_brushColor();
+    char *line;
+    uint8_t len, width;
+
+    if (console->rows == 0)
+        return;
+
+    gui_setFont(console->font);
+    gui_setPenColor(console->fgColor);
+    gui_setBrushColor(console->bgColor);
+
+    line = console_lastLine(console);
+    len = strlen(line);
+    while (*txt != '\0')
+    {
+        if (*txt == '\n')
+        {
+            console_drawLine(console, console->shown);
+            if (console->shown < console->rows)
+                console->shown++;
+            console_newLine(console);
+            line = console_lastLine(console);
+            len = 0;
+            txt++;
+            continue;
+        }
+
+        width = gui_getFontWidth(*txt);
+        if (console->lineWidth + width > console->w || len >= CONSOLE_LINE_SIZE - 1)
+        {
+            // wrap
+            console_drawLine(console, console->shown);
+            if (console->shown < console->rows)
+                console->shown++;
+            console_newLine(console);
+            line = console_lastLine(console);
+            len = 0;
+        }
+        line[len++] = *txt;
+        line[len] = '\0';
+        console->lineWidth += width;
+        txt++;
+    }
+
+    // current line, not complete
+    console_drawLine(console, console->shown);
+
+    gui_setFont(font);
+    gui_setPenColor(penColor);
+    gui_setBrushColor(brushColor);
+}
+
+void console_redraw(Console *console)
+{
+    uint8_t row;
+    for (row = 0; row < console->rows; row++)
+        console_drawLine(console, row);
+}
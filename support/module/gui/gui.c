@@ -12,10 +12,74 @@
 #include "gui.h"
 #include "screenController/screenController.h"
 
+#include <string.h>
+
 Color _gui_penColor = 1;
 Color _gui_brushColor = 0;
 const Font *_gui_font = NULL;
 
+// pixels decoded before being sent to the controller in one burst
+#define GUI_BURST_SIZE 32
+
+// clip rect, inclusive bounds, empty when x2 < x1 or y2 < y1
+typedef struct
+{
+    int16_t x1;
+    int16_t y1;
+    int16_t x2;
+    int16_t y2;
+} GuiClip;
+GuiClip _gui_clip = {0, 0, GUI_WIDTH - 1, GUI_HEIGHT - 1};
+GuiClip _gui_clipStack[GUI_CLIP_STACK_SIZE];
+uint8_t _gui_clipDepth = 0;
+
+// pixel stream of a w x h window in controller order (columns), pixels
+// outside of the clip rect are dropped before reaching the controller
+typedef struct
+{
+    uint16_t burst[GUI_BURST_SIZE];
+    uint16_t idBurst;
+    uint16_t height;
+    uint16_t col;
+    uint16_t row;
+    GuiClip visible;    // visible part, window coordinates
+    uint8_t clipped;
+    int16_t x;          // window origin on screen
+    int16_t y;
+    uint8_t transparency;   // PictureTransparency, sparse stream if not none
+    uint16_t key;
+    __prog__ const uint8_t *mask;
+    uint32_t index;     // pixel index in the window
+    uint8_t runOpen;    // a one column window is opened on the current run
+} GuiStream;
+
+// internal functions
+uint8_t gui_clipReject(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+uint8_t gui_streamBegin(GuiStream *stream, int16_t x, int16_t y, uint16_t w, uint16_t h);
+void gui_streamFlush(GuiStream *stream);
+void gui_streamPixel(GuiStream *stream, Color color);
+void gui_streamRepeat(GuiStream *stream, Color color, uint32_t count);
+void gui_streamSparsePixel(GuiStream *stream, Color color);
+void gui_streamSparseRepeat(GuiStream *stream, Color color, uint32_t count);
+void gui_streamSkip(GuiStream *stream, uint32_t count);
+void gui_streamCloseRun(GuiStream *stream);
+void gui_streamEnd(GuiStream *stream);
+void gui_dispImageRaw565(uint16_t x, uint16_t y, const Picture *pic);
+void gui_dispImageRle565(GuiStream *stream, const Picture *pic);
+void gui_dispImageQoi565(GuiStream *stream, const Picture *pic);
+void gui_dispImageIndexed(GuiStream *stream, const Picture *pic);
+void gui_drawLineRuns(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+void gui_drawHSpan(int16_t x1, int16_t x2, int16_t y, Color color);
+void gui_drawVSpan(int16_t x, int16_t y1, int16_t y2, Color color);
+void gui_drawQuadHRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t from, int16_t to, int16_t row);
+void gui_drawQuadVRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t from, int16_t to, int16_t col);
+void gui_drawCircleRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t r);
+void gui_drawFillCircleRows(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t r);
+void gui_drawEllipseRuns(int16_t x, int16_t y, int16_t rx, int16_t ry, uint8_t fill);
+void gui_drawArcRows(int16_t x, int16_t y, int32_t hole2, int32_t outer2, int16_t startAngle, int16_t endAngle, Color color);
+int16_t gui_sin(int16_t angle);
+int16_t gui_isqrt(int32_t value);
+
 void gui_init(rt_dev_t dev)
 {
     gui_ctrl_init(dev);
@@ -23,12 +87,340 @@ void gui_init(rt_dev_t dev)
 
 void gui_fillScreen(Color color)
 {
-    uint16_t i,j;
+    if (_gui_clip.x2 < _gui_clip.x1 || _gui_clip.y2 < _gui_clip.y1)
+        return;
+    gui_ctrl_setRectScreen(_gui_clip.x1, _gui_clip.y1, _gui_clip.x2 - _gui_clip.x1 + 1, _gui_clip.y2 - _gui_clip.y1 + 1);
+    gui_ctrl_write_repeat(color, (uint32_t)(_gui_clip.x2 - _gui_clip.x1 + 1) * (_gui_clip.y2 - _gui_clip.y1 + 1));
     gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+/**
+ * @brief gui_pushClipRect
+ * restricts drawing to the intersection of (x, y, w, h) and the current clip
+ * rect, until gui_popClipRect
+ * @return 0 if ok, -1 if the stack is full (clip rect unchanged)
+ */
+int gui_pushClipRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    int16_t x2 = (int16_t)(x + w) - 1, y2 = (int16_t)(y + h) - 1;
+
+    if (_gui_clipDepth >= GUI_CLIP_STACK_SIZE)
+        return -1;
+    _gui_clipStack[_gui_clipDepth++] = _gui_clip;
+
+    if ((int16_t)x > _gui_clip.x1)
+        _gui_clip.x1 = x;
+    if ((int16_t)y > _gui_clip.y1)
+        _gui_clip.y1 = y;
+    if (x2 < _gui_clip.x2)
+        _gui_clip.x2 = x2;
+    if (y2 < _gui_clip.y2)
+        _gui_clip.y2 = y2;
+    return 0;
+}
+
+void gui_popClipRect(void)
+{
+    if (_gui_clipDepth == 0)
+        return;
+    _gui_clip = _gui_clipStack[--_gui_clipDepth];
+}
+
+uint8_t gui_isRectVisible(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    if (w == 0 || h == 0)
+        return 0;
+    return !gui_clipReject(x, y, x + w - 1, y + h - 1);
+}
+
+uint8_t gui_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy)
+{
+    int16_t x1 = x, y1 = y, x2 = x + w - 1, y2 = y + h - 1;
+
+    if (w == 0 || h == 0 || gui_clipReject(x1, y1, x2, y2))
+        return 1;
+    if (x1 < _gui_clip.x1)
+        x1 = _gui_clip.x1;
+    if (y1 < _gui_clip.y1)
+        y1 = _gui_clip.y1;
+    if (x2 > _gui_clip.x2)
+        x2 = _gui_clip.x2;
+    if (y2 > _gui_clip.y2)
+        y2 = _gui_clip.y2;
+    return gui_ctrl_scrollRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1, dy);
+}
+
+uint8_t gui_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer)
+{
+    if (w == 0 || h == 0)
+        return 1;
+    return gui_ctrl_readRect(x, y, w, h, buffer);
+}
+
+/**
+ * @brief gui_drawBuffer
+ * sends the visible rows of the visible columns of a RAM pixels buffer
+ * directly to the controller, one burst per column
+ */
+void gui_drawBuffer(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *buffer)
+{
+    GuiStream stream;
+    uint16_t col;
+
+    if (!gui_streamBegin(&stream, x, y, w, h))
+        return;
+
+    for (col = stream.visible.x1; col <= stream.visible.x2; col++)
+        gui_ctrl_write_burst(buffer + (uint32_t)col * h + stream.visible.y1, stream.visible.y2 - stream.visible.y1 + 1);
+
+    gui_streamEnd(&stream);
+}
+
+/**
+ * @brief gui_clipReject
+ * early rejection test of a primitive bounding box
+ * @return 1 if no pixel of the box is inside the clip rect
+ */
+uint8_t gui_clipReject(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+    return (x2 < _gui_clip.x1 || x1 > _gui_clip.x2 || y2 < _gui_clip.y1 || y1 > _gui_clip.y2);
+}
+
+/**
+ * @brief gui_streamBegin
+ * opens the visible part of the window (x, y, w, h) on the controller
+ * @return 0 if the window is fully clipped, nothing has to be sent
+ */
+uint8_t gui_streamBegin(GuiStream *stream, int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+    GuiClip *visible = &stream->visible;
+
+    if (w == 0 || h == 0 || gui_clipReject(x, y, x + w - 1, y + h - 1))
+        return 0;
+
+    visible->x1 = (x < _gui_clip.x1) ? _gui_clip.x1 - x : 0;
+    visible->y1 = (y < _gui_clip.y1) ? _gui_clip.y1 - y : 0;
+    visible->x2 = (x + w - 1 > _gui_clip.x2) ? _gui_clip.x2 - x : w - 1;
+    visible->y2 = (y + h - 1 > _gui_clip.y2) ? _gui_clip.y2 - y : h - 1;
+    stream->clipped = (visible->x1 != 0 || visible->y1 != 0 || visible->x2 != w - 1 || visible->y2 != h - 1);
+    stream->height = h;
+    stream->col = 0;
+    stream->row = 0;
+    stream->idBurst = 0;
+    stream->x = x;
+    stream->y = y;
+    stream->transparency = PictureTransparencyNone;
+    stream->index = 0;
+    stream->runOpen = 0;
+
+    gui_ctrl_setRectScreen(x + visible->x1, y + visible->y1, visible->x2 - visible->x1 + 1, visible->y2 - visible->y1 + 1);
+    return 1;
+}
+
+void gui_streamFlush(GuiStream *stream)
+{
+    if (stream->idBurst == 0)
+        return;
+    gui_ctrl_write_burst(stream->burst, stream->idBurst);
+    stream->idBurst = 0;
+}
+
+void gui_streamPixel(GuiStream *stream, Color color)
+{
+    if (stream->transparency != PictureTransparencyNone)
+    {
+        gui_streamSparsePixel(stream, color);
+        return;
+    }
+    if (stream->clipped)
+    {
+        uint8_t visible = (stream->col >= stream->visible.x1 && stream->col <= stream->visible.x2
+                           && stream->row >= stream->visible.y1 && stream->row <= stream->visible.y2);
+        if (++stream->row == stream->height)
+        {
+            stream->row = 0;
+            stream->col++;
+        }
+        if (!visible)
+            return;
+    }
+
+    stream->burst[stream->idBurst++] = color;
+    if (stream->idBurst == GUI_BURST_SIZE)
+        gui_streamFlush(stream);
+}
+
+/**
+ * @brief gui_streamRepeat
+ * count pixels of the same color, clipped column by column
+ */
+void gui_streamRepeat(GuiStream *stream, Color color, uint32_t count)
+{
+    uint16_t n;
+    int16_t from, to;
+
+    if (count == 0)
+        return;
+    if (stream->transparency != PictureTransparencyNone)
+    {
+        gui_streamSparseRepeat(stream, color, count);
+        return;
+    }
+    gui_streamFlush(stream);
+    if (!stream->clipped)
+    {
+        gui_ctrl_write_repeat(color, count);
+        return;
+    }
+
+    while (count > 0)
+    {
+        n = stream->height - stream->row;
+        if (n > count)
+            n = count;
+
+        if (stream->col >= stream->visible.x1 && stream->col <= stream->visible.x2)
+        {
+            from = (stream->row > stream->visible.y1) ? stream->row : stream->visible.y1;
+            to = (stream->row + n - 1 < stream->visible.y2) ? stream->row + n - 1 : stream->visible.y2;
+            if (from <= to)
+                gui_ctrl_write_repeat(color, to - from + 1);
+        }
+
+        count -= n;
+        stream->row += n;
+        if (stream->row == stream->height)
+        {
+            stream->row = 0;
+            stream->col++;
+        }
+    }
+}
+
+/**
+ * @brief gui_streamSparsePixel
+ * pixel of a transparent picture, transparent and hidden pixels are skipped
+ * and each run of visible opaque pixels of a column is sent in its own one
+ * column window
+ */
+void gui_streamSparsePixel(GuiStream *stream, Color color)
+{
+    uint8_t opaque;
+
+    if (stream->transparency == PictureTransparencyKey)
+        opaque = (color != stream->key);
+    else
+        opaque = PICTURE_MASK_OPAQUE(stream->mask, stream->index);
+    stream->index++;
+
+    if (opaque && stream->col >= stream->visible.x1 && stream->col <= stream->visible.x2
+        && stream->row >= stream->visible.y1 && stream->row <= stream->visible.y2)
+    {
+        if (!stream->runOpen)
+        {
+            gui_ctrl_setRectScreen(stream->x + stream->col, stream->y + stream->row, 1, stream->visible.y2 - stream->row + 1);
+            stream->runOpen = 1;
+        }
+        stream->burst[stream->idBurst++] = color;
+        if (stream->idBurst == GUI_BURST_SIZE)
+            gui_streamFlush(stream);
+    }
+    else
+        gui_streamCloseRun(stream);
+
+    if (++stream->row == stream->height)
+    {
+        stream->row = 0;
+        stream->col++;
+        gui_streamCloseRun(stream);
+    }
+}
+
+/**
+ * @brief gui_streamSparseRepeat
+ * count pixels of the same color of a transparent picture, key colored runs
+ * are skipped without being sent
+ */
+void gui_streamSparseRepeat(GuiStream *stream, Color color, uint32_t count)
+{
+    uint16_t n;
+    int16_t from, to;
+
+    if (stream->transparency == PictureTransparencyMask)
+    {
+        while (count-- > 0)
+            gui_streamSparsePixel(stream, color);
+        return;
+    }
+    if (color == stream->key)
+    {
+        gui_streamSkip(stream, count);
+        return;
+    }
+
+    while (count > 0)
+    {
+        n = stream->height - stream->row;
+        if (n > count)
+            n = count;
 
-    for (i = 0; i<GUI_WIDTH; i++)
-        for (j = 0; j<GUI_HEIGHT; j++)
-            gui_ctrl_write_data(color);
+        from = (stream->row > stream->visible.y1) ? stream->row : stream->visible.y1;
+        to = (stream->row + n - 1 < stream->visible.y2) ? stream->row + n - 1 : stream->visible.y2;
+        if (stream->col >= stream->visible.x1 && stream->col <= stream->visible.x2 && from <= to)
+        {
+            gui_streamFlush(stream);
+            if (!stream->runOpen)
+                gui_ctrl_setRectScreen(stream->x + stream->col, stream->y + from, 1, stream->visible.y2 - from + 1);
+            gui_ctrl_write_repeat(color, to - from + 1);
+            // run goes on with the next pixel only if it is still visible
+            stream->runOpen = (to == stream->row + n - 1);
+        }
+        else
+            gui_streamCloseRun(stream);
+
+        count -= n;
+        stream->index += n;
+        stream->row += n;
+        if (stream->row == stream->height)
+        {
+            stream->row = 0;
+            stream->col++;
+            gui_streamCloseRun(stream);
+        }
+    }
+}
+
+/**
+ * @brief gui_streamSkip
+ * moves the stream position count pixels forward without sending anything
+ */
+void gui_streamSkip(GuiStream *stream, uint32_t count)
+{
+    uint32_t pos;
+
+    if (count == 0)
+        return;
+    gui_streamCloseRun(stream);
+    pos = stream->row + count;
+    stream->index += count;
+    stream->col += pos / stream->height;
+    stream->row = pos % stream->height;
+}
+
+void gui_streamCloseRun(GuiStream *stream)
+{
+    if (!stream->runOpen)
+        return;
+    gui_streamFlush(stream);
+    stream->runOpen = 0;
+}
+
+void gui_streamEnd(GuiStream *stream)
+{
+    gui_streamFlush(stream);
+
+    // restore full draw screen
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
 }
 
 /**
@@ -37,25 +429,237 @@ void gui_fillScreen(Color color)
  */
 void gui_dispImage(uint16_t x, uint16_t y, const Picture *pic)
 {
-    uint16_t i,j;
-    unsigned long addr = 0;
+    GuiStream stream;
 
-    //TODO: create warning if the image is too big
+    if (pic->format == PictureFormatRaw565)
+    {
+        gui_dispImageRaw565(x, y, pic);
+        return;
+    }
 
     // set rect image area space address
-    gui_ctrl_setRectScreen(x, y, pic->width, pic->height);
+    if (!gui_streamBegin(&stream, x, y, pic->width, pic->height))
+        return;
+    stream.transparency = pic->transparency;
+    stream.key = pic->key;
+    stream.mask = pic->mask;
 
-    for (i = 0; i<pic->width; i++)
+    switch (pic->format)
     {
-        for (j = 0; j<pic->height; j++)
+    case PictureFormatRle565:
+        gui_dispImageRle565(&stream, pic);
+        break;
+    case PictureFormatQoi565:
+        gui_dispImageQoi565(&stream, pic);
+        break;
+    case PictureFormatIndexed1:
+    case PictureFormatIndexed2:
+    case PictureFormatIndexed4:
+    case PictureFormatIndexed8:
+        gui_dispImageIndexed(&stream, pic);
+        break;
+    }
+
+    gui_streamEnd(&stream);
+}
+
+/**
+ * @brief gui_dispImageRaw565
+ * copy raw pixels to the controller by bursts of GUI_BURST_SIZE pixels, only
+ * the visible rows of the visible columns are read, transparent pictures are
+ * sent through the sparse stream
+ */
+void gui_dispImageRaw565(uint16_t x, uint16_t y, const Picture *pic)
+{
+    GuiStream stream;
+    uint16_t i, count, col, columns;
+    uint32_t rows, remaining;
+    __prog__ const uint16_t *data;
+
+    if (!gui_streamBegin(&stream, x, y, pic->width, pic->height))
+        return;
+
+    if (pic->transparency != PictureTransparencyNone)
+    {
+        stream.transparency = pic->transparency;
+        stream.key = pic->key;
+        stream.mask = pic->mask;
+        for (col = stream.visible.x1; col <= stream.visible.x2; col++)
         {
-            gui_ctrl_write_data(pic->data[addr]);
-            ++addr;
+            gui_streamSkip(&stream, (uint32_t)col * pic->height + stream.visible.y1 - stream.index);
+            data = pic->data + stream.index;
+            for (i = stream.visible.y1; i <= stream.visible.y2; i++)
+                gui_streamSparsePixel(&stream, *(data++));
         }
+        gui_streamEnd(&stream);
+        return;
     }
 
-    // restore full draw screen
-    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+    columns = stream.visible.x2 - stream.visible.x1 + 1;
+    rows = stream.visible.y2 - stream.visible.y1 + 1;
+    if (!stream.clipped)
+    {
+        // whole picture in one pass
+        rows = (uint32_t)pic->width * pic->height;
+        columns = 1;
+    }
+
+    for (col = 0; col < columns; col++)
+    {
+        data = pic->data + (uint32_t)(stream.visible.x1 + col) * pic->height + stream.visible.y1;
+        remaining = rows;
+        while (remaining > 0)
+        {
+            count = (remaining > GUI_BURST_SIZE) ? GUI_BURST_SIZE : remaining;
+            for (i = 0; i < count; i++)
+                stream.burst[i] = *(data++);
+            gui_ctrl_write_burst(stream.burst, count);
+            remaining -= count;
+        }
+    }
+
+    gui_streamEnd(&stream);
+}
+
+/**
+ * @brief gui_dispImageRle565
+ * streaming decoder of PictureFormatRle565, runs are sent as repeated writes
+ * and literals by bursts
+ */
+void gui_dispImageRle565(GuiStream *stream, const Picture *pic)
+{
+    uint16_t ctrl;
+    uint32_t count;
+    uint32_t remaining = (uint32_t)pic->width * pic->height;
+    __prog__ const uint16_t *data = pic->data;
+
+    // stops after the last visible column
+    while (remaining > 0 && stream->col <= stream->visible.x2)
+    {
+        ctrl = *(data++);
+        count = (ctrl & PICTURE_RLE_COUNTMASK) + 1;
+        if (count > remaining)  // corrupted stream, never write outside of the picture
+            count = remaining;
+        remaining -= count;
+
+        if (ctrl & PICTURE_RLE_RUN)
+        {
+            gui_streamRepeat(stream, *(data++), count);
+            continue;
+        }
+
+        while (count > 0)
+        {
+            gui_streamPixel(stream, *(data++));
+            count--;
+        }
+    }
+}
+
+/**
+ * @brief gui_dispImageQoi565
+ * streaming decoder of PictureFormatQoi565, decoded pixels are sent by bursts
+ */
+void gui_dispImageQoi565(GuiStream *stream, const Picture *pic)
+{
+    uint16_t index[64];
+    uint16_t px = 0;
+    uint8_t op, r, g, b;
+    int8_t dg;
+    uint32_t run;
+    uint32_t remaining = (uint32_t)pic->width * pic->height;
+    __prog__ const uint8_t *data = (__prog__ const uint8_t *)pic->data;
+
+    memset(index, 0, sizeof(index));
+    while (remaining > 0 && stream->col <= stream->visible.x2)
+    {
+        op = *(data++);
+        if ((op & PICTURE_QOI_MASK) == PICTURE_QOI_OP_RUN && op != PICTURE_QOI_OP_565)
+        {
+            run = (op & 0x3F) + 1;
+            if (run > remaining)
+                run = remaining;
+            remaining -= run;
+
+            // flush pending pixels and write the run in one shot
+            gui_streamRepeat(stream, px, run);
+            continue;
+        }
+
+        r = px >> 11;
+        g = (px >> 5) & 0x3F;
+        b = px & 0x1F;
+        switch (op & PICTURE_QOI_MASK)
+        {
+        case PICTURE_QOI_OP_INDEX:
+            px = index[op];
+            break;
+        case PICTURE_QOI_OP_DIFF:
+            r = (r + ((op >> 4) & 0x03) - 2) & 0x1F;
+            g = (g + ((op >> 2) & 0x03) - 2) & 0x3F;
+            b = (b + (op & 0x03) - 2) & 0x1F;
+            px = ((uint16_t)r << 11) | ((uint16_t)g << 5) | b;
+            break;
+        case PICTURE_QOI_OP_LUMA:
+            dg = (op & 0x3F) - 32;
+            op = *(data++);
+            r = (r + dg + (op >> 4) - 8) & 0x1F;
+            g = (g + dg) & 0x3F;
+            b = (b + dg + (op & 0x0F) - 8) & 0x1F;
+            px = ((uint16_t)r << 11) | ((uint16_t)g << 5) | b;
+            break;
+        default:  // PICTURE_QOI_OP_565
+            px = (uint16_t)(*(data++)) << 8;
+            px |= *(data++);
+            break;
+        }
+        index[PICTURE_QOI_HASH(px)] = px;
+
+        gui_streamPixel(stream, px);
+        remaining--;
+    }
+}
+
+/**
+ * @brief gui_dispImageIndexed
+ * expands PictureFormatIndexed1/2/4/8 pixels through the palette and sends
+ * them by bursts. Palettes up to 16 colors are copied to a RAM lookup table.
+ */
+void gui_dispImageIndexed(GuiStream *stream, const Picture *pic)
+{
+    uint16_t lut[16];
+    uint8_t bpp, mask, byte, bit;
+    uint16_t i, colors;
+    uint32_t remaining = (uint32_t)pic->width * pic->height;
+    __prog__ const uint8_t *data = (__prog__ const uint8_t *)pic->data;
+
+    bpp = PICTURE_INDEXED_BPP(pic->format);
+    mask = (1 << bpp) - 1;
+
+    if (bpp == 8)
+    {
+        while (remaining > 0 && stream->col <= stream->visible.x2)
+        {
+            gui_streamPixel(stream, pic->palette[*(data++)]);
+            remaining--;
+        }
+        return;
+    }
+
+    colors = 1 << bpp;
+    for (i = 0; i < colors; i++)
+        lut[i] = pic->palette[i];
+
+    while (remaining > 0 && stream->col <= stream->visible.x2)
+    {
+        byte = *(data++);
+        for (bit = 0; bit < 8 && remaining > 0; bit += bpp)
+        {
+            gui_streamPixel(stream, lut[byte & mask]);
+            byte >>= bpp;
+            remaining--;
+        }
+    }
 }
 
 void gui_setPenColor(uint16_t color)
@@ -80,108 +684,674 @@ uint16_t gui_brushColor()
 
 void gui_drawPoint(uint16_t x, uint16_t y)
 {
+    if (gui_clipReject(x, y, x, y))
+        return;
     gui_ctrl_drawPoint(x, y, _gui_penColor);
 }
 
-void gui_drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+/**
+ * @brief gui_drawLineRuns
+ * Bresenham line, pixels sharing a row (or a column for steep lines) are sent
+ * as one span
+ */
+void gui_drawLineRuns(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
 {
-    int dx = x2 - x1;
-    int dy = y2 - y1;
-    int ratioX = dx;
-    int ratioY = dy;
-    float m, b;
-    /*void (*pixelPtr)(unsigned short,unsigned short,char);
+    int16_t dx = (x2 > x1) ? x2 - x1 : x1 - x2;
+    int16_t dy = (y2 > y1) ? y2 - y1 : y1 - y2;
+    int16_t sx = (x2 > x1) ? 1 : -1;
+    int16_t sy = (y2 > y1) ? 1 : -1;
+    int16_t err, start;
 
-    // Si la ligne ne sort pas de l ecran, on affiche les pixels sans les controler
-    pixelPtr = ( (x1 >= 0 && y1 >= 0 && x1 < PIXEL_NUMBER_X && y1 < PIXEL_NUMBER_Y) &&
-                 (x2 >= 0 && y2 >= 0 && x2 < PIXEL_NUMBER_X && y2 < PIXEL_NUMBER_Y) )
-        ? &point : &drawPoint;*/
+    if (gui_clipReject((x1 < x2) ? x1 : x2, (y1 < y2) ? y1 : y2, (x1 < x2) ? x2 : x1, (y1 < y2) ? y2 : y1))
+        return;
 
-    if (dx == 0)
+    if (dx >= dy)
     {
-        gui_drawPoint(x1, y1);
-        dy = (y2 > y1) ? 1 : -1;
-        while (y1 != y2)
+        err = dx / 2;
+        start = x1;
+        while (x1 != x2)
         {
-            y1 = y1 + dy;
-            gui_drawPoint(x1, y1);
+            err -= dy;
+            if (err < 0)
+            {
+                gui_drawHSpan((sx > 0) ? start : x1, (sx > 0) ? x1 : start, y1, _gui_penColor);
+                y1 += sy;
+                err += dx;
+                start = x1 + sx;
+            }
+            x1 += sx;
         }
-        return;
+        gui_drawHSpan((sx > 0) ? start : x2, (sx > 0) ? x2 : start, y1, _gui_penColor);
     }
-    if (dy == 0)
+    else
     {
-        gui_drawPoint(x1, y1);
-        dx = (x2 > x1) ? 1 : -1;
-        while (x1 != x2)
+        err = dy / 2;
+        start = y1;
+        while (y1 != y2)
         {
-            x1 = x1 + dx;
-            gui_drawPoint(x1, y1);
+            err -= dx;
+            if (err < 0)
+            {
+                gui_drawVSpan(x1, (sy > 0) ? start : y1, (sy > 0) ? y1 : start, _gui_penColor);
+                x1 += sx;
+                err += dy;
+                start = y1 + sy;
+            }
+            y1 += sy;
         }
+        gui_drawVSpan(x1, (sy > 0) ? start : y2, (sy > 0) ? y2 : start, _gui_penColor);
+    }
+}
+
+void gui_drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    gui_drawLineRuns(x1, y1, x2, y2);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+void gui_drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    if (gui_clipReject(x, y, x + w, y + h))
+        return;
+    gui_drawHSpan(x, x + w, y, _gui_penColor);
+    gui_drawHSpan(x, x + w, y + h, _gui_penColor);
+    gui_drawVSpan(x, y + 1, y + h - 1, _gui_penColor);
+    gui_drawVSpan(x + w, y + 1, y + h - 1, _gui_penColor);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+void gui_drawFillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    GuiStream stream;
+
+    // set rect image area space address, clipped
+    if (!gui_streamBegin(&stream, x, y, w, h))
+        return;
+
+    // fill this rect with brush color
+    gui_ctrl_write_repeat(_gui_brushColor, (uint32_t)(stream.visible.x2 - stream.visible.x1 + 1) * (stream.visible.y2 - stream.visible.y1 + 1));
+
+    // restore full draw screen
+    gui_streamEnd(&stream);
+
+    // draw border with pen color
+    //gui_drawRect(x, y, w, h);
+}
+
+/**
+ * @brief gui_drawHSpan
+ * horizontal line from x1 to x2 (included) as one controller window, clipped
+ */
+void gui_drawHSpan(int16_t x1, int16_t x2, int16_t y, Color color)
+{
+    if (y < _gui_clip.y1 || y > _gui_clip.y2)
+        return;
+    if (x1 < _gui_clip.x1)
+        x1 = _gui_clip.x1;
+    if (x2 > _gui_clip.x2)
+        x2 = _gui_clip.x2;
+    if (x2 < x1)
+        return;
+    gui_ctrl_setRectScreen(x1, y, x2 - x1 + 1, 1);
+    gui_ctrl_write_repeat(color, x2 - x1 + 1);
+}
+
+/**
+ * @brief gui_drawVSpan
+ * vertical line from y1 to y2 (included) as one controller window, clipped
+ */
+void gui_drawVSpan(int16_t x, int16_t y1, int16_t y2, Color color)
+{
+    if (x < _gui_clip.x1 || x > _gui_clip.x2)
+        return;
+    if (y1 < _gui_clip.y1)
+        y1 = _gui_clip.y1;
+    if (y2 > _gui_clip.y2)
+        y2 = _gui_clip.y2;
+    if (y2 < y1)
+        return;
+    gui_ctrl_setRectScreen(x, y1, 1, y2 - y1 + 1);
+    gui_ctrl_write_repeat(color, y2 - y1 + 1);
+}
+
+/**
+ * @brief gui_drawQuadHRuns
+ * horizontal run from..to at row offset row, mirrored in the four quadrants
+ * centered on (xl, yt), (xr, yt), (xl, yb) and (xr, yb). Mirrored runs
+ * sharing pixels are merged so each pixel is sent once.
+ */
+void gui_drawQuadHRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t from, int16_t to, int16_t row)
+{
+    if (from == 0 && xl == xr)
+    {
+        gui_drawHSpan(xl - to, xr + to, yt - row, _gui_penColor);
+        if (row != 0 || yt != yb)
+            gui_drawHSpan(xl - to, xr + to, yb + row, _gui_penColor);
         return;
     }
+    gui_drawHSpan(xl - to, xl - from, yt - row, _gui_penColor);
+    gui_drawHSpan(xr + from, xr + to, yt - row, _gui_penColor);
+    if (row != 0 || yt != yb)
+    {
+        gui_drawHSpan(xl - to, xl - from, yb + row, _gui_penColor);
+        gui_drawHSpan(xr + from, xr + to, yb + row, _gui_penColor);
+    }
+}
+
+/**
+ * @brief gui_drawQuadVRuns
+ * vertical run from..to at column offset col, mirrored like gui_drawQuadHRuns
+ */
+void gui_drawQuadVRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t from, int16_t to, int16_t col)
+{
+    if (from == 0 && yt == yb)
+    {
+        gui_drawVSpan(xl - col, yt - to, yb + to, _gui_penColor);
+        if (col != 0 || xl != xr)
+            gui_drawVSpan(xr + col, yt - to, yb + to, _gui_penColor);
+        return;
+    }
+    gui_drawVSpan(xl - col, yt - to, yt - from, _gui_penColor);
+    gui_drawVSpan(xl - col, yb + from, yb + to, _gui_penColor);
+    if (col != 0 || xl != xr)
+    {
+        gui_drawVSpan(xr + col, yt - to, yt - from, _gui_penColor);
+        gui_drawVSpan(xr + col, yb + from, yb + to, _gui_penColor);
+    }
+}
 
-    if (ratioX < 0) ratioX = -ratioX;
-    if (ratioY < 0) ratioY = -ratioY;
+/**
+ * @brief gui_drawCircleRuns
+ * midpoint circle outline split in four quadrants. Pixels of the first octant
+ * sharing a row are sent as horizontal runs, their transposed as vertical
+ * runs.
+ */
+void gui_drawCircleRuns(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t r)
+{
+    int16_t x = 0, y = r, start = 0;
+    int16_t d = 1 - r;
 
-    if (ratioX >= ratioY)
+    while (x <= y)
     {
-        m = (float)dy / (float)dx;
-        b = y1 - m*x1;
+        if (d >= 0 || x == y)
+        {
+            // row y (and column y) run from start to x is complete, the
+            // diagonal pixel belongs to the row
+            gui_drawQuadHRuns(xl, yt, xr, yb, start, x, y);
+            gui_drawQuadVRuns(xl, yt, xr, yb, start, (x == y) ? x - 1 : x, y);
+            if (d >= 0)
+            {
+                d += 2 * (x - y) + 5;
+                y--;
+            }
+            else
+                d += 2 * x + 3;
+            start = x + 1;
+        }
+        else
+            d += 2 * x + 3;
+        x++;
+    }
+}
 
-        dx = (x2 > x1) ? 1 : -1;
+/**
+ * @brief gui_drawFillCircleRows
+ * midpoint filled circle, one horizontal span per row, quadrants centered on
+ * (xl, yt), (xr, yt), (xl, yb) and (xr, yb), rows between yt and yb are not
+ * drawn.
+ */
+void gui_drawFillCircleRows(int16_t xl, int16_t yt, int16_t xr, int16_t yb, int16_t r)
+{
+    int16_t x = 0, y = r;
+    int16_t d = 1 - r;
 
-        gui_drawPoint(x1, y1);
-        while (x1 != x2)
+    while (x <= y)
+    {
+        // rows x, width y
+        gui_drawHSpan(xl - y, xr + y, yb + x, _gui_brushColor);
+        if (x != 0 || yt != yb)
+            gui_drawHSpan(xl - y, xr + y, yt - x, _gui_brushColor);
+        if (d >= 0)
         {
-            x1 += dx;
-            y1 = (int)((m*x1 + b)+0.5);
-            gui_drawPoint(x1, y1);
+            // rows y, width x, last time this row is seen
+            if (x != y)
+            {
+                gui_drawHSpan(xl - x, xr + x, yb + y, _gui_brushColor);
+                gui_drawHSpan(xl - x, xr + x, yt - y, _gui_brushColor);
+            }
+            d += 2 * (x - y) + 5;
+            y--;
         }
+        else
+            d += 2 * x + 3;
+        x++;
+    }
+}
+
+void gui_drawCircle(uint16_t x, uint16_t y, uint16_t r)
+{
+    if (gui_clipReject(x - r, y - r, x + r, y + r))
+        return;
+    gui_drawCircleRuns(x, y, x, y, r);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+void gui_drawFillCircle(uint16_t x, uint16_t y, uint16_t r)
+{
+    if (gui_clipReject(x - r, y - r, x + r, y + r))
         return;
+    gui_drawFillCircleRows(x, y, x, y, r);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+/**
+ * @brief gui_drawEllipseRuns
+ * midpoint ellipse walking the quadrant from (0, ry) to (rx, 0). Outline
+ * pixels are grouped in horizontal runs while the slope is above -1 and
+ * vertical runs after. Filled ellipse gets one span per row.
+ */
+void gui_drawEllipseRuns(int16_t x, int16_t y, int16_t rx, int16_t ry, uint8_t fill)
+{
+    int32_t rx2 = (int32_t)rx * rx, ry2 = (int32_t)ry * ry;
+    int32_t dx = 0, dy = 2 * rx2 * ry;
+    int32_t p;
+    int16_t px = 0, py = ry, start = 0;
+
+    // region 1, horizontal runs of pixels
+    p = ry2 - rx2 * ry + rx2 / 4;
+    while (dx < dy)
+    {
+        if (p < 0)
+        {
+            px++;
+            dx += 2 * ry2;
+            p += dx + ry2;
+        }
+        else
+        {
+            // row py is complete
+            if (fill)
+            {
+                gui_drawHSpan(x - px, x + px, y - py, _gui_brushColor);
+                if (py != 0)
+                    gui_drawHSpan(x - px, x + px, y + py, _gui_brushColor);
+            }
+            else
+                gui_drawQuadHRuns(x, y, x, y, start, px, py);
+            px++;
+            py--;
+            start = px;
+            dx += 2 * ry2;
+            dy -= 2 * rx2;
+            p += dx - dy + ry2;
+        }
     }
-    if (ratioX < ratioY)
+    if (!fill && start < px)
+        gui_drawQuadHRuns(x, y, x, y, start, px - 1, py); // pending part of the current row
+
+    // region 2, vertical runs of pixels. The decision at (px + 1/2, py - 1)
+    // is derived from the one of region 1 at (px + 1, py - 1/2), the terms
+    // rx2 * ry2 of a direct evaluation would overflow 32 bits on 320x240
+    start = py;
+    p += rx2 * (1 - py) - ry2 * (px + 1) + ry2 / 4 - rx2 / 4;
+    while (py >= 0)
     {
-        m = (float)dx / (float)dy;
-        b = x1 - m*y1;
+        if (fill)
+        {
+            gui_drawHSpan(x - px, x + px, y - py, _gui_brushColor);
+            if (py != 0)
+                gui_drawHSpan(x - px, x + px, y + py, _gui_brushColor);
+        }
+        if (p > 0)
+        {
+            py--;
+            dy -= 2 * rx2;
+            p += rx2 - dy;
+        }
+        else
+        {
+            // column px is complete
+            if (!fill)
+                gui_drawQuadVRuns(x, y, x, y, py, start, px);
+            py--;
+            px++;
+            start = py;
+            dx += 2 * ry2;
+            dy -= 2 * rx2;
+            p += dx - dy + rx2;
+        }
+    }
+    if (!fill && start >= 0)
+        gui_drawQuadVRuns(x, y, x, y, 0, start, px);
+}
+
+void gui_drawEllipse(uint16_t x, uint16_t y, uint16_t rx, uint16_t ry)
+{
+    if (gui_clipReject(x - rx, y - ry, x + rx, y + ry))
+        return;
+    gui_drawEllipseRuns(x, y, rx, ry, 0);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
 
-        dy = (y2 > y1) ? 1 : -1;
+void gui_drawFillEllipse(uint16_t x, uint16_t y, uint16_t rx, uint16_t ry)
+{
+    if (gui_clipReject(x - rx, y - ry, x + rx, y + ry))
+        return;
+    gui_drawEllipseRuns(x, y, rx, ry, 1);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
 
-        gui_drawPoint(x1, y1);
-        while (y1 != y2)
+// sin(angle) * 16384, angle 0 to 90 degrees
+const int16_t gui_sinTable[91] = {
+    0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563, 2845, 3126, 3406, 3686,
+    3964, 4240, 4516, 4790, 5063, 5334, 5604, 5872, 6138, 6402, 6664, 6924, 7182,
+    7438, 7692, 7943, 8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365, 12551,
+    12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044, 14189, 14330,
+    14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296, 15396, 15491, 15582,
+    15668, 15749, 15826, 15897, 15964, 16026, 16083, 16135, 16182, 16225, 16262,
+    16294, 16322, 16344, 16362, 16374, 16382, 16384
+};
+
+/**
+ * @brief gui_sin
+ * integer sinus, result scaled by 16384
+ */
+int16_t gui_sin(int16_t angle)
+{
+    angle %= 360;
+    if (angle < 0)
+        angle += 360;
+    if (angle <= 90)
+        return gui_sinTable[angle];
+    if (angle <= 180)
+        return gui_sinTable[180 - angle];
+    if (angle <= 270)
+        return -gui_sinTable[angle - 180];
+    return -gui_sinTable[360 - angle];
+}
+
+/**
+ * @brief gui_isqrt
+ * integer square root, floor(sqrt(value))
+ */
+int16_t gui_isqrt(int32_t value)
+{
+    uint32_t res = 0, bit = (uint32_t)1 << 30;
+    uint32_t num = value;
+
+    if (value <= 0)
+        return 0;
+    while (bit > num)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (num >= res + bit)
         {
-            y1 += dy;
-            x1 = (int)((m*y1 + b)+0.5);
-            gui_drawPoint(x1, y1);
+            num -= res + bit;
+            res = (res >> 1) + bit;
         }
+        else
+            res >>= 1;
+        bit >>= 2;
+    }
+    return res;
+}
+
+/**
+ * @brief gui_drawArcRows
+ * scanline annular sector, pixels with hole2 <= d^2 <= outer2 and an angle
+ * between startAngle and endAngle (counterclockwise). Each row is split in at
+ * most two segments by the hole, pixels outside of the angular sector are
+ * skipped and the remaining runs are sent as spans.
+ */
+void gui_drawArcRows(int16_t x, int16_t y, int32_t hole2, int32_t outer2, int16_t startAngle, int16_t endAngle, Color color)
+{
+    int16_t dy, wo, wi, i, seg, from, to, run;
+    int16_t rOuter = gui_isqrt(outer2), dyEnd;
+    int32_t dy2, sx, sy, ex, ey, cs, ce;
+    uint8_t inside, full, large;
+    int16_t sweep;
+
+    sweep = endAngle - startAngle;
+    full = (sweep >= 360 || sweep <= -360);
+    sweep %= 360;
+    if (sweep < 0)
+        sweep += 360;
+    large = (sweep > 180);
+
+    // sector bounds as vectors, y axis up
+    sx = gui_sin(startAngle + 90);
+    sy = gui_sin(startAngle);
+    ex = gui_sin(endAngle + 90);
+    ey = gui_sin(endAngle);
+
+    if (gui_clipReject(x - rOuter, y - rOuter, x + rOuter, y + rOuter))
         return;
+
+    // only visible rows are scanned
+    dyEnd = (y + rOuter > _gui_clip.y2) ? _gui_clip.y2 - y : rOuter;
+    dy = (y - rOuter < _gui_clip.y1) ? _gui_clip.y1 - y : -rOuter;
+    for (; dy <= dyEnd; dy++)
+    {
+        dy2 = (int32_t)dy * dy;
+        wo = gui_isqrt(outer2 - dy2);
+        wi = (hole2 - dy2 > 0) ? gui_isqrt(hole2 - dy2 - 1) : -1;
+
+        for (seg = 0; seg < 2; seg++)
+        {
+            if (wi < 0)
+            {
+                if (seg == 1)
+                    break;
+                from = -wo;
+                to = wo;
+            }
+            else if (seg == 0)
+            {
+                from = -wo;
+                to = -wi - 1;
+            }
+            else
+            {
+                from = wi + 1;
+                to = wo;
+            }
+
+            // only the visible part of the segment is tested
+            if (from < _gui_clip.x1 - x)
+                from = _gui_clip.x1 - x;
+            if (to > _gui_clip.x2 - x)
+                to = _gui_clip.x2 - x;
+            if (from > to)
+                continue;
+
+            if (full)
+            {
+                gui_drawHSpan(x + from, x + to, y + dy, color);
+                continue;
+            }
+
+            run = from;
+            for (i = from; i <= to + 1; i++)
+            {
+                if (i <= to)
+                {
+                    // cross products with sector bounds, point vector (i, -dy)
+                    cs = sx * (-dy) - sy * i;
+                    ce = i * ey - (-dy) * ex;
+                    if (large)
+                        inside = !(cs < 0 && ce < 0);
+                    else
+                        inside = (cs >= 0 && ce >= 0);
+                }
+                else
+                    inside = 0;
+
+                if (!inside)
+                {
+                    if (run < i)
+                        gui_drawHSpan(x + run, x + i - 1, y + dy, color);
+                    run = i + 1;
+                }
+            }
+        }
     }
 }
 
-void gui_drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+void gui_drawArc(uint16_t x, uint16_t y, uint16_t r, int16_t startAngle, int16_t endAngle)
 {
-    gui_drawLine(x,   y,   x+w,  y);
-    gui_drawLine(x+w, y,   x+w,  y+h);
-    gui_drawLine(x+w, y+h, x,    y+h);
-    gui_drawLine(x,   y+h, x,    y);
+    // pixels at less than half a pixel from the circle, as the midpoint circle
+    gui_drawArcRows(x, y, (int32_t)r * r - r + 1, (int32_t)r * r + r, startAngle, endAngle, _gui_penColor);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
 }
 
-void gui_drawFillRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+void gui_drawFillArc(uint16_t x, uint16_t y, uint16_t rInner, uint16_t rOuter, int16_t startAngle, int16_t endAngle)
 {
-    uint16_t i,j;
+    int32_t hole2 = (rInner > 0) ? (int32_t)rInner * rInner - rInner + 1 : 0;
+    gui_drawArcRows(x, y, hole2, (int32_t)rOuter * rOuter + rOuter, startAngle, endAngle, _gui_brushColor);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
 
-    // set rect image area space address
-    gui_ctrl_setRectScreen(x, y, w, h);
+/**
+ * @brief gui_drawRoundRect
+ * rounded rectangle outline covering w x h pixels, corners radius r
+ */
+void gui_drawRoundRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t r)
+{
+    if (w == 0 || h == 0)
+        return;
+    if (r > (w - 1) / 2)
+        r = (w - 1) / 2;
+    if (r > (h - 1) / 2)
+        r = (h - 1) / 2;
+    if (gui_clipReject(x, y, x + w - 1, y + h - 1))
+        return;
 
-    // fill this rect with brush color
-    for (i = 0; i<h; i++)
-        for (j = 0;j<w;j++)
-            gui_ctrl_write_data(_gui_brushColor);
+    gui_drawCircleRuns(x + r, y + r, x + w - 1 - r, y + h - 1 - r, r);
+    gui_drawHSpan(x + r + 1, x + w - 2 - r, y, _gui_penColor);
+    gui_drawHSpan(x + r + 1, x + w - 2 - r, y + h - 1, _gui_penColor);
+    gui_drawVSpan(x, y + r + 1, y + h - 2 - r, _gui_penColor);
+    gui_drawVSpan(x + w - 1, y + r + 1, y + h - 2 - r, _gui_penColor);
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
 
-    // restore full draw screen
+/**
+ * @brief gui_drawFillRoundRect
+ * filled rounded rectangle covering w x h pixels, corners radius r
+ */
+void gui_drawFillRoundRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t r)
+{
+    if (w == 0 || h == 0)
+        return;
+    if (r > (w - 1) / 2)
+        r = (w - 1) / 2;
+    if (r > (h - 1) / 2)
+        r = (h - 1) / 2;
+    if (gui_clipReject(x, y, x + w - 1, y + h - 1))
+        return;
+
+    gui_drawFillCircleRows(x + r, y + r, x + w - 1 - r, y + h - 1 - r, r);
+    if (h > 2 * r + 2)
+        gui_drawFillRect(x, y + r + 1, w, h - 2 * r - 2); // middle block in one window
     gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
 
-    // draw border with pen color
-    //gui_drawRect(x, y, w, h);
+void gui_drawPolygon(const GuiVertex *points, uint8_t count)
+{
+    uint8_t i;
+    if (count < 2)
+        return;
+    for (i = 0; i < count; i++)
+    {
+        const GuiVertex *next = &points[(i + 1 < count) ? i + 1 : 0];
+        gui_drawLineRuns(points[i].x, points[i].y, next->x, next->y);
+    }
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+}
+
+/**
+ * @brief gui_drawFillPolygon
+ * scanline polygon filling with even-odd rule, convex and concave polygons up
+ * to GUI_POLYGON_MAX_POINTS points. Edges crossing each row are sorted and
+ * filled by pairs.
+ * @return 0 on success, -1 if the polygon has more than
+ * GUI_POLYGON_MAX_POINTS points, nothing is drawn
+ */
+int gui_drawFillPolygon(const GuiVertex *points, uint8_t count)
+{
+    int16_t nodes[GUI_POLYGON_MAX_POINTS];
+    int16_t xmin, xmax, ymin, ymax, row, node;
+    int32_t num, den;
+    uint8_t i, j, nodeCount;
+    const GuiVertex *a, *b, *swap;
+
+    if (count > GUI_POLYGON_MAX_POINTS)
+        return -1;
+    if (count < 3)
+        return 0;
+
+    xmin = xmax = points[0].x;
+    ymin = ymax = points[0].y;
+    for (i = 1; i < count; i++)
+    {
+        if (points[i].x < xmin)
+            xmin = points[i].x;
+        if (points[i].x > xmax)
+            xmax = points[i].x;
+        if (points[i].y < ymin)
+            ymin = points[i].y;
+        if (points[i].y > ymax)
+            ymax = points[i].y;
+    }
+    if (gui_clipReject(xmin, ymin, xmax, ymax))
+        return 0;
+
+    // only visible rows are scanned
+    if (ymin < _gui_clip.y1)
+        ymin = _gui_clip.y1;
+    if (ymax > _gui_clip.y2)
+        ymax = _gui_clip.y2;
+
+    for (row = ymin; row <= ymax; row++)
+    {
+        // edges crossing the row, half open [ya, yb[ to count vertices once
+        nodeCount = 0;
+        for (i = 0; i < count; i++)
+        {
+            a = &points[i];
+            b = &points[(i + 1 < count) ? i + 1 : 0];
+            if ((a->y <= row && b->y > row) || (b->y <= row && a->y > row))
+            {
+                // x of the edge from its top vertex, rounded with a floor
+                // division to round the same way on both sides of x = 0
+                if (a->y > b->y)
+                {
+                    swap = a;
+                    a = b;
+                    b = swap;
+                }
+                num = (int32_t)(row - a->y) * (b->x - a->x) * 2 + (b->y - a->y);
+                den = 2 * (b->y - a->y);
+                node = a->x + (int16_t)(num / den - (num % den < 0));
+
+                // insertion sort
+                j = nodeCount;
+                while (j > 0 && nodes[j - 1] > node)
+                {
+                    nodes[j] = nodes[j - 1];
+                    j--;
+                }
+                nodes[j] = node;
+                nodeCount++;
+            }
+        }
+
+        for (i = 0; i + 1 < nodeCount; i += 2)
+            gui_drawHSpan(nodes[i], nodes[i + 1], row, _gui_brushColor);
+    }
+    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+    return 0;
 }
 
 void gui_drawText(uint16_t x, uint16_t y, const char *txt)
@@ -191,15 +1361,16 @@ void gui_drawText(uint16_t x, uint16_t y, const char *txt)
 
 void gui_drawTextRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *txt, uint8_t flags)
 {
-    int16_t octet;
-    uint16_t i, j;
-    char bit;
+    int16_t i, glyphFrom, glyphTo, topRows, bottomRows;
+    uint16_t j, jFrom, jTo, width, bytes;
+    const uint8_t *data;
     const Letter *letter;
     const char *c;
     uint16_t text_width, xstartmargin, xendmargin;
-    uint16_t text_height, ystartmargin, yendmargin;
+    uint16_t text_height;
+    int16_t ystartmargin;   // negative if the text is higher than the rect
     uint16_t wcurrent;
-    uint8_t out_of_rect = 0;
+    GuiStream stream;
 
     if (_gui_font == NULL)
         return;
@@ -238,78 +1409,77 @@ void gui_drawTextRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char
     // height calculation
     text_height = gui_getFontHeight();
     if ((flags&0x0C) == GUI_FONT_ALIGN_HTOP)
-    {
         ystartmargin = 0;
-        yendmargin = h - text_height;
-    }
     else if ((flags&0x0C) == GUI_FONT_ALIGN_HBOTTOM)
-    {
-        ystartmargin = h - text_height;
-        yendmargin = 0;
-    }
+        ystartmargin = (int16_t)h - text_height;
     else
-    {
-        ystartmargin = (h - text_height)>>1;
-        yendmargin = h - text_height - ystartmargin;
-    }
+        ystartmargin = ((int16_t)h - text_height)>>1;
 
-    // windows text size
-    gui_ctrl_setRectScreen(x, y, w, h);
+    // windows text size, clipped
+    if (!gui_streamBegin(&stream, x, y, w, h))
+        return;
+
+    // rows of a glyph column clipped once for the whole text: visible rows of
+    // the top margin, of the glyph and of the bottom margin
+    glyphFrom = (stream.visible.y1 > ystartmargin) ? stream.visible.y1 - ystartmargin : 0;
+    glyphTo = (stream.visible.y2 < ystartmargin + text_height - 1) ? stream.visible.y2 - ystartmargin : text_height - 1;
+    topRows = ((ystartmargin < stream.visible.y2 + 1) ? ystartmargin : stream.visible.y2 + 1) - stream.visible.y1;
+    if (topRows < 0)
+        topRows = 0;
+    bottomRows = stream.visible.y2 + 1 - ((ystartmargin + text_height > stream.visible.y1) ? ystartmargin + text_height : stream.visible.y1);
+    if (bottomRows < 0)
+        bottomRows = 0;
+    bytes = (text_height + 7) >> 3;
 
     // xstartmargin
-    for (j = 0; j < xstartmargin; j++)
-        for (i = 0; i < h; i++)
-            gui_ctrl_write_data(_gui_brushColor);
+    gui_streamRepeat(&stream, _gui_brushColor, (uint32_t)xstartmargin * h);
 
-    // writting pixels chars
+    // writting pixels chars, glyph columns out of the clip rect are skipped
     c = txt;
     wcurrent = 0;
-    while ((*c != '\0') && (out_of_rect != 1) )
+    while (*c != '\0' && wcurrent < text_width && stream.col <= stream.visible.x2)
     {
         if (*c >= _gui_font->first && *c <= _gui_font->last)
         {
-            octet = -1;
             letter = _gui_font->letters[*c - _gui_font->first];
-            for (j = 0; j < letter->width; j++)
+            width = letter->width;
+            if (width > text_width - wcurrent)
+                width = text_width - wcurrent;
+
+            jFrom = (stream.col < stream.visible.x1) ? stream.visible.x1 - stream.col : 0;
+            jTo = (stream.col + width - 1 > stream.visible.x2) ? stream.visible.x2 - stream.col : width - 1;
+            for (j = jFrom; j <= jTo && j < width; j++)
             {
-                //verifying if wcurrent is out of rect
-                if ( wcurrent >= text_width )
+                data = (const uint8_t *)letter->data + j * bytes;
+                if (topRows > 0)
                 {
-                    out_of_rect = 1;
-                    break;
+                    gui_streamFlush(&stream);
+                    gui_ctrl_write_repeat(_gui_brushColor, topRows);
                 }
-
-                for (i = 0; i < ystartmargin; i++)
-                    gui_ctrl_write_data(_gui_brushColor);
-                for (i = 0; i < _gui_font->height; i++)
+                for (i = glyphFrom; i <= glyphTo; i++)
                 {
-                    if ((i&0x0007) == 0)
-                    {
-                        bit = 1;
-                        octet++;
-                    }
-                    if ((letter->data[octet]) & bit)
-                        gui_ctrl_write_data(_gui_penColor);
-                    else
-                        gui_ctrl_write_data(_gui_brushColor);
-                    bit = bit << 1;
+                    stream.burst[stream.idBurst++] = (data[i >> 3] & (1 << (i & 7))) ? _gui_penColor : _gui_brushColor;
+                    if (stream.idBurst == GUI_BURST_SIZE)
+                        gui_streamFlush(&stream);
+                }
+                if (bottomRows > 0)
+                {
+                    gui_streamFlush(&stream);
+                    gui_ctrl_write_repeat(_gui_brushColor, bottomRows);
                 }
-                for (i = 0; i < yendmargin; i++)
-                    gui_ctrl_write_data(_gui_brushColor);
-
-                wcurrent++;
             }
+            stream.col += width;
+            wcurrent += width;
         }
         c++;
     }
 
-    // xendmargin
-    for (j = 0; j < xendmargin; j++)
-        for (i = 0; i < h; i++)
-            gui_ctrl_write_data(_gui_brushColor);
+    // xendmargin, text_width columns are always filled
+    stream.col = xstartmargin + text_width;
+    gui_streamRepeat(&stream, _gui_brushColor, (uint32_t)xendmargin * h);
 
     // restore full draw screen
-    gui_ctrl_setRectScreen(0, 0, GUI_WIDTH, GUI_HEIGHT);
+    gui_streamEnd(&stream);
 }
 
 void gui_setFont(const Font *font)
@@ -41,6 +41,44 @@ void gui_drawLine(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
 void gui_drawRect(uint16_t x1, uint16_t y1, uint16_t w, uint16_t h);
 void gui_drawFillRect(uint16_t x1, uint16_t y1, uint16_t w, uint16_t h);
 
+// shapes paint, outlines with pen color, fills with brush color
+// angles are in degrees, counterclockwise from 3 o'clock
+typedef struct
+{
+    int16_t x;
+    int16_t y;
+} GuiVertex;
+// gui_drawFillPolygon draws nothing and returns -1 above this count of points
+#define GUI_POLYGON_MAX_POINTS 16
+
+void gui_drawCircle(uint16_t x, uint16_t y, uint16_t r);
+void gui_drawFillCircle(uint16_t x, uint16_t y, uint16_t r);
+void gui_drawEllipse(uint16_t x, uint16_t y, uint16_t rx, uint16_t ry);
+void gui_drawFillEllipse(uint16_t x, uint16_t y, uint16_t rx, uint16_t ry);
+void gui_drawArc(uint16_t x, uint16_t y, uint16_t r, int16_t startAngle, int16_t endAngle);
+void gui_drawFillArc(uint16_t x, uint16_t y, uint16_t rInner, uint16_t rOuter, int16_t startAngle, int16_t endAngle);
+void gui_drawRoundRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t r);
+void gui_drawFillRoundRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t r);
+void gui_drawPolygon(const GuiVertex *points, uint8_t count);
+int gui_drawFillPolygon(const GuiVertex *points, uint8_t count);
+
+// clipping, every primitive only paints the intersection of the pushed rects
+#define GUI_CLIP_STACK_SIZE 8
+int gui_pushClipRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+void gui_popClipRect(void);
+uint8_t gui_isRectVisible(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+// moves the content of the visible part of the rect dy pixels up, the dy
+// bottom rows keep their content. Returns 0 if the controller cannot, the
+// rect has to be repainted.
+uint8_t gui_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy);
+
+// screen pixels copy, w * h pixels buffer in column order (x major, y minor).
+// gui_readRect returns 0 if the controller cannot read back its memory,
+// gui_drawBuffer paints the buffer clipped like any other primitive.
+uint8_t gui_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer);
+void gui_drawBuffer(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t *buffer);
+
 // font support
 #define GUI_FONT_ALIGN_VLEFT     0x01   // |TXT        |
 #define GUI_FONT_ALIGN_VRIGHT    0x02   // |        TXT|
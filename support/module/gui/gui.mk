@@ -9,7 +9,7 @@ vpath %.h $(MODULEPATH)
 vpath %.h $(MODULEPATH)/screenController
 
 HEADER += gui.h
-SRC += gui.c widget.c
+SRC += gui.c widget.c console.c sprite.c
 SIM_SRC += gui_sim.c
 
 ########## SCREEN CONTROLER SUPPORT ##########
@@ -42,19 +42,25 @@ ifeq ($(ARCHI),$(filter $(ARCHI),pic24f pic24fj pic24ep pic24hj dspic30f dspic33
 endif
 
 ################ IMAGE SUPPORT ################
+# picture data format : raw, rle, qoi or auto (smallest)
+PICTURES_FORMAT ?= raw
+# transparency of pixels with alpha < 128 : none, key (PICTURES_KEY color) or mask
+PICTURES_TRANSPARENCY ?= none
+PICTURES_KEY ?= f81f
+
 # rule to build image to OUT_PWD/*.c
 $(OUT_PWD)/%.png.c : %.png $(OUT_PWD)/pictures.h $(IMG2RAW_EXE)
 	@test -d $(OUT_PWD) || mkdir -p $(OUT_PWD)
 	@printf "$(GREEN)IMG %-35s => %s$(NORM)\n" $(notdir $<) $(OUT_PWD)/$(notdir $@)
-	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@)
+	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@) -f $(PICTURES_FORMAT) -t $(PICTURES_TRANSPARENCY) -k $(PICTURES_KEY)
 $(OUT_PWD)/%.jpg.c : %.jpg $(OUT_PWD)/pictures.h $(IMG2RAW_EXE)
 	@test -d $(OUT_PWD) || mkdir -p $(OUT_PWD)
 	@printf "$(GREEN)IMG %-35s => %s$(NORM\n)" $(notdir $<) $(OUT_PWD)/$(notdir $@)
-	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@)
+	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@) -f $(PICTURES_FORMAT) -t $(PICTURES_TRANSPARENCY) -k $(PICTURES_KEY)
 $(OUT_PWD)/%.bmp.c : %.bmp $(OUT_PWD)/pictures.h $(IMG2RAW_EXE)
 	@test -d $(OUT_PWD) || mkdir -p $(OUT_PWD)
 	@printf "$(GREEN)IMG %-35s => %s$(NORM)\n" $(notdir $<) $(OUT_PWD)/$(notdir $@)
-	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@)
+	$(VERB)$(IMG2RAW_EXE) -i  $< -o  $(OUT_PWD)/$(notdir $@) -f $(PICTURES_FORMAT) -t $(PICTURES_TRANSPARENCY) -k $(PICTURES_KEY)
 
 # rule to build images *.<img>.c to OUT_PWD/*.o
 $(OUT_PWD)/%.o : $(OUT_PWD)/%.c
@@ -72,6 +78,23 @@ PICTURES_NAME := $(PICTURES_NAME:.bmp=)
 PICTURES_C := $(addprefix $(OUT_PWD)/, $(PICTURES_C))
 SRC += $(PICTURES_C)
 
+# whole directory of pictures, converted by one parallel img2raw call which
+# only regenerates changed images and writes pictures.h with a table of all
+# pictures, used instead of the PICTURES list
+# PICTURES_PACK also writes them to a binary asset pack for the assets module
+ifneq ($(PICTURES_DIR),)
+PICTURES_DIR_IMG := $(wildcard $(addprefix $(PICTURES_DIR)/*., png jpg jpeg bmp))
+PICTURES_DIR_C := $(addprefix $(OUT_PWD)/, $(addsuffix .c, $(notdir $(PICTURES_DIR_IMG))))
+SRC += $(PICTURES_DIR_C) $(OUT_PWD)/pictures_index.c
+
+$(OUT_PWD)/pictures.stamp : $(PICTURES_DIR_IMG) $(IMG2RAW_EXE) $(firstword $(MAKEFILE_LIST))
+	@test -d $(OUT_PWD) || mkdir -p $(OUT_PWD)
+	@printf "$(GREEN)IMG %-35s => %s$(NORM)\n" $(PICTURES_DIR) $(OUT_PWD)
+	$(VERB)$(IMG2RAW_EXE) -d $(PICTURES_DIR) -o $(OUT_PWD) -f $(PICTURES_FORMAT) -t $(PICTURES_TRANSPARENCY) -k $(PICTURES_KEY) $(if $(PICTURES_PACK),-p $(PICTURES_PACK))
+	@touch $@
+$(PICTURES_DIR_C) $(OUT_PWD)/pictures_index.c $(OUT_PWD)/pictures.h : $(OUT_PWD)/pictures.stamp ;
+.SECONDARY: $(PICTURES_DIR_C) $(OUT_PWD)/pictures_index.c
+else
 # generate list of used pictures
 $(OUT_PWD)/pictures.h: $(firstword $(MAKEFILE_LIST))
 	@test -d $(OUT_PWD) || mkdir -p $(OUT_PWD)
@@ -81,6 +104,7 @@ $(OUT_PWD)/pictures.h: $(firstword $(MAKEFILE_LIST))
 	$(foreach PICTURE,$(PICTURES_NAME),\nextern const Picture $(notdir $(PICTURE));)\n\n\
 	#endif //PICTURES_H\
 	" > $(OUT_PWD)/pictures.h
+endif
 CONFIG_HEADERS += $(OUT_PWD)/pictures.h
 
 ################ FONT SUPPORT ################
@@ -1,21 +1,157 @@
 #include "gui.h"
+#include "gui/sim.h"
 
 #include "board.h"
 #include "gui_sim.h"
 #include "simulator.h"
 #include <math.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "screenController/screenController.h"
 
-Color _gui_penColor;
-Color _gui_brushColor;
-uint16_t _gui_x, _gui_y;
-const Font *_gui_font;
-
 #define BUFFPIXSIZE 200
 uint16_t buffPix[BUFFPIXSIZE];
 int idPix = 0;
 
+// local copy of the screen, written in the same column order as the controller
+uint16_t gui_sim_screen[GUI_WIDTH * GUI_HEIGHT];
+GuiRect gui_sim_rect = {0, 0, GUI_WIDTH, GUI_HEIGHT};
+GuiPoint gui_sim_pos = {0, 0};
+
+// bus words of the d51e5ta7601 window and cursor commands
+#define GUI_SIM_SETRECT_WORDS 13
+#define GUI_SIM_SETPOS_WORDS  5
+
+GuiSimStats gui_sim_statsCount;
+uint8_t gui_sim_headless = 0;
+GuiSimModel gui_sim_model = GuiSimMirror;
+FILE *gui_sim_recordFile = NULL;
+
+void gui_sim_count(uint32_t pixels)
+{
+    gui_sim_statsCount.writes++;
+    gui_sim_statsCount.pixels += pixels;
+    gui_sim_statsCount.bytes += pixels * 2;
+}
+
+void gui_sim_storePixel(uint16_t data)
+{
+    if (gui_sim_pos.x < GUI_WIDTH && gui_sim_pos.y < GUI_HEIGHT)
+        gui_sim_screen[gui_sim_pos.y * GUI_WIDTH + gui_sim_pos.x] = data;
+
+    gui_sim_pos.y++;
+    if (gui_sim_pos.y >= gui_sim_rect.y + gui_sim_rect.height)
+    {
+        gui_sim_pos.y = gui_sim_rect.y;
+        gui_sim_pos.x++;
+        if (gui_sim_pos.x >= gui_sim_rect.x + gui_sim_rect.width)
+            gui_sim_pos.x = gui_sim_rect.x;
+    }
+}
+
+void gui_sim_resetStats(void)
+{
+    memset(&gui_sim_statsCount, 0, sizeof(gui_sim_statsCount));
+}
+
+const GuiSimStats *gui_sim_stats(void)
+{
+    return &gui_sim_statsCount;
+}
+
+void gui_sim_setHeadless(uint8_t headless)
+{
+    gui_sim_headless = headless;
+}
+
+void gui_sim_setModel(GuiSimModel model)
+{
+    gui_sim_model = model;
+}
+
+int gui_sim_record(const char *fileName)
+{
+    if (gui_sim_recordFile != NULL)
+    {
+        fclose(gui_sim_recordFile);
+        gui_sim_recordFile = NULL;
+    }
+    if (fileName == NULL)
+        return 0;
+
+    gui_sim_recordFile = fopen(fileName, "a");
+    if (gui_sim_recordFile == NULL)
+        return -1;
+    return 0;
+}
+
+void gui_sim_rgb(uint16_t color, uint8_t *rgb)
+{
+    if (GUI_COLOR_MODE == ColorModeMono)
+    {
+        rgb[0] = rgb[1] = rgb[2] = color ? 0xFF : 0x00;
+    }
+    else
+    {
+        rgb[0] = gui_red(color);
+        rgb[1] = gui_green(color);
+        rgb[2] = gui_blue(color);
+    }
+}
+
+int gui_sim_saveImage(const char *fileName)
+{
+    FILE *file;
+    uint32_t i;
+    uint8_t rgb[3];
+
+    file = fopen(fileName, "wb");
+    if (file == NULL)
+        return -1;
+
+    fprintf(file, "P6\n%d %d\n255\n", GUI_WIDTH, GUI_HEIGHT);
+    for (i = 0; i < (uint32_t)GUI_WIDTH * GUI_HEIGHT; i++)
+    {
+        gui_sim_rgb(gui_sim_screen[i], rgb);
+        fwrite(rgb, 1, 3, file);
+    }
+    fclose(file);
+    return 0;
+}
+
+int gui_sim_compareImage(const char *fileName)
+{
+    FILE *file;
+    uint32_t i;
+    int width, height, depth, diff = 0;
+    uint8_t rgb[3], ref[3];
+
+    file = fopen(fileName, "rb");
+    if (file == NULL)
+        return -1;
+
+    if (fscanf(file, "P6 %d %d %d", &width, &height, &depth) != 3 || fgetc(file) == EOF
+        || width != GUI_WIDTH || height != GUI_HEIGHT || depth != 255)
+    {
+        fclose(file);
+        return -1;
+    }
+    for (i = 0; i < (uint32_t)GUI_WIDTH * GUI_HEIGHT; i++)
+    {
+        if (fread(ref, 1, 3, file) != 3)
+        {
+            fclose(file);
+            return -1;
+        }
+        gui_sim_rgb(gui_sim_screen[i], rgb);
+        if (memcmp(rgb, ref, 3) != 0)
+            diff++;
+    }
+    fclose(file);
+    return diff;
+}
+
 void gui_ctrl_init(rt_dev_t dev)
 {
     GuiConfig config =
@@ -29,6 +165,11 @@ void gui_ctrl_init(rt_dev_t dev)
 
 void gui_ctrl_flush_data()
 {
+    if (gui_sim_headless)
+    {
+        idPix = 0;
+        return;
+    }
     simulator_send(GUI_SIM_MODULE, 0, GUI_SIM_WRITEDATA, (char*)buffPix, (idPix)*sizeof(uint16_t));
     idPix = 0;
 }
@@ -43,7 +184,15 @@ void gui_ctrl_setRectScreen(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
         .width = w,
         .height = h
     };
-    simulator_send(GUI_SIM_MODULE, 0, GUI_SIM_SETRECT, (char*)&rect, sizeof(GuiRect));
+    if (!gui_sim_headless)
+        simulator_send(GUI_SIM_MODULE, 0, GUI_SIM_SETRECT, (char*)&rect, sizeof(GuiRect));
+    gui_sim_statsCount.setRect++;
+    gui_sim_statsCount.bytes += GUI_SIM_SETRECT_WORDS * 2;
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "rect %d %d %d %d\n", x, y, w, h);
+    gui_sim_rect = rect;
+    gui_sim_pos.x = x;
+    gui_sim_pos.y = y;
 }
 
 void gui_ctrl_update()
@@ -58,18 +207,152 @@ void gui_ctrl_setPos(uint16_t x, uint16_t y)
         .x = x,
         .y = y
     };
-    simulator_send(GUI_SIM_MODULE, 0, GUI_SIM_SETPOS, (char*)&point, sizeof(GuiPoint));
+    if (!gui_sim_headless)
+        simulator_send(GUI_SIM_MODULE, 0, GUI_SIM_SETPOS, (char*)&point, sizeof(GuiPoint));
+    gui_sim_statsCount.setPos++;
+    gui_sim_statsCount.bytes += GUI_SIM_SETPOS_WORDS * 2;
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "pos %d %d\n", x, y);
+    gui_sim_pos = point;
 }
 
 void gui_ctrl_write_data(uint16_t data)
 {
+    gui_sim_count(1);
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "data %04x\n", data);
+
     buffPix[idPix] = data;
     idPix++;
+    gui_sim_storePixel(data);
 
     if(idPix == BUFFPIXSIZE)
 		gui_ctrl_flush_data();
 }
 
+void gui_ctrl_write_burst(const uint16_t *data, uint16_t size)
+{
+    uint16_t chunk;
+
+    gui_sim_count(size);
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "burst %d\n", size);
+    while (size > 0)
+    {
+        chunk = BUFFPIXSIZE - idPix;
+        if (chunk > size)
+            chunk = size;
+        memcpy(buffPix + idPix, data, chunk * sizeof(uint16_t));
+        idPix += chunk;
+        size -= chunk;
+        while (chunk-- > 0)
+            gui_sim_storePixel(*data++);
+
+        if(idPix == BUFFPIXSIZE)
+            gui_ctrl_flush_data();
+    }
+}
+
+void gui_ctrl_write_repeat(uint16_t data, uint32_t count)
+{
+    gui_sim_count(count);
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "repeat %04x %u\n", data, count);
+
+    while (count > 0)
+    {
+        buffPix[idPix] = data;
+        idPix++;
+        count--;
+        gui_sim_storePixel(data);
+
+        if(idPix == BUFFPIXSIZE)
+            gui_ctrl_flush_data();
+    }
+}
+
+/**
+ * @brief gui_ctrl_scrollRect
+ * moves the rect content in the local copy of the screen then sends the
+ * moved part to the simulator, fails as on the d51e5ta7601 when it is modeled
+ */
+uint8_t gui_ctrl_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy)
+{
+    uint16_t i, j;
+    GuiRect rect = gui_sim_rect;
+    GuiPoint pos = gui_sim_pos;
+    GuiSimStats stats;
+    FILE *recordFile = gui_sim_recordFile;
+
+    if (gui_sim_model == GuiSimD51e5ta7601)
+        return 0;
+    if (x >= GUI_WIDTH || y >= GUI_HEIGHT || dy == 0 || dy >= h)
+        return 1;
+    if (x + w > GUI_WIDTH)
+        w = GUI_WIDTH - x;
+    if (y + h > GUI_HEIGHT)
+        h = GUI_HEIGHT - y;
+    gui_sim_statsCount.scrolls++;
+    if (recordFile != NULL)
+        fprintf(recordFile, "scroll %d %d %d %d %d\n", x, y, w, h, dy);
+
+    // the refresh of the simulator is not a controller access
+    stats = gui_sim_statsCount;
+    gui_sim_recordFile = NULL;
+
+    for (j = y; j < y + h - dy; j++)
+        memcpy(gui_sim_screen + j * GUI_WIDTH + x, gui_sim_screen + (j + dy) * GUI_WIDTH + x, w * sizeof(uint16_t));
+
+    gui_ctrl_setRectScreen(x, y, w, h - dy);
+    for (i = x; i < x + w; i++)
+    {
+        for (j = y; j < y + h - dy; j++)
+        {
+            buffPix[idPix++] = gui_sim_screen[j * GUI_WIDTH + i];
+            if (idPix == BUFFPIXSIZE)
+                gui_ctrl_flush_data();
+        }
+    }
+    gui_ctrl_flush_data();
+
+    // restore the window
+    gui_ctrl_setRectScreen(rect.x, rect.y, rect.width, rect.height);
+    gui_ctrl_setPos(pos.x, pos.y);
+
+    gui_sim_statsCount = stats;
+    gui_sim_recordFile = recordFile;
+    return 1;
+}
+
+/**
+ * @brief gui_ctrl_readRect
+ * pixels are read from the local copy of the screen, fails as on the
+ * d51e5ta7601 when it is modeled
+ */
+uint8_t gui_ctrl_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer)
+{
+    uint16_t i, j;
+
+    if (gui_sim_model == GuiSimD51e5ta7601)
+        return 0;
+    gui_sim_statsCount.reads++;
+    gui_sim_statsCount.bytes += (uint32_t)w * h * 2;
+    if (gui_sim_recordFile != NULL)
+        fprintf(gui_sim_recordFile, "read %d %d %d %d\n", x, y, w, h);
+
+    for (i = x; i < x + w; i++)
+    {
+        for (j = y; j < y + h; j++)
+        {
+            if (i < GUI_WIDTH && j < GUI_HEIGHT)
+                *(buffer++) = gui_sim_screen[j * GUI_WIDTH + i];
+            else
+                *(buffer++) = 0;
+        }
+    }
+    return 1;
+}
+
 void gui_ctrl_drawPoint(uint16_t x, uint16_t y, uint16_t color)
 {
     gui_ctrl_setPos(x, y);
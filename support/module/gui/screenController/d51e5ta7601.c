@@ -59,6 +59,34 @@ void gui_ctrl_write_data(uint16_t data)
     SCREEN_CS = 1;
 }
 
+void gui_ctrl_write_burst(const uint16_t *data, uint16_t size)
+{
+    SCREEN_PORT_OUTPUT;
+    SCREEN_CS = 0;
+    while (size > 0)
+    {
+        SCREEN_PORT_OUT = *(data++);
+        SCREEN_RW = 0;
+        SCREEN_RW = 1;
+        size--;
+    }
+    SCREEN_CS = 1;
+}
+
+void gui_ctrl_write_repeat(uint16_t data, uint32_t count)
+{
+    SCREEN_PORT_OUTPUT;
+    SCREEN_CS = 0;
+    SCREEN_PORT_OUT = data;
+    while (count > 0)
+    {
+        SCREEN_RW = 0;
+        SCREEN_RW = 1;
+        count--;
+    }
+    SCREEN_CS = 1;
+}
+
 uint16_t gui_ctrl_read_data()
 {
     uint16_t data;
@@ -167,6 +195,18 @@ void gui_ctrl_setPos(uint16_t x, uint16_t y)
     gui_ctrl_write_command(0x22);
 }
 
+uint8_t gui_ctrl_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy)
+{
+    // no partial hardware scroll, GRAM read back too slow to move a rect
+    return 0;
+}
+
+uint8_t gui_ctrl_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer)
+{
+    // GRAM read back not wired on the parallel bus
+    return 0;
+}
+
 void gui_ctrl_drawPoint(uint16_t x, uint16_t y, uint16_t color)
 {
     //uint16_t data;
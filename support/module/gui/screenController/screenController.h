@@ -24,10 +24,16 @@
 
 void gui_ctrl_init(rt_dev_t dev);
 void gui_ctrl_write_data(uint16_t data);
+void gui_ctrl_write_burst(const uint16_t *data, uint16_t size);
+void gui_ctrl_write_repeat(uint16_t data, uint32_t count);
 //uint16_t gui_ctrl_read_data();
 void gui_ctrl_setRectScreen(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 void gui_ctrl_setPos(uint16_t x, uint16_t y);
 void gui_ctrl_drawPoint(uint16_t x, uint16_t y, uint16_t color);
+// moves the rect content dy pixels up, returns 0 if the controller cannot
+uint8_t gui_ctrl_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy);
+// copies the rect pixels in column order, returns 0 if the controller cannot
+uint8_t gui_ctrl_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer);
 void gui_ctrl_update();
 
 #endif // SCREENCONTROLLER_H
\ No newline at end of file
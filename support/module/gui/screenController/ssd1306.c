@@ -18,6 +18,13 @@
 
 uint8_t ssd1306_pixels[128 * 64 / 8];
 
+// dirty columns of each page, one bit per column
+uint8_t ssd1306_dirty[8][128 / 8];
+
+// dirty runs separated by less than this count of clean columns are sent in
+// one transfer, cheaper than a new window command
+#define SSD1306_DIRTY_GAP 8
+
 // current pos
 uint16_t ssd1306_x, ssd1306_y;
 
@@ -27,14 +34,135 @@ uint16_t ssd1306_recty, ssd1306_recth;
 
 rt_dev_t i2c_screenbus;
 
+// internal functions
+void ssd1306_setWindow(uint8_t x1, uint8_t x2, uint8_t page1, uint8_t page2);
+void ssd1306_markDirty(uint16_t x, uint16_t y1, uint16_t y2);
+uint8_t ssd1306_dirtyRun(uint8_t page, uint8_t from, uint8_t *x1, uint8_t *x2);
+void ssd1306_fillColumn(uint16_t x, uint16_t y, uint16_t count, uint16_t color);
+uint16_t ssd1306_columnLeft();
+void ssd1306_advance(uint16_t count);
+
 void gui_ctrl_write_command(uint8_t cmd)
 {
     i2c_writereg(i2c_screenbus, OLED_I2C_ADDR, 0, cmd, 0);
 }
 
-void ssd1306_increment()
+/**
+ * @brief ssd1306_setWindow
+ * column and page addresses window, commands sent in one transfer
+ */
+void ssd1306_setWindow(uint8_t x1, uint8_t x2, uint8_t page1, uint8_t page2)
+{
+    uint8_t cmds[6];
+    cmds[0] = 0x21;
+    cmds[1] = x1; // column
+    cmds[2] = x2; // column
+    cmds[3] = 0x22;
+    cmds[4] = page1; // page
+    cmds[5] = page2; // page
+    i2c_writeregs(i2c_screenbus, OLED_I2C_ADDR, 0, cmds, 6, 0);
+}
+
+void ssd1306_markDirty(uint16_t x, uint16_t y1, uint16_t y2)
+{
+    uint8_t page;
+    for (page = y1 >> 3; page <= (y2 >> 3); page++)
+        ssd1306_dirty[page][x >> 3] |= 1 << (x & 0x07);
+}
+
+/**
+ * @brief ssd1306_dirtyRun
+ * next dirty columns run of the page starting at from, small clean gaps are
+ * merged in the run
+ * @return 0 if no dirty column left
+ */
+uint8_t ssd1306_dirtyRun(uint8_t page, uint8_t from, uint8_t *x1, uint8_t *x2)
+{
+    uint8_t *dirty = ssd1306_dirty[page];
+    uint16_t x = from, gap;
+
+    // first dirty column, whole clean bytes skipped
+    while (x < 128 && (dirty[x >> 3] & (1 << (x & 0x07))) == 0)
+        x += ((x & 0x07) == 0 && dirty[x >> 3] == 0) ? 8 : 1;
+    if (x >= 128)
+        return 0;
+    *x1 = x;
+
+    gap = 0;
+    for (; x < 128 && gap < SSD1306_DIRTY_GAP; x++)
+    {
+        if (dirty[x >> 3] & (1 << (x & 0x07)))
+        {
+            *x2 = x;
+            gap = 0;
+        }
+        else
+            gap++;
+    }
+    return 1;
+}
+
+void gui_ctrl_update()
+{
+    uint8_t page, pageEnd, x1, x2, from;
+
+    for (page = 0; page < 8; page = pageEnd + 1)
+    {
+        pageEnd = page;
+        from = 0;
+        while (from < 128 && ssd1306_dirtyRun(page, from, &x1, &x2))
+        {
+            if (x1 == 0 && x2 == 127)
+            {
+                // full width pages are contiguous in memory, one transfer for all
+                while (pageEnd < 7 && ssd1306_dirtyRun(pageEnd + 1, 0, &x1, &x2) && x1 == 0 && x2 == 127)
+                    pageEnd++;
+                x1 = 0;
+                x2 = 127;
+            }
+            ssd1306_setWindow(x1, x2, page, pageEnd);
+            i2c_writeregs(i2c_screenbus, OLED_I2C_ADDR, 0x40, ssd1306_pixels + (page << 7) + x1,
+                          (uint16_t)(x2 - x1 + 1) * (pageEnd - page + 1), 0);
+            from = x2 + 1;
+        }
+    }
+    memset(ssd1306_dirty, 0, sizeof(ssd1306_dirty));
+}
+
+/**
+ * @brief ssd1306_fillColumn
+ * sets count pixels of column x from y, whole bytes written at once
+ */
+void ssd1306_fillColumn(uint16_t x, uint16_t y, uint16_t count, uint16_t color)
+{
+    uint8_t *pix = ssd1306_pixels + ((y & 0xF8) << 4) + x;
+    uint8_t mask, bits;
+
+    ssd1306_markDirty(x, y, y + count - 1);
+    while (count > 0)
+    {
+        bits = 8 - (y & 0x07);
+        if (bits > count)
+            bits = count;
+        mask = (uint8_t)(0xFF >> (8 - bits)) << (y & 0x07);
+        if (color == 0)
+            *pix &= ~mask;
+        else
+            *pix |= mask;
+        count -= bits;
+        y += bits;
+        pix += 128;
+    }
+}
+
+uint16_t ssd1306_columnLeft()
 {
-    ssd1306_y++;
+    return ssd1306_recty + ssd1306_recth - ssd1306_y;
+}
+
+void ssd1306_advance(uint16_t count)
+{
+    ssd1306_y += count;
     if (ssd1306_y >= ssd1306_recty + ssd1306_recth)
     {
         ssd1306_y = ssd1306_recty;
@@ -46,28 +174,57 @@ void ssd1306_increment()
 
 void gui_ctrl_write_data(uint16_t data)
 {
-    gui_ctrl_drawPoint(ssd1306_x, ssd1306_y, data);
-    ssd1306_increment();
+    ssd1306_fillColumn(ssd1306_x, ssd1306_y, 1, data);
+    ssd1306_advance(1);
 }
 
-void gui_ctrl_update()
+void gui_ctrl_write_burst(const uint16_t *data, uint16_t size)
 {
-    uint16_t i;
     uint8_t *pix;
+    uint8_t bit;
+    uint16_t count;
 
-    gui_ctrl_write_command(0x21);
-    gui_ctrl_write_command(0); // column
-    gui_ctrl_write_command(127); // column
+    while (size > 0)
+    {
+        // column part of the window, bits set through a walking mask
+        count = ssd1306_columnLeft();
+        if (count > size)
+            count = size;
+        ssd1306_markDirty(ssd1306_x, ssd1306_y, ssd1306_y + count - 1);
+        pix = ssd1306_pixels + ((ssd1306_y & 0xF8) << 4) + ssd1306_x;
+        bit = 1 << (ssd1306_y & 0x07);
+        ssd1306_advance(count);
+        size -= count;
+
+        while (count > 0)
+        {
+            if (*(data++) == 0)
+                *pix &= ~bit;
+            else
+                *pix |= bit;
+            bit <<= 1;
+            if (bit == 0)
+            {
+                bit = 1;
+                pix += 128;
+            }
+            count--;
+        }
+    }
+}
 
-    gui_ctrl_write_command(0x22);
-    gui_ctrl_write_command(0); // page
-    gui_ctrl_write_command(7); // page
+void gui_ctrl_write_repeat(uint16_t data, uint32_t count)
+{
+    uint16_t n;
 
-    pix = ssd1306_pixels;
-    for(i=0; i<128; i++)
+    while (count > 0)
     {
-        i2c_writeregs(i2c_screenbus, OLED_I2C_ADDR, 0x40, pix, 8, 0);
-        pix += 8;
+        n = ssd1306_columnLeft();
+        if (n > count)
+            n = count;
+        ssd1306_fillColumn(ssd1306_x, ssd1306_y, n, data);
+        ssd1306_advance(n);
+        count -= n;
     }
 }
 
@@ -128,6 +285,7 @@ void gui_ctrl_init(rt_dev_t dev)
 
     // clear screen
     memset(ssd1306_pixels, 0, 128 * 64 / 8);
+    memset(ssd1306_dirty, 0xFF, sizeof(ssd1306_dirty));
     gui_ctrl_update();
 }
 
@@ -171,19 +329,64 @@ void gui_ctrl_setPos(uint16_t x, uint16_t y)
 
 void gui_ctrl_drawPoint(uint16_t x, uint16_t y, uint16_t color)
 {
-    uint8_t *pix;
-    int id;
-
-    if(x > 127 || y > 64)
+    if(x > 127 || y > 63)
         return;
 
-    id = ((y & 0xF8) << 4);
-    id += x;
-    pix = ssd1306_pixels + id;
+    ssd1306_fillColumn(x, y, 1, color);
+}
 
-    if (color == 0)
-        *pix &= ~(1 << (y & 0x07));
-    else
-        *pix |= 1 << (y & 0x07);
+uint8_t gui_ctrl_scrollRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dy)
+{
+    uint16_t i, j, src, dst;
+    uint8_t *column;
+
+    if (x >= GUI_WIDTH || y >= GUI_HEIGHT || dy == 0 || dy >= h)
+        return 1;
+    if (x + w > GUI_WIDTH)
+        w = GUI_WIDTH - x;
+    if (y + h > GUI_HEIGHT)
+        h = GUI_HEIGHT - y;
+
+    for (i = x; i < x + w; i++)
+    {
+        ssd1306_markDirty(i, y, y + h - 1);
+        column = ssd1306_pixels + i;
+        if (((y | h | dy) & 0x07) == 0)
+        {
+            // page aligned, whole bytes moved
+            for (j = y >> 3; j < ((y + h - dy) >> 3); j++)
+                column[j << 7] = column[(j + (dy >> 3)) << 7];
+            continue;
+        }
+        for (dst = y, src = y + dy; src < y + h; dst++, src++)
+        {
+            if (column[(src & 0xF8) << 4] & (1 << (src & 0x07)))
+                column[(dst & 0xF8) << 4] |= 1 << (dst & 0x07);
+            else
+                column[(dst & 0xF8) << 4] &= ~(1 << (dst & 0x07));
+        }
+    }
+    return 1;
 }
 
+/**
+ * @brief gui_ctrl_readRect
+ * pixels are read from the RAM copy of the screen, white if set, pixels out
+ * of the screen are black
+ */
+uint8_t gui_ctrl_readRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t *buffer)
+{
+    uint16_t i, j;
+
+    for (i = x; i < x + w; i++)
+    {
+        for (j = y; j < y + h; j++)
+        {
+            if (i < GUI_WIDTH && j < GUI_HEIGHT && (ssd1306_pixels[((j & 0xF8) << 4) + i] & (1 << (j & 0x07))))
+                *(buffer++) = 0xFFFF;
+            else
+                *(buffer++) = 0x0000;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file sprite.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Moving pictures with background restore for gui module
+ *
+ * Before a sprite is drawn, the screen pixels under it are read back into the
+ * save-under buffer and written back when it moves or hides. Controllers
+ * without read back restore the background picture clipped to the sprite
+ * rect, or fill it with the background color.
+ */
+
+#include <module/gui.h>
+#include <gui/sprite.h>
+
+// internal functions
+void sprite_restore(Sprite *sprite);
+void sprite_draw(Sprite *sprite);
+
+void sprite_init(Sprite *sprite, const Picture *picture, uint16_t *saveUnder)
+{
+    sprite->picture = picture;
+    sprite->x = 0;
+    sprite->y = 0;
+    sprite->shown = 0;
+    sprite->saveUnder = saveUnder;
+    sprite->saved = 0;
+    sprite->background = NULL;
+    sprite->bgX = 0;
+    sprite->bgY = 0;
+    sprite->bgColor = gui_brushColor();
+}
+
+void sprite_setBackground(Sprite *sprite, const Picture *background, uint16_t x, uint16_t y)
+{
+    sprite->background = background;
+    sprite->bgX = x;
+    sprite->bgY = y;
+}
+
+void sprite_setBackgroundColor(Sprite *sprite, Color color)
+{
+    sprite->bgColor = color;
+}
+
+void sprite_setPicture(Sprite *sprite, const Picture *picture)
+{
+    if (sprite->picture == picture)
+        return;
+    if (!sprite->shown)
+    {
+        sprite->picture = picture;
+        return;
+    }
+    sprite_restore(sprite);
+    sprite->picture = picture;
+    sprite_draw(sprite);
+}
+
+void sprite_show(Sprite *sprite, uint16_t x, uint16_t y)
+{
+    if (sprite->shown)
+    {
+        if (sprite->x == x && sprite->y == y)
+            return;
+        sprite_restore(sprite);
+    }
+    sprite->x = x;
+    sprite->y = y;
+    sprite->shown = 1;
+    sprite_draw(sprite);
+}
+
+void sprite_hide(Sprite *sprite)
+{
+    if (!sprite->shown)
+        return;
+    sprite_restore(sprite);
+    sprite->shown = 0;
+}
+
+/**
+ * @brief sprite_restore
+ * paints back the background of the sprite rect. The background picture is
+ * clipped to the sprite rect, or painted whole if the clip stack is full.
+ */
+void sprite_restore(Sprite *sprite)
+{
+    const Picture *pic = sprite->picture;
+    Color brushColor;
+    uint8_t clipped;
+
+    if (sprite->saved)
+    {
+        gui_drawBuffer(sprite->x, sprite->y, pic->width, pic->height, sprite->saveUnder);
+        sprite->saved = 0;
+        return;
+    }
+
+    if (sprite->background == NULL)
+    {
+        brushColor = gui_brushColor();
+        gui_setBrushColor(sprite->bgColor);
+        gui_drawFillRect(sprite->x, sprite->y, pic->width, pic->height);
+        gui_setBrushColor(brushColor);
+        return;
+    }
+
+    clipped = (gui_pushClipRect(sprite->x, sprite->y, pic->width, pic->height) == 0);
+    gui_dispImage(sprite->bgX, sprite->bgY, sprite->background);
+    if (clipped)
+        gui_popClipRect();
+}
+
+/**
+ * @brief sprite_draw
+ * saves the pixels under the sprite then draws it, transparent pixels are
+ * not sent to the controller
+ */
+void sprite_draw(Sprite *sprite)
+{
+    const Picture *pic = sprite->picture;
+
+    if (sprite->saveUnder != NULL)
+        sprite->saved = gui_readRect(sprite->x, sprite->y, pic->width, pic->height, sprite->saveUnder);
+    gui_dispImage(sprite->x, sprite->y, pic);
+}
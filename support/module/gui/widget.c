@@ -6,16 +6,37 @@
  * @date November 06, 2016, 22:16 PM
  *
  * @brief Widget structure for gui module
+ *
+ * Widgets are retained in a static pool in creation order, which is also the
+ * painting order: a parent is always painted before its children. Setters
+ * only mark changed widgets dirty, widget_update() then repaints dirty
+ * widgets, each one clipped to its own rect, and the widgets painted over
+ * them.
  */
 
 #include <module/gui.h>
 #include <gui/widget.h>
 
-#define WIDGET_COUNT 25
+#include <string.h>
+
 Widget widgets[WIDGET_COUNT];
+Color widget_background = 0;
+
+// area uncovered by hidden widgets, repainted with widget_background
+uint16_t widget_damageX1, widget_damageY1, widget_damageX2, widget_damageY2;
+uint8_t widget_damaged = 0;
 
 // internal functions
+Widget *widget_add(uint8_t type, Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+void widget_damage(Widget *widget);
+uint8_t widget_isShown(Widget *widget);
+uint8_t widget_overlap(Widget *widget, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2);
+uint8_t widget_pushClip(Widget *widget);
 void widget_draw(Widget *widget);
+void widget_drawButton(Widget *widget);
+void widget_drawSlider(Widget *widget);
+void widget_drawBarGraph(Widget *widget);
+uint16_t widget_valuePos(Widget *widget, uint16_t length);
 
 void widget_init()
 {
@@ -24,51 +45,469 @@ void widget_init()
     {
         widgets[i].type = 0;
     }
+    widget_damaged = 0;
+}
+
+void widget_setBackground(Color color)
+{
+    widget_background = color;
 }
 
-void widget_addButton(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+Widget *widget_add(uint8_t type, Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
     int i;
+    Widget *widget;
     for(i=0; i<WIDGET_COUNT; i++)
     {
         if(widgets[i].type == 0)
             break;
     }
     if(i==WIDGET_COUNT)
+        return NULL;
+
+    widget = &widgets[i];
+    memset(widget, 0, sizeof(Widget));
+    widget->type = type;
+    widget->flags = WIDGET_FLAG_DIRTY;
+    widget->parent = parent;
+    widget->x = x;
+    widget->y = y;
+    if (parent != NULL)
+    {
+        widget->x += parent->x;
+        widget->y += parent->y;
+    }
+    widget->w = w;
+    widget->h = h;
+    widget->fgColor = gui_penColor();
+    widget->bgColor = gui_brushColor();
+    widget->textAlign = GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE;
+
+    return widget;
+}
+
+Widget *widget_addPanel(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+    return widget_add(WIDGET_TYPE_PANEL, parent, x, y, w, h);
+}
+
+Widget *widget_addLabel(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text)
+{
+    Widget *widget = widget_add(WIDGET_TYPE_LABEL, parent, x, y, w, h);
+    if (widget != NULL)
+        widget_setText(widget, text);
+    return widget;
+}
+
+Widget *widget_addButton(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, const char *text)
+{
+    Widget *widget = widget_add(WIDGET_TYPE_BUTTON, parent, x, y, w, h);
+    if (widget != NULL)
+        widget_setText(widget, text);
+    return widget;
+}
+
+Widget *widget_addImage(Widget *parent, uint16_t x, uint16_t y, const Picture *picture)
+{
+    Widget *widget = widget_add(WIDGET_TYPE_IMAGE, parent, x, y, picture->width, picture->height);
+    if (widget != NULL)
+        widget->picture = picture;
+    return widget;
+}
+
+Widget *widget_addSlider(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t min, int16_t max)
+{
+    Widget *widget = widget_add(WIDGET_TYPE_SLIDER, parent, x, y, w, h);
+    if (widget != NULL)
+    {
+        widget->min = min;
+        widget->max = max;
+        widget->value = min;
+        if (h > w)
+            widget->flags |= WIDGET_FLAG_VERTICAL;
+    }
+    return widget;
+}
+
+Widget *widget_addBarGraph(Widget *parent, uint16_t x, uint16_t y, uint16_t w, uint16_t h, int16_t min, int16_t max)
+{
+    Widget *widget = widget_add(WIDGET_TYPE_BARGRAPH, parent, x, y, w, h);
+    if (widget != NULL)
+    {
+        widget->min = min;
+        widget->max = max;
+        widget->value = min;
+        if (h > w)
+            widget->flags |= WIDGET_FLAG_VERTICAL;
+    }
+    return widget;
+}
+
+void widget_setText(Widget *widget, const char *text)
+{
+    if (strncmp(widget->text, text, WIDGET_TEXT_SIZE - 1) == 0)
         return;
+    strncpy(widget->text, text, WIDGET_TEXT_SIZE - 1);
+    widget->text[WIDGET_TEXT_SIZE - 1] = '\0';
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
 
-    widgets[i].type = WIDGET_TYPE_BUTTON;
-    widgets[i].x = x;
-    widgets[i].y = y;
-    widgets[i].w = w;
-    widgets[i].h = h;
+void widget_setTextAlign(Widget *widget, uint8_t flags)
+{
+    if (widget->textAlign == flags)
+        return;
+    widget->textAlign = flags;
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
+
+void widget_setValue(Widget *widget, int16_t value)
+{
+    if (value < widget->min)
+        value = widget->min;
+    if (value > widget->max)
+        value = widget->max;
+    if (widget->value == value)
+        return;
+    widget->value = value;
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
+
+void widget_setPicture(Widget *widget, const Picture *picture)
+{
+    uint8_t transparent = (picture->transparency != PictureTransparencyNone);
+
+    if (widget->picture == picture)
+        return;
+    // the area not covered by the new picture is repainted with what is under
+    // the widget, as the pixels under the transparent ones of the new picture
+    if (transparent || picture->width < widget->w || picture->height < widget->h)
+        widget_damage(widget);
+    widget->picture = picture;
+    widget->w = picture->width;
+    widget->h = picture->height;
+    if (transparent)
+        widget_damage(widget);
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
+
+void widget_setColors(Widget *widget, Color fgColor, Color bgColor)
+{
+    if (widget->fgColor == fgColor && widget->bgColor == bgColor)
+        return;
+    widget->fgColor = fgColor;
+    widget->bgColor = bgColor;
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
+
+void widget_setFlag(Widget *widget, uint8_t flag, uint8_t enable)
+{
+    uint8_t flags = enable ? (widget->flags | flag) : (widget->flags & ~flag);
+    if (flags == widget->flags)
+        return;
+    widget->flags = flags | WIDGET_FLAG_DIRTY;
+}
+
+void widget_setVisible(Widget *widget, uint8_t visible)
+{
+    if (visible)
+    {
+        if ((widget->flags & WIDGET_FLAG_HIDDEN) == 0)
+            return;
+        widget->flags = (widget->flags & ~WIDGET_FLAG_HIDDEN) | WIDGET_FLAG_DIRTY;
+    }
+    else
+    {
+        if (widget->flags & WIDGET_FLAG_HIDDEN)
+            return;
+        widget->flags |= WIDGET_FLAG_HIDDEN;
+        widget_damage(widget);
+    }
+}
+
+void widget_setCallback(Widget *widget, void (*action_callback)(Widget *widget))
+{
+    widget->action_callback = action_callback;
+}
 
-    widget_draw(&widgets[i]);
+void widget_invalidate(Widget *widget)
+{
+    widget->flags |= WIDGET_FLAG_DIRTY;
+}
+
+/**
+ * @brief widget_damage
+ * adds the widget area to the area to repaint with the background
+ */
+void widget_damage(Widget *widget)
+{
+    uint16_t x2 = widget->x + widget->w - 1, y2 = widget->y + widget->h - 1;
+    if (widget->w == 0 || widget->h == 0)
+        return;
+    if (!widget_damaged)
+    {
+        widget_damageX1 = widget->x;
+        widget_damageY1 = widget->y;
+        widget_damageX2 = x2;
+        widget_damageY2 = y2;
+        widget_damaged = 1;
+        return;
+    }
+    if (widget->x < widget_damageX1)
+        widget_damageX1 = widget->x;
+    if (widget->y < widget_damageY1)
+        widget_damageY1 = widget->y;
+    if (x2 > widget_damageX2)
+        widget_damageX2 = x2;
+    if (y2 > widget_damageY2)
+        widget_damageY2 = y2;
+}
+
+uint8_t widget_isShown(Widget *widget)
+{
+    while (widget != NULL)
+    {
+        if (widget->flags & WIDGET_FLAG_HIDDEN)
+            return 0;
+        widget = widget->parent;
+    }
+    return 1;
+}
+
+uint8_t widget_overlap(Widget *widget, uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2)
+{
+    if (widget->w == 0 || widget->h == 0)
+        return 0;
+    return !(widget->x > x2 || widget->y > y2
+             || widget->x + widget->w - 1 < x1 || widget->y + widget->h - 1 < y1);
+}
+
+/**
+ * @brief widget_pushClip
+ * clips drawing to the widget rect and the rects of its parents
+ * @return number of pushed clip rects
+ */
+uint8_t widget_pushClip(Widget *widget)
+{
+    uint8_t count = 0;
+    if (widget->parent != NULL)
+        count = widget_pushClip(widget->parent);
+    if (gui_pushClipRect(widget->x, widget->y, widget->w, widget->h) == 0)
+        count++;
+    return count;
+}
+
+/**
+ * @brief widget_update
+ * repaints dirty widgets and the widgets over them, nothing is sent to the
+ * screen if no widget state changed
+ * @return number of paint operations, 0 if the screen is unchanged
+ */
+uint8_t widget_update()
+{
+    int i, j;
+    uint8_t count = 0, clips;
+    Widget *widget;
+    Color penColor = gui_penColor(), brushColor = gui_brushColor();
+
+    if (widget_damaged)
+    {
+        gui_pushClipRect(widget_damageX1, widget_damageY1,
+                         widget_damageX2 - widget_damageX1 + 1, widget_damageY2 - widget_damageY1 + 1);
+        gui_fillScreen(widget_background);
+        gui_popClipRect();
+        for(i=0; i<WIDGET_COUNT; i++)
+        {
+            if (widgets[i].type != 0 && widget_overlap(&widgets[i], widget_damageX1, widget_damageY1, widget_damageX2, widget_damageY2))
+                widgets[i].flags |= WIDGET_FLAG_DIRTY;
+        }
+        widget_damaged = 0;
+        count++;
+    }
+
+    for(i=0; i<WIDGET_COUNT; i++)
+    {
+        widget = &widgets[i];
+        if (widget->type == 0 || (widget->flags & WIDGET_FLAG_DIRTY) == 0)
+            continue;
+        widget->flags &= ~WIDGET_FLAG_DIRTY;
+        if (!widget_isShown(widget))
+            continue;
+
+        // widgets painted after this one and overlapping it have to be repainted
+        for(j=i+1; j<WIDGET_COUNT; j++)
+        {
+            if (widgets[j].type != 0 && widget_overlap(&widgets[j], widget->x, widget->y,
+                                                       widget->x + widget->w - 1, widget->y + widget->h - 1))
+                widgets[j].flags |= WIDGET_FLAG_DIRTY;
+        }
+
+        clips = widget_pushClip(widget);
+        widget_draw(widget);
+        while (clips-- > 0)
+            gui_popClipRect();
+        count++;
+    }
+
+    gui_setPenColor(penColor);
+    gui_setBrushColor(brushColor);
+    return count;
+}
+
+/**
+ * @brief widget_click
+ * finds the top most shown widget at (x, y) with a callback, moves sliders
+ * to the clicked value, and calls the callback
+ * @return clicked widget or NULL
+ */
+Widget *widget_click(uint16_t x, uint16_t y)
+{
+    int i;
+    Widget *widget;
+    int32_t value;
+
+    for(i=WIDGET_COUNT-1; i>=0; i--)
+    {
+        widget = &widgets[i];
+        if (widget->type == 0 || widget->action_callback == NULL)
+            continue;
+        if (!widget_overlap(widget, x, y, x, y) || !widget_isShown(widget))
+            continue;
+
+        if (widget->type == WIDGET_TYPE_SLIDER && widget->max > widget->min)
+        {
+            if (widget->flags & WIDGET_FLAG_VERTICAL)
+                value = (int32_t)(widget->y + widget->h - 1 - y) * (widget->max - widget->min) / (widget->h > 1 ? widget->h - 1 : 1);
+            else
+                value = (int32_t)(x - widget->x) * (widget->max - widget->min) / (widget->w > 1 ? widget->w - 1 : 1);
+            widget_setValue(widget, widget->min + value);
+        }
+        widget->action_callback(widget);
+        return widget;
+    }
+    return NULL;
+}
+
+/**
+ * @brief widget_valuePos
+ * position of the value in pixels, from 0 (min) to length (max)
+ */
+uint16_t widget_valuePos(Widget *widget, uint16_t length)
+{
+    if (widget->max <= widget->min)
+        return 0;
+    return (int32_t)(widget->value - widget->min) * length / (widget->max - widget->min);
 }
 
 void widget_draw(Widget *widget)
 {
-    if(widget->type == WIDGET_TYPE_BUTTON)
+    gui_setPenColor(widget->fgColor);
+    gui_setBrushColor(widget->bgColor);
+
+    switch (widget->type)
     {
-        gui_setPenColor(Gui_Black);
-        gui_setBrushColor(Gui_Gray2);
-        gui_drawTextRect(widget->x + 2, widget->y + 2, widget->w - 2, widget->h - 2, "OK", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
+    case WIDGET_TYPE_LABEL:
+        gui_drawTextRect(widget->x, widget->y, widget->w, widget->h, widget->text, widget->textAlign);
+        break;
+    case WIDGET_TYPE_BUTTON:
+        widget_drawButton(widget);
+        break;
+    case WIDGET_TYPE_IMAGE:
+        if (widget->picture != NULL)
+            gui_dispImage(widget->x, widget->y, widget->picture);
+        break;
+    case WIDGET_TYPE_SLIDER:
+        widget_drawSlider(widget);
+        break;
+    case WIDGET_TYPE_BARGRAPH:
+        widget_drawBarGraph(widget);
+        break;
+    case WIDGET_TYPE_PANEL:
+        gui_drawFillRect(widget->x, widget->y, widget->w, widget->h);
+        if (widget->flags & WIDGET_FLAG_BORDER)
+            gui_drawRect(widget->x, widget->y, widget->w - 1, widget->h - 1);
+        break;
+    }
+}
 
-        gui_setPenColor(Gui_Gray3);
-        gui_drawLine(widget->x, widget->y, widget->x + widget->w, widget->y);
-        gui_drawLine(widget->x, widget->y+1, widget->x + widget->w-1, widget->y+1);
-        gui_drawLine(widget->x, widget->y, widget->x, widget->y + widget->h - 1);
-        gui_drawLine(widget->x+1, widget->y, widget->x+1, widget->y + widget->h-1);
-        gui_drawLine(widget->x+2, widget->y, widget->x+2, widget->y + widget->h-2);
+void widget_drawButton(Widget *widget)
+{
+    Color light = Gui_Gray3, dark = Gui_Gray1, swap;
 
-        gui_setPenColor(Gui_Gray1);
-        gui_drawLine(widget->x, widget->y + widget->h    , widget->x + widget->w, widget->y + widget->h    );
-        gui_drawLine(widget->x, widget->y + widget->h - 1, widget->x + widget->w, widget->y + widget->h - 1);
+    if (widget->flags & WIDGET_FLAG_PRESSED)
+    {
+        swap = light;
+        light = dark;
+        dark = swap;
+    }
 
-        gui_drawLine(widget->x + widget->w    , widget->y, widget->x + widget->w    , widget->y + widget->h);
-        gui_drawLine(widget->x + widget->w - 1, widget->y, widget->x + widget->w - 1, widget->y + widget->h);
-        gui_drawLine(widget->x + widget->w - 2, widget->y, widget->x + widget->w - 2, widget->y + widget->h);
+    // text in the bevel
+    gui_drawTextRect(widget->x + 3, widget->y + 2, widget->w - 6, widget->h - 4, widget->text, widget->textAlign);
 
-        return;
+    gui_setBrushColor(light);
+    gui_drawFillRect(widget->x, widget->y, widget->w, 2);
+    gui_drawFillRect(widget->x, widget->y + 2, 3, widget->h - 2);
+
+    gui_setBrushColor(dark);
+    gui_drawFillRect(widget->x + 1, widget->y + widget->h - 2, widget->w - 1, 2);
+    gui_drawFillRect(widget->x + widget->w - 3, widget->y + 1, 3, widget->h - 3);
+}
+
+void widget_drawSlider(Widget *widget)
+{
+    uint16_t pos, knob;
+
+    // background, track and knob
+    gui_drawFillRect(widget->x, widget->y, widget->w, widget->h);
+    gui_setBrushColor(widget->fgColor);
+    if (widget->flags & WIDGET_FLAG_VERTICAL)
+    {
+        knob = (widget->h >= 24) ? 6 : widget->h / 4 + 1;
+        pos = widget_valuePos(widget, widget->h - knob);
+        gui_drawFillRect(widget->x + widget->w / 2 - 1, widget->y, 2, widget->h);
+        gui_drawFillRect(widget->x, widget->y + widget->h - knob - pos, widget->w, knob);
+    }
+    else
+    {
+        knob = (widget->w >= 24) ? 6 : widget->w / 4 + 1;
+        pos = widget_valuePos(widget, widget->w - knob);
+        gui_drawFillRect(widget->x, widget->y + widget->h / 2 - 1, widget->w, 2);
+        gui_drawFillRect(widget->x + pos, widget->y, knob, widget->h);
+    }
+}
+
+void widget_drawBarGraph(Widget *widget)
+{
+    uint16_t x = widget->x, y = widget->y, w = widget->w, h = widget->h, pos;
+
+    if ((widget->flags & WIDGET_FLAG_BORDER) && w > 4 && h > 4)
+    {
+        gui_drawRect(x, y, w - 1, h - 1);
+        gui_setBrushColor(widget->bgColor);
+        gui_drawFillRect(x + 1, y + 1, w - 2, 1);
+        gui_drawFillRect(x + 1, y + h - 2, w - 2, 1);
+        gui_drawFillRect(x + 1, y + 2, 1, h - 4);
+        gui_drawFillRect(x + w - 2, y + 2, 1, h - 4);
+        x += 2;
+        y += 2;
+        w -= 4;
+        h -= 4;
+    }
+
+    // filled part then empty part, each pixel is sent once
+    if (widget->flags & WIDGET_FLAG_VERTICAL)
+    {
+        pos = widget_valuePos(widget, h);
+        gui_setBrushColor(widget->bgColor);
+        gui_drawFillRect(x, y, w, h - pos);
+        gui_setBrushColor(widget->fgColor);
+        gui_drawFillRect(x, y + h - pos, w, pos);
+    }
+    else
+    {
+        pos = widget_valuePos(widget, w);
+        gui_setBrushColor(widget->fgColor);
+        gui_drawFillRect(x, y, pos, h);
+        gui_setBrushColor(widget->bgColor);
+        gui_drawFillRect(x + pos, y, w - pos, h);
     }
 }
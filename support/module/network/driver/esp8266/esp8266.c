@@ -19,12 +19,31 @@
 #include "driver/uart.h"
 #include "sys/buffer.h"
 
-// data receive from esp
+#ifdef SIMULATOR
+ #include "esp8266_sim.h"
+#endif
+
+// data received from esp, +IPD packets are appended to the receive buffer
+// of their link, read with esp8266_getRecData and esp8266_releaseRec
+#ifndef ESP8266_RX_BUFFER_SIZE
+ #define ESP8266_RX_BUFFER_SIZE 512
+#endif
 uint8_t esp8266_socket = 0;
 uint16_t esp8266_sizePacket = 0;
 uint16_t esp8266_idPacket = 0;
-uint8_t esp8266_flagPacket = 0;
-char /*__attribute__((far))*/ esp8266_dataPacket[2049];
+
+typedef struct
+{
+    char data[ESP8266_RX_BUFFER_SIZE];
+    uint16_t head;          // write position
+    uint16_t size;          // received bytes not yet released
+    uint8_t overflow;       // bytes dropped, buffer full
+} ESP8266_RXLINK;
+ESP8266_RXLINK /*__attribute__((far))*/ esp8266_rxLinks[ESP8266_LINK_COUNT];
+
+// links connected (n,CONNECT) and not yet closed (n,CLOSED), one bit per link
+uint8_t esp8266_linkId = 0;
+volatile uint8_t esp8266_links = 0;
 
 // station IP
 char esp8266_ip[16] = "";
@@ -90,7 +109,11 @@ typedef enum
     FSM_IPD_COMMA_2,
     FSM_IPD_SIZE_DIGITS,
     FSM_PACKET_RX,
-    FSM_RX_COMPLETE
+    FSM_RX_COMPLETE,
+
+    FSM_LINK_ID,
+    FSM_LINK_COMMA,
+    FSM_LINK_C
 
 } ESP8266_FSMSTATE;
 volatile ESP8266_FSMSTATE esp8266_fsmState = FSM_START;
@@ -129,8 +152,55 @@ volatile ESP8266_CMD esp8266_currentCmd = ESP8266_CMD_NONE;
 
 uint8_t esp8266_config = 0;
 
+// socket writes and closes queue, sent one at a time by esp8266_task
+#ifndef ESP8266_TX_QUEUE_SIZE
+ #define ESP8266_TX_QUEUE_SIZE 8
+#endif
+// esp8266_task calls without answer before a queued command is failed
+#ifndef ESP8266_TX_TIMEOUT
+ #define ESP8266_TX_TIMEOUT 60000
+#endif
+#define ESP8266_TX_CHUNK 2048   // max size of a CIPSEND
+
+typedef struct
+{
+    const char *data;       // NULL for a close
+    uint32_t size;
+    uint32_t sent;
+    ESP8266_WRITE_CALLBACK callback;
+    void *arg;
+    uint16_t order;         // queue order, kept between commands of a socket
+    uint8_t sock;
+    uint8_t used;
+} ESP8266_TXCMD;
+ESP8266_TXCMD esp8266_txQueue[ESP8266_TX_QUEUE_SIZE];
+uint16_t esp8266_txOrder = 0;
+
+typedef enum
+{
+    ESP8266_TX_IDLE = 0,
+    ESP8266_TX_PROMPT,      // CIPSEND sent, waiting for '>'
+    ESP8266_TX_SENDING,     // chunk sent, waiting for SEND OK
+    ESP8266_TX_CLOSING      // CIPCLOSE sent, waiting for OK
+} ESP8266_TXSTATE;
+ESP8266_TXSTATE esp8266_txState = ESP8266_TX_IDLE;
+ESP8266_TXCMD *esp8266_txCmd = NULL;
+uint16_t esp8266_txChunk = 0;
+uint8_t esp8266_txSock = 0;
+uint16_t esp8266_txWait = 0;
+
 void esp8266_parse(char rec);
 
+// internal functions
+static void esp8266_rxPush(char rec);
+static void esp8266_rxFlush(uint8_t sock);
+static void esp8266_txTask();
+static ESP8266_TXCMD *esp8266_txNext();
+static void esp8266_txStart(ESP8266_TXCMD *cmd);
+static void esp8266_txDone(int status);
+static int esp8266_txPush(uint8_t sock, const char *data, uint32_t size, ESP8266_WRITE_CALLBACK callback, void *arg);
+static void esp8266_writeDone(uint8_t sock, int status, void *arg);
+
 rt_dev_t esp8266_uart;
 
 STATIC_BUFFER(esp8266_txBuff, 100);
@@ -146,6 +216,10 @@ void esp8266_uart_init()
     uart_setBaudSpeed(esp8266_uart, 115200);
     uart_setBitConfig(esp8266_uart, 8, UART_BIT_PARITY_NONE, 1);
     uart_enable(esp8266_uart);
+
+#ifdef SIMULATOR
+    esp8266_sim_attach(esp8266_uart);  // AT firmware emulated with host sockets
+#endif
 }
 
 /**
@@ -157,6 +231,11 @@ void esp8266_init()
 
     // buffer cmd construction init
     STATIC_BUFFER_INIT(esp8266_txBuff, 100);
+
+    memset(esp8266_rxLinks, 0, sizeof(esp8266_rxLinks));
+    memset(esp8266_txQueue, 0, sizeof(esp8266_txQueue));
+    esp8266_txState = ESP8266_TX_IDLE;
+    esp8266_txCmd = NULL;
 }
 
 /**
@@ -221,7 +300,173 @@ void esp8266_task()
             }
             esp8266_config++;
         }
+        return;
+    }
+
+    esp8266_txTask();
+}
+
+/**
+ * @brief Internal function, sends the queued writes and closes, one AT
+ * command at a time : AT+CIPSEND, data on the '>' prompt, then SEND OK
+ */
+static void esp8266_txTask()
+{
+    ESP8266_TXCMD *cmd = esp8266_txCmd;
+
+    if (esp8266_txState != ESP8266_TX_IDLE && ++esp8266_txWait >= ESP8266_TX_TIMEOUT)
+        esp8266_txDone(-1);
+
+    switch (esp8266_txState)
+    {
+    case ESP8266_TX_PROMPT:
+        if (esp8266_state == ESP8266_STATE_SEND_DATA)
+        {
+            esp8266_state = ESP8266_STATE_NONE;
+            esp8266_send_cmddat((char *)cmd->data + cmd->sent, esp8266_txChunk);
+            esp8266_currentCmd = ESP8266_CMD_WRITESOCK_DATA;
+            esp8266_txState = ESP8266_TX_SENDING;
+            esp8266_txWait = 0;
+        }
+        else if (esp8266_state == ESP8266_STATE_ERROR || esp8266_state == ESP8266_STATE_FAIL)
+            esp8266_txDone(-1);
+        break;
+
+    case ESP8266_TX_SENDING:
+        if (esp8266_state == ESP8266_STATE_SEND_OK)
+        {
+            esp8266_state = ESP8266_STATE_NONE;
+            cmd->sent += esp8266_txChunk;
+            if (cmd->sent >= cmd->size)
+                esp8266_txDone(0);
+            else
+            {
+                // next chunk, after the pending chunks of the other sockets
+                esp8266_txState = ESP8266_TX_IDLE;
+                esp8266_txCmd = NULL;
+            }
+        }
+        else if (esp8266_state == ESP8266_STATE_ERROR || esp8266_state == ESP8266_STATE_FAIL)
+            esp8266_txDone(-1);
+        break;
+
+    case ESP8266_TX_CLOSING:
+        if (esp8266_state == ESP8266_STATE_OK)
+            esp8266_txDone(0);
+        else if (esp8266_state == ESP8266_STATE_ERROR)
+            esp8266_txDone(-1);
+        break;
+
+    default:
+        break;
+    }
+
+    // next command sent as soon as the previous one ends
+    if (esp8266_txState == ESP8266_TX_IDLE)
+    {
+        cmd = esp8266_txNext();
+        if (cmd != NULL)
+            esp8266_txStart(cmd);
+    }
+}
+
+/**
+ * @brief Internal function, oldest queued command of the next socket with
+ * pending commands, sockets are served in turn
+ */
+static ESP8266_TXCMD *esp8266_txNext()
+{
+    uint8_t i, j, sock;
+    ESP8266_TXCMD *cmd;
+
+    for (i = 1; i <= ESP8266_LINK_COUNT; i++)
+    {
+        sock = (esp8266_txSock + i) % ESP8266_LINK_COUNT;
+        cmd = NULL;
+        for (j = 0; j < ESP8266_TX_QUEUE_SIZE; j++)
+        {
+            if (!esp8266_txQueue[j].used || esp8266_txQueue[j].sock != sock)
+                continue;
+            if (cmd == NULL || (int16_t)(esp8266_txQueue[j].order - cmd->order) < 0)
+                cmd = &esp8266_txQueue[j];
+        }
+        if (cmd != NULL)
+            return cmd;
+    }
+    return NULL;
+}
+
+static void esp8266_txStart(ESP8266_TXCMD *cmd)
+{
+    esp8266_txCmd = cmd;
+    esp8266_txSock = cmd->sock;
+    esp8266_txWait = 0;
+    esp8266_state = ESP8266_STATE_NONE;
+
+    buffer_clear(&esp8266_txBuff);
+    if (cmd->data == NULL)
+    {
+        buffer_astring(&esp8266_txBuff, "AT+CIPCLOSE=");
+        buffer_aint(&esp8266_txBuff, cmd->sock);
+        buffer_astring(&esp8266_txBuff, "\r\n");
+        esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
+        esp8266_currentCmd = ESP8266_CMD_CLOSESOCKET;
+        esp8266_txState = ESP8266_TX_CLOSING;
+        return;
+    }
+
+    esp8266_txChunk = ESP8266_TX_CHUNK;
+    if (cmd->size - cmd->sent < ESP8266_TX_CHUNK)
+        esp8266_txChunk = cmd->size - cmd->sent;
+    buffer_astring(&esp8266_txBuff, "AT+CIPSEND=");
+    buffer_aint(&esp8266_txBuff, (int)cmd->sock);
+    buffer_achar(&esp8266_txBuff, ',');
+    buffer_aint(&esp8266_txBuff, (int)esp8266_txChunk);
+    buffer_astring(&esp8266_txBuff, "\r\n");
+    esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
+    esp8266_currentCmd = ESP8266_CMD_WRITESOCK_REQ;
+    esp8266_txState = ESP8266_TX_PROMPT;
+}
+
+/**
+ * @brief Internal function, ends the current command and calls its callback
+ * @param status 0 if success, -1 in case of error or timeout
+ */
+static void esp8266_txDone(int status)
+{
+    ESP8266_TXCMD *cmd = esp8266_txCmd;
+    uint8_t sock = cmd->sock;
+
+    esp8266_txState = ESP8266_TX_IDLE;
+    esp8266_txCmd = NULL;
+    esp8266_state = ESP8266_STATE_NONE;
+
+    // frees the entry first, the callback can queue new commands
+    cmd->used = 0;
+    if (cmd->callback != NULL)
+        (*cmd->callback)(sock, status, cmd->arg);
+}
+
+static int esp8266_txPush(uint8_t sock, const char *data, uint32_t size, ESP8266_WRITE_CALLBACK callback, void *arg)
+{
+    uint8_t i;
+
+    for (i = 0; i < ESP8266_TX_QUEUE_SIZE; i++)
+    {
+        ESP8266_TXCMD *cmd = &esp8266_txQueue[i];
+        if (cmd->used)
+            continue;
+        cmd->data = data;
+        cmd->size = size;
+        cmd->sent = 0;
+        cmd->callback = callback;
+        cmd->arg = arg;
+        cmd->order = esp8266_txOrder++;
+        cmd->sock = sock;
+        cmd->used = 1;
+        return 0;
     }
+    return -1;
 }
 
 /**
@@ -271,10 +516,41 @@ void esp8266_parse(char rec)
         }
         else if (rec == 'O')
             esp8266_fsmState = FSM_OK_O;
+        else if (rec >= '0' && rec < '0' + ESP8266_LINK_COUNT)
+        {
+            esp8266_linkId = rec - '0';
+            esp8266_fsmState = FSM_LINK_ID;
+        }
         else
             esp8266_fsmState = FSM_UNKNOW;
         break;
 
+    case FSM_LINK_ID:
+        if (rec == ',')
+            esp8266_fsmState = FSM_LINK_COMMA;
+        else
+            esp8266_fsmState = FSM_UNKNOW;
+        break;
+    case FSM_LINK_COMMA:
+        if (rec == 'C')
+            esp8266_fsmState = FSM_LINK_C;
+        else
+            esp8266_fsmState = FSM_UNKNOW;
+        break;
+    case FSM_LINK_C:
+        if (rec == 'O')         // n,CONNECT
+        {
+            esp8266_rxFlush(esp8266_linkId);
+            esp8266_links |= (1 << esp8266_linkId);
+        }
+        else if (rec == 'L')    // n,CLOSED
+        {
+            esp8266_rxFlush(esp8266_linkId);
+            esp8266_links &= ~(1 << esp8266_linkId);
+        }
+        esp8266_fsmState = FSM_UNKNOW;
+        break;
+
     case FSM_SENDOK_S:
         if (rec == 'E')
             esp8266_fsmState = FSM_SENDOK_E;
@@ -302,6 +578,8 @@ void esp8266_parse(char rec)
     case FSM_SENDOK_Sp:
         if (rec == 'O')
             esp8266_fsmState = FSM_SENDOK_O;
+        else if (rec == 'F')    // SEND FAIL
+            esp8266_fsmState = FSM_FAIL_F;
         else
             esp8266_fsmState = FSM_UNKNOW;
         break;
@@ -556,7 +834,7 @@ void esp8266_parse(char rec)
             esp8266_fsmState = FSM_UNKNOW;
         break;
     case FSM_IPD_COMMA_1:
-        if (rec >= '0' && rec <= '9')
+        if (rec >= '0' && rec < '0' + ESP8266_LINK_COUNT)
         {
             esp8266_fsmState = FSM_IPD_SOCKET_DIGIT;
             esp8266_socket = rec - '0';
@@ -583,7 +861,8 @@ void esp8266_parse(char rec)
         if (rec == ':')
         {
             esp8266_idPacket = 0;
-            esp8266_fsmState = FSM_PACKET_RX;
+            esp8266_links |= (1 << esp8266_socket);
+            esp8266_fsmState = (esp8266_sizePacket > 0) ? FSM_PACKET_RX : FSM_UNKNOW;
         }
         else
         {
@@ -597,13 +876,11 @@ void esp8266_parse(char rec)
         }
         break;
     case FSM_PACKET_RX:
-        esp8266_dataPacket[esp8266_idPacket++] = rec;
-        if (esp8266_idPacket >= esp8266_sizePacket)
-        {
-            esp8266_flagPacket = 1;
-            esp8266_state = ESP8266_STATE_RECEIVE_DATA;
+        esp8266_rxPush(rec);
+        // +IPD comes between the answers of a command, the state of the
+        // command is kept, received data is given by esp8266_getRec
+        if (++esp8266_idPacket >= esp8266_sizePacket)
             esp8266_fsmState = FSM_UNKNOW;
-        }
         break;
     default:
         esp8266_fsmState = FSM_UNKNOW;
@@ -643,44 +920,145 @@ ESP8266_STATUS esp8266_getStatus()
 }
 
 /**
- * @brief Give the id of the last socket received
- * @return socket id
+ * @brief Internal function, appends a received byte to the buffer of its link
+ */
+static void esp8266_rxPush(char rec)
+{
+    ESP8266_RXLINK *link = &esp8266_rxLinks[esp8266_socket];
+
+    if (link->size >= ESP8266_RX_BUFFER_SIZE)
+    {
+        link->overflow = 1;
+        return;
+    }
+    link->data[link->head] = rec;
+    if (++link->head >= ESP8266_RX_BUFFER_SIZE)
+        link->head = 0;
+    link->size++;
+}
+
+/**
+ * @brief Internal function, drops received data of a link, on a new
+ * connection or when it is closed
  */
-uint8_t esp8266_getRecSocket()
+static void esp8266_rxFlush(uint8_t sock)
 {
-    return esp8266_socket;
+    ESP8266_RXLINK *link = &esp8266_rxLinks[sock];
+    link->head = 0;
+    link->size = 0;
+    link->overflow = 0;
 }
 
 /**
- * @brief Reads the last packet received
+ * @brief Reads the received data of a link, in place. Data is kept until
+ * released with esp8266_releaseRec, the size can be less than the received
+ * size when the data wraps in the link buffer
+ * @param sock id of the link
  * @return pointer to data
  */
-char *esp8266_getRecData()
+char *esp8266_getRecData(uint8_t sock)
 {
-    return esp8266_dataPacket;
+    ESP8266_RXLINK *link = &esp8266_rxLinks[sock];
+    uint16_t tail;
+
+    if (link->head >= link->size)
+        tail = link->head - link->size;
+    else
+        tail = ESP8266_RX_BUFFER_SIZE - (link->size - link->head);
+    return link->data + tail;
 }
 
 /**
- * @brief Gives the last packet received size in bytes
- * @return size of packet
+ * @brief Gives the received size of a link readable at esp8266_getRecData
+ * @param sock id of the link
+ * @return size in bytes, 0 if nothing is received
  */
-uint16_t esp8266_getRecSize()
+uint16_t esp8266_getRecSize(uint8_t sock)
 {
-    return esp8266_sizePacket;
+    ESP8266_RXLINK *link;
+
+    if (sock >= ESP8266_LINK_COUNT)
+        return 0;
+    link = &esp8266_rxLinks[sock];
+    if (link->head >= link->size)
+        return link->size;
+    return link->size - link->head;     // up to the end of the buffer
 }
 
 /**
- * @brief Check if packet is received by a socket
- * @return 0 if no packet is received, 1 else
+ * @brief Releases received data of a link, read with esp8266_getRecData
+ * @param sock id of the link
+ * @param size size in bytes, at most esp8266_getRecSize
+ */
+void esp8266_releaseRec(uint8_t sock, uint16_t size)
+{
+    if (sock >= ESP8266_LINK_COUNT)
+        return;
+    if (size > esp8266_rxLinks[sock].size)
+        size = esp8266_rxLinks[sock].size;
+    esp8266_rxLinks[sock].size -= size;
+}
+
+/**
+ * @brief Checks if received data of a link was dropped because its buffer
+ * was full, the flag is cleared
+ * @param sock id of the link
+ * @return 1 if data was lost, 0 else
+ */
+uint8_t esp8266_getRecOverflow(uint8_t sock)
+{
+    uint8_t overflow;
+
+    if (sock >= ESP8266_LINK_COUNT)
+        return 0;
+    overflow = esp8266_rxLinks[sock].overflow;
+    esp8266_rxLinks[sock].overflow = 0;
+    return overflow;
+}
+
+/**
+ * @brief Gives the connection state of a link, as reported by the ESP8266
+ * with n,CONNECT and n,CLOSED
+ * @param sock id of the link
+ * @return 1 if the link is connected, 0 else
+ */
+uint8_t esp8266_isLinkConnected(uint8_t sock)
+{
+    if (sock >= ESP8266_LINK_COUNT)
+        return 0;
+    return (esp8266_links >> sock) & 0x01;
+}
+
+/**
+ * @brief Gives the links with received data
+ * @return one bit per link, 0 if no data is received
  */
 uint8_t esp8266_getRec()
 {
-    if (esp8266_flagPacket == 1)
+    uint8_t sock, links = 0;
+
+    for (sock = 0; sock < ESP8266_LINK_COUNT; sock++)
     {
-        esp8266_flagPacket = 0;
-        return 1;
+        if (esp8266_rxLinks[sock].size > 0)
+            links |= (1 << sock);
     }
-    return 0;
+    return links;
+}
+
+/**
+ * @brief Gives the number of free entries of the write queue, each write or
+ * close uses one entry
+ */
+uint8_t esp8266_write_free()
+{
+    uint8_t i, count = 0;
+
+    for (i = 0; i < ESP8266_TX_QUEUE_SIZE; i++)
+    {
+        if (!esp8266_txQueue[i].used)
+            count++;
+    }
+    return count;
 }
 
 /**
@@ -711,6 +1089,7 @@ uint8_t esp8266_open_tcp_socket(char *ip_domain, uint16_t port)
     buffer_astring(&esp8266_txBuff, protected);
     buffer_astring(&esp8266_txBuff, "\",");
     buffer_aint(&esp8266_txBuff, port);
+    buffer_astring(&esp8266_txBuff, "\r\n");
 
     esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
     esp8266_currentCmd = ESP8266_CMD_OPENTCP;
@@ -738,6 +1117,7 @@ uint8_t esp8266_open_udp_socket(char *ip_domain, uint16_t port,
     buffer_aint(&esp8266_txBuff, (int)port);
     buffer_achar(&esp8266_txBuff, ',');
     buffer_aint(&esp8266_txBuff, (int)localPort);
+    buffer_astring(&esp8266_txBuff, "\r\n");
 
     esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
     esp8266_currentCmd = ESP8266_CMD_OPENUDP;
@@ -844,48 +1224,78 @@ int esp8266_disconnect_ap()
 }
 
 /**
- * @brief Closes a socket
+ * @brief Closes a socket, once its queued writes are sent
  * @param sock id of the socket to close
  */
 void esp8266_close_socket(uint8_t sock)
 {
-    if (sock > 4)
+    if (sock >= ESP8266_LINK_COUNT)
         return;
 
-    buffer_clear(&esp8266_txBuff);
-    buffer_astring(&esp8266_txBuff, "AT+CIPCLOSE=");
-    buffer_aint(&esp8266_txBuff, sock);
-    buffer_astring(&esp8266_txBuff, "\r\n");
+    while (esp8266_close_socket_async(sock, NULL, NULL) < 0)
+        esp8266_task();     // queue full
+}
 
-    esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
-    esp8266_currentCmd = ESP8266_CMD_CLOSESOCKET;
+/**
+ * @brief Queues the close of a socket, after its queued writes
+ * @param sock id of the socket to close
+ * @param callback called once closed (status 0) or on error (status -1),
+ * can be NULL
+ * @param arg argument given to the callback
+ * @return 0 if queued, -1 if the queue is full or the socket invalid
+ */
+int esp8266_close_socket_async(uint8_t sock, ESP8266_WRITE_CALLBACK callback, void *arg)
+{
+    if (sock >= ESP8266_LINK_COUNT)
+        return -1;
+    return esp8266_txPush(sock, NULL, 0, callback, arg);
+}
+
+/**
+ * @brief Queues a write to a socket, sent by esp8266_task in chunks of 2048
+ * bytes, interleaved with the writes of other sockets. Writes of a socket
+ * are sent in order
+ * @param sock id of the socket
+ * @param data pointer of data to send, must stay valid until the callback
+ * @param size size of data in bytes
+ * @param callback called once data is sent (status 0) or on error
+ * (status -1), can be NULL
+ * @param arg argument given to the callback
+ * @return 0 if queued, -1 if the queue is full or the socket invalid
+ */
+int esp8266_write_socket_async(uint8_t sock, const char *data, uint32_t size,
+                               ESP8266_WRITE_CALLBACK callback, void *arg)
+{
+    if (sock >= ESP8266_LINK_COUNT || data == NULL || size == 0)
+        return -1;
+    return esp8266_txPush(sock, data, size, callback, arg);
+}
+
+static void esp8266_writeDone(uint8_t sock, int status, void *arg)
+{
+    (void)sock;
+    (void)status;
+    *(volatile uint8_t *)arg = 1;
 }
 
 /**
- * @brief Writes data to a socket
+ * @brief Writes data to a socket and waits until it is sent, prefer
+ * esp8266_write_socket_async that does not block
  * @param sock id of the socket
  * @param data pointer of data to send
  * @param size size of data in bytes
  */
 void esp8266_write_socket(uint8_t sock, char *data, uint16_t size)
 {
-    buffer_clear(&esp8266_txBuff);
-    buffer_astring(&esp8266_txBuff, "AT+CIPSEND=");
-    buffer_aint(&esp8266_txBuff, (int)sock);
-    buffer_achar(&esp8266_txBuff, ',');
-    buffer_aint(&esp8266_txBuff, (int)size);
-    buffer_astring(&esp8266_txBuff, "\r\n");
+    volatile uint8_t done = 0;
 
-    // send request
-    esp8266_send_cmddat(esp8266_txBuff.data, esp8266_txBuff.size);
-    esp8266_currentCmd = ESP8266_CMD_WRITESOCK_REQ;
-
-    while (esp8266_state != ESP8266_STATE_SEND_DATA) esp8266_task(); // TODO FIXME
-    esp8266_state = ESP8266_STATE_NONE;
+    if (sock >= ESP8266_LINK_COUNT || size == 0)
+        return;
 
-    esp8266_send_cmddat(data, size);
-    esp8266_currentCmd = ESP8266_CMD_WRITESOCK_DATA;
-    while (esp8266_state != ESP8266_STATE_SEND_OK) esp8266_task(); // TODO FIXME
+    while (esp8266_write_socket_async(sock, data, size, esp8266_writeDone, (void *)&done) < 0)
+        esp8266_task();     // queue full
+    while (!done)
+        esp8266_task();
 }
 
 /**
@@ -41,11 +41,20 @@ int esp8266_connect_ap(char *ssid, char *pw);
 int esp8266_disconnect_ap();
 
 // ======== tcp/ip layer =========
+#define ESP8266_LINK_COUNT 5    // links of the AT firmware in CIPMUX=1 mode
+
 uint8_t esp8266_open_tcp_socket(char *ip_domain, uint16_t port);
 uint8_t esp8266_open_udp_socket(char *ip_domain, uint16_t port, uint16_t localPort);
+
+// completion of a queued write, status is 0 if sent, -1 in case of error
+typedef void (*ESP8266_WRITE_CALLBACK)(uint8_t sock, int status, void *arg);
+int esp8266_write_socket_async(uint8_t sock, const char *data, uint32_t size,
+                               ESP8266_WRITE_CALLBACK callback, void *arg);
+uint8_t esp8266_write_free();
 void esp8266_write_socket(uint8_t sock, char *data, uint16_t size);
 void esp8266_write_socket_string(uint8_t sock, char *str);
 void esp8266_close_socket(uint8_t sock);
+int esp8266_close_socket_async(uint8_t sock, ESP8266_WRITE_CALLBACK callback, void *arg);
 
 void esp8266_server_create(uint16_t port);
 void esp8266_server_destroy();
@@ -59,9 +68,11 @@ typedef enum
 ESP8266_STATUS esp8266_getStatus();
 
 uint8_t esp8266_getRec();
-uint8_t esp8266_getRecSocket();
-char *esp8266_getRecData();
-uint16_t esp8266_getRecSize();
+char *esp8266_getRecData(uint8_t sock);
+uint16_t esp8266_getRecSize(uint8_t sock);
+void esp8266_releaseRec(uint8_t sock, uint16_t size);
+uint8_t esp8266_getRecOverflow(uint8_t sock);
+uint8_t esp8266_isLinkConnected(uint8_t sock);
 
 char *esp8266_getIp();
 char *esp8266_getMac();
@@ -6,5 +6,6 @@ DRIVERS += uart
 
 HEADER += esp8266.h
 SRC += esp8266.c
+SIM_SRC += esp8266_sim.c
 
-SRC += fs_functions.c http_parser.c http_formater.c web_server.c json_formater.c
+SRC += fs_functions.c http_parser.c http_formater.c web_server.c json_formater.c json_parser.c json_writer.c rest.c websocket.c
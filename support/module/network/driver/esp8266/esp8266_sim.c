@@ -0,0 +1,481 @@
+/**
+ * @file esp8266_sim.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief ESP8266 AT firmware emulator for simulator, links are bridged to TCP
+ * sockets of the host
+ *
+ * The emulator is attached to the simulated uart of the driver and answers
+ * the AT commands in CIPMUX=1 mode as the firmware does. The server of
+ * AT+CIPSERVER listens on ESP8266_SIM_ADDRESS, clients get the links 0 to 4
+ * with n,CONNECT and their data with +IPD. It allows to run the network
+ * stack and the web server on a desktop with HTTP clients and benchmarks.
+ */
+
+#include "esp8266_sim.h"
+#include "esp8266.h"
+
+#include "driver/uart.h"
+#include "simulator.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef SIM_UNIX
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+ #define MSG_NOSIGNAL 0
+#endif
+
+#define ESP8266_SIM_CMD_SIZE 256
+#define ESP8266_SIM_SEND_MAX 2048   // max size of a CIPSEND
+
+int esp8266_sim_server = -1;
+int esp8266_sim_links[ESP8266_LINK_COUNT];
+uint8_t esp8266_sim_echo = 1;
+
+// command line being received
+char esp8266_sim_cmd[ESP8266_SIM_CMD_SIZE];
+uint16_t esp8266_sim_cmdSize = 0;
+
+// data of AT+CIPSEND, received after the '>' prompt
+int8_t esp8266_sim_sendLink = -1;
+uint16_t esp8266_sim_sendSize = 0;
+uint16_t esp8266_sim_sendPos = 0;
+char esp8266_sim_sendData[ESP8266_SIM_SEND_MAX];
+
+// output of the firmware, read by the driver
+char esp8266_sim_out[ESP8266_SIM_OUT_SIZE];
+size_t esp8266_sim_outSize = 0;
+uint8_t esp8266_sim_lineStart = 1;  // cleared after a +IPD payload
+
+// internal functions
+static ssize_t esp8266_sim_write(const char *data, size_t size);
+static ssize_t esp8266_sim_read(char *data, size_t size_max);
+static void esp8266_sim_poll();
+static void esp8266_sim_exec(char *cmd);
+static void esp8266_sim_push(const char *data, size_t size);
+static void esp8266_sim_print(const char *str);
+static void esp8266_sim_linkClosed(uint8_t link);
+static void esp8266_sim_send();
+static int esp8266_sim_newLink(int fd);
+static int esp8266_sim_serverOpen(int port);
+static int esp8266_sim_connect(const char *host, int port);
+static int esp8266_sim_int(char **args);
+static int esp8266_sim_string(char **args, char *value, size_t size);
+
+const UART_SIM_DEVICE esp8266_sim_device = {
+    .write = esp8266_sim_write,
+    .read = esp8266_sim_read
+};
+
+/**
+ * @brief esp8266_sim_attach emulates the firmware on the uart of the driver
+ */
+void esp8266_sim_attach(rt_dev_t uart)
+{
+    uint8_t link;
+
+    for (link = 0; link < ESP8266_LINK_COUNT; link++)
+        esp8266_sim_links[link] = -1;
+    uart_sim_attach(uart, &esp8266_sim_device);
+}
+
+// bytes written by the driver, command lines and CIPSEND data
+static ssize_t esp8266_sim_write(const char *data, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+    {
+        if (esp8266_sim_sendLink >= 0)
+        {
+            esp8266_sim_sendData[esp8266_sim_sendPos++] = data[i];
+            if (esp8266_sim_sendPos == esp8266_sim_sendSize)
+                esp8266_sim_send();
+            continue;
+        }
+
+        if (esp8266_sim_cmdSize < ESP8266_SIM_CMD_SIZE - 1)
+            esp8266_sim_cmd[esp8266_sim_cmdSize++] = data[i];
+        if (data[i] != '\n')
+            continue;
+
+        // command line, echoed as typed
+        if (esp8266_sim_echo)
+            esp8266_sim_push(esp8266_sim_cmd, esp8266_sim_cmdSize);
+        while (esp8266_sim_cmdSize > 0
+               && (esp8266_sim_cmd[esp8266_sim_cmdSize - 1] == '\n' || esp8266_sim_cmd[esp8266_sim_cmdSize - 1] == '\r'))
+            esp8266_sim_cmdSize--;
+        esp8266_sim_cmd[esp8266_sim_cmdSize] = '\0';
+        esp8266_sim_cmdSize = 0;
+        if (esp8266_sim_cmd[0] != '\0')
+            esp8266_sim_exec(esp8266_sim_cmd);
+    }
+    return size;
+}
+
+// output of the firmware, after the new connections and received data
+static ssize_t esp8266_sim_read(char *data, size_t size_max)
+{
+    size_t size;
+
+    esp8266_sim_poll();
+
+    size = esp8266_sim_outSize;
+    if (size > size_max)
+        size = size_max;
+    memcpy(data, esp8266_sim_out, size);
+    memmove(esp8266_sim_out, esp8266_sim_out + size, esp8266_sim_outSize - size);
+    esp8266_sim_outSize -= size;
+    return size;
+}
+
+/**
+ * @brief esp8266_sim_poll accepts the new clients and reads the sockets
+ * without waiting, as long as the output has room for a packet
+ */
+static void esp8266_sim_poll()
+{
+    char data[ESP8266_SIM_IPD_MAX], head[32];
+    uint8_t link;
+    ssize_t size;
+    int fd;
+
+    while (esp8266_sim_server >= 0 && (fd = accept(esp8266_sim_server, NULL, NULL)) >= 0)
+    {
+        if (esp8266_sim_newLink(fd) < 0)
+            close(fd);  // all links used, the firmware refuses the client
+    }
+
+    for (link = 0; link < ESP8266_LINK_COUNT; link++)
+    {
+        while (esp8266_sim_links[link] >= 0
+               && ESP8266_SIM_OUT_SIZE - esp8266_sim_outSize >= sizeof(head) + ESP8266_SIM_IPD_MAX)
+        {
+            size = recv(esp8266_sim_links[link], data, ESP8266_SIM_IPD_MAX, MSG_DONTWAIT);
+            if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                break;
+            if (size <= 0)
+            {
+                esp8266_sim_linkClosed(link);
+                break;
+            }
+            snprintf(head, sizeof(head), "\r\n+IPD,%d,%d:", link, (int)size);
+            esp8266_sim_print(head);
+            esp8266_sim_push(data, size);
+            esp8266_sim_lineStart = 0;
+        }
+    }
+}
+
+static void esp8266_sim_exec(char *cmd)
+{
+    char line[64], host[64];
+    char *args;
+    int link, value;
+
+    if (strcmp(cmd, "AT") == 0 || strcmp(cmd, "ATE0") == 0 || strcmp(cmd, "ATE1") == 0)
+    {
+        if (cmd[2] == 'E')
+            esp8266_sim_echo = cmd[3] - '0';
+        esp8266_sim_print("\r\nOK\r\n");
+    }
+    else if (strcmp(cmd, "AT+RST") == 0)
+    {
+        for (link = 0; link < ESP8266_LINK_COUNT; link++)
+        {
+            if (esp8266_sim_links[link] >= 0)
+                close(esp8266_sim_links[link]);
+            esp8266_sim_links[link] = -1;
+        }
+        if (esp8266_sim_server >= 0)
+            close(esp8266_sim_server);
+        esp8266_sim_server = -1;
+        esp8266_sim_print("\r\nOK\r\n\r\nready\r\n");
+    }
+    else if (strcmp(cmd, "AT+GMR") == 0)
+        esp8266_sim_print("AT version:1.2.0.0(uDevkit simulator)\r\n\r\nOK\r\n");
+    else if (strncmp(cmd, "AT+CWJAP", 8) == 0)
+        esp8266_sim_print("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n");
+    else if (strcmp(cmd, "AT+CWQAP") == 0)
+        esp8266_sim_print("\r\nOK\r\nWIFI DISCONNECT\r\n");
+    else if (strncmp(cmd, "AT+CWMODE", 9) == 0 || strncmp(cmd, "AT+CWSAP", 8) == 0
+             || strncmp(cmd, "AT+CIPMUX=", 10) == 0 || strncmp(cmd, "AT+CIPSTO=", 10) == 0)
+        esp8266_sim_print("\r\nOK\r\n");
+    else if (strcmp(cmd, "AT+CIFSR") == 0)
+    {
+        esp8266_sim_print("+CIFSR:APIP,\"192.168.4.1\"\r\n+CIFSR:APMAC,\"1a:fe:34:00:00:01\"\r\n");
+        esp8266_sim_print("+CIFSR:STAIP,\"" ESP8266_SIM_ADDRESS "\"\r\n+CIFSR:STAMAC,\"18:fe:34:00:00:01\"\r\n");
+        esp8266_sim_print("\r\nOK\r\n");
+    }
+    else if (strncmp(cmd, "AT+CIPSERVER=", 13) == 0)
+    {
+        args = cmd + 13;
+        value = esp8266_sim_int(&args);
+        if (esp8266_sim_server >= 0)
+            close(esp8266_sim_server);
+        esp8266_sim_server = -1;
+        if (value == 0)
+            esp8266_sim_print("\r\nOK\r\n");
+        else if (esp8266_sim_serverOpen(*args != '\0' ? esp8266_sim_int(&args) : 333) == 0)
+            esp8266_sim_print("\r\nOK\r\n");
+        else
+            esp8266_sim_print("\r\nERROR\r\n");
+    }
+    else if (strncmp(cmd, "AT+CIPSTART=", 12) == 0)
+    {
+        // link id is optional, the first free link is used
+        args = cmd + 12;
+        link = -1;
+        if (*args >= '0' && *args <= '9')
+            link = esp8266_sim_int(&args);
+        if (esp8266_sim_string(&args, line, sizeof(line)) < 0 || strcmp(line, "TCP") != 0
+            || esp8266_sim_string(&args, host, sizeof(host)) < 0
+            || (link >= 0 && (link >= ESP8266_LINK_COUNT || esp8266_sim_links[link] >= 0)))
+        {
+            esp8266_sim_print("\r\nERROR\r\n");
+            return;
+        }
+        value = esp8266_sim_connect(host, esp8266_sim_int(&args));
+        if (value < 0)
+        {
+            esp8266_sim_print("\r\nERROR\r\nCLOSED\r\n");
+            return;
+        }
+        if (link >= 0)
+        {
+            esp8266_sim_links[link] = value;
+            snprintf(line, sizeof(line), "%d,CONNECT\r\n", link);
+            esp8266_sim_print(line);
+        }
+        else if (esp8266_sim_newLink(value) < 0)
+        {
+            close(value);
+            esp8266_sim_print("\r\nERROR\r\n");
+            return;
+        }
+        esp8266_sim_print("\r\nOK\r\n");
+    }
+    else if (strncmp(cmd, "AT+CIPSEND=", 11) == 0)
+    {
+        args = cmd + 11;
+        link = esp8266_sim_int(&args);
+        value = esp8266_sim_int(&args);
+        if (link < 0 || link >= ESP8266_LINK_COUNT || esp8266_sim_links[link] < 0)
+            esp8266_sim_print("link is not valid\r\n\r\nERROR\r\n");
+        else if (value <= 0 || value > ESP8266_SIM_SEND_MAX)
+            esp8266_sim_print("\r\nERROR\r\n");
+        else
+        {
+            esp8266_sim_sendLink = link;
+            esp8266_sim_sendSize = value;
+            esp8266_sim_sendPos = 0;
+            esp8266_sim_print("\r\nOK\r\n> ");
+        }
+    }
+    else if (strncmp(cmd, "AT+CIPCLOSE=", 12) == 0)
+    {
+        args = cmd + 12;
+        link = esp8266_sim_int(&args);
+        if (link < 0 || link >= ESP8266_LINK_COUNT || esp8266_sim_links[link] < 0)
+        {
+            esp8266_sim_print("UNLINK\r\n\r\nERROR\r\n");
+            return;
+        }
+        esp8266_sim_linkClosed(link);
+        esp8266_sim_print("\r\nOK\r\n");
+    }
+    else
+        esp8266_sim_print("\r\nERROR\r\n");
+}
+
+// data of a CIPSEND received, written to the socket of the link
+static void esp8266_sim_send()
+{
+    uint8_t link = esp8266_sim_sendLink;
+    size_t pos = 0;
+    ssize_t size;
+    char line[32];
+
+    esp8266_sim_sendLink = -1;
+    while (pos < esp8266_sim_sendSize)
+    {
+        size = send(esp8266_sim_links[link], esp8266_sim_sendData + pos, esp8266_sim_sendSize - pos, MSG_NOSIGNAL);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0)
+        {
+            esp8266_sim_print("\r\nSEND FAIL\r\n");
+            esp8266_sim_linkClosed(link);
+            return;
+        }
+        pos += size;
+    }
+    snprintf(line, sizeof(line), "\r\nRecv %d bytes\r\n", (int)esp8266_sim_sendSize);
+    esp8266_sim_print(line);
+    esp8266_sim_print("\r\nSEND OK\r\n");
+}
+
+static void esp8266_sim_linkClosed(uint8_t link)
+{
+    char line[16];
+
+    close(esp8266_sim_links[link]);
+    esp8266_sim_links[link] = -1;
+    snprintf(line, sizeof(line), "%d,CLOSED\r\n", link);
+    esp8266_sim_print(line);
+}
+
+// first free link for a socket, reported with n,CONNECT
+static int esp8266_sim_newLink(int fd)
+{
+    char line[16];
+    int link, one = 1;
+
+    for (link = 0; link < ESP8266_LINK_COUNT; link++)
+    {
+        if (esp8266_sim_links[link] < 0)
+            break;
+    }
+    if (link == ESP8266_LINK_COUNT)
+        return -1;
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    esp8266_sim_links[link] = fd;
+    snprintf(line, sizeof(line), "%d,CONNECT\r\n", link);
+    esp8266_sim_print(line);
+    return link;
+}
+
+static int esp8266_sim_serverOpen(int port)
+{
+    struct sockaddr_in addr;
+    int fd, one = 1;
+
+    if (port < 1024)
+        port += ESP8266_SIM_PORT_OFFSET;
+
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(ESP8266_SIM_ADDRESS);
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, ESP8266_LINK_COUNT) < 0)
+    {
+        perror("esp8266 sim server");
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);     // polled by accept
+
+    esp8266_sim_server = fd;
+    printf("esp8266 sim server on %s:%d\n", ESP8266_SIM_ADDRESS, port);
+    return 0;
+}
+
+static int esp8266_sim_connect(const char *host, int port)
+{
+    struct addrinfo hints, *res;
+    char service[8];
+    int fd;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%d", port);
+    if (getaddrinfo(host, service, &hints, &res) != 0)
+        return -1;
+
+    fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) < 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+// decimal argument and its comma
+static int esp8266_sim_int(char **args)
+{
+    int value = 0;
+
+    if (**args < '0' || **args > '9')
+        return -1;
+    while (**args >= '0' && **args <= '9')
+        value = value * 10 + *((*args)++) - '0';
+    if (**args == ',')
+        (*args)++;
+    return value;
+}
+
+// quoted argument and its comma, with the \ escapes of the driver
+static int esp8266_sim_string(char **args, char *value, size_t size)
+{
+    char *ptr = *args;
+    size_t pos = 0;
+
+    if (*ptr++ != '"')
+        return -1;
+    while (*ptr != '"')
+    {
+        if (*ptr == '\\' && ptr[1] != '\0')
+            ptr++;
+        if (*ptr == '\0' || pos >= size - 1)
+            return -1;
+        value[pos++] = *ptr++;
+    }
+    value[pos] = '\0';
+    ptr++;
+    if (*ptr == ',')
+        ptr++;
+    *args = ptr;
+    return 0;
+}
+
+static void esp8266_sim_push(const char *data, size_t size)
+{
+    if (!esp8266_sim_lineStart)
+    {
+        esp8266_sim_lineStart = 1;
+        esp8266_sim_push("\r\n", 2);     // end of the line of a +IPD payload
+    }
+    if (size > ESP8266_SIM_OUT_SIZE - esp8266_sim_outSize)
+        size = ESP8266_SIM_OUT_SIZE - esp8266_sim_outSize;     // lost as on a full uart
+    memcpy(esp8266_sim_out + esp8266_sim_outSize, data, size);
+    esp8266_sim_outSize += size;
+}
+
+static void esp8266_sim_print(const char *str)
+{
+    esp8266_sim_push(str, strlen(str));
+}
+
+#else
+
+/**
+ * @brief esp8266_sim_attach the emulator needs the sockets of a unix host,
+ * else the uart stays connected to udk-sim
+ */
+void esp8266_sim_attach(rt_dev_t uart)
+{
+    (void)uart;
+    puts("esp8266 sim not supported on this host");
+}
+
+#endif // SIM_UNIX
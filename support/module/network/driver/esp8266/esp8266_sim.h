@@ -0,0 +1,37 @@
+/**
+ * @file esp8266_sim.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief ESP8266 AT firmware emulator for simulator, links are bridged to TCP
+ * sockets of the host
+ */
+
+#ifndef ESP8266_SIM_H
+#define ESP8266_SIM_H
+
+#include <driver/device.h>
+
+// address of the server sockets, a server port below 1024 is opened at port
+// + ESP8266_SIM_PORT_OFFSET to run without privileges, 80 on 8080
+#ifndef ESP8266_SIM_ADDRESS
+ #define ESP8266_SIM_ADDRESS "127.0.0.1"
+#endif
+#ifndef ESP8266_SIM_PORT_OFFSET
+ #define ESP8266_SIM_PORT_OFFSET 8000
+#endif
+
+// received data of a link is given by +IPD packets of at most a TCP segment
+#ifndef ESP8266_SIM_IPD_MAX
+ #define ESP8266_SIM_IPD_MAX 1460
+#endif
+
+// firmware output not yet read on the uart, sockets are not read while it
+// has no room for a packet
+#ifndef ESP8266_SIM_OUT_SIZE
+ #define ESP8266_SIM_OUT_SIZE 8192
+#endif
+
+void esp8266_sim_attach(rt_dev_t uart);
+
+#endif // ESP8266_SIM_H
@@ -1,5 +1,8 @@
 #ifndef __FS_DATA_HEADER__
 #define __FS_DATA_HEADER__
+
+#include <stdint.h>
+
 // ======== Struct declare ========
 typedef struct
 {
@@ -7,12 +10,28 @@ typedef struct
 	const char *type;
 	const char *data;
 	const unsigned int size;
+	const unsigned int flags;       // FS_FILE_* flags
+	const char *gzipData;           // gzip variant of data if FS_FILE_GZIP
+	const unsigned int gzipSize;
+	const char *etag;               // quoted entity tag of the content, or NULL
 } Fs_File;
 
+// Fs_File flags
+#define FS_FILE_GZIP 0x0001         // gzipData holds a smaller compressed variant
+
 typedef struct
 {
 	const Fs_File **files;
 	const unsigned int count;
+	const uint16_t *hashSeeds;      // minimal perfect hash, NULL for linear search
+	const unsigned int hashBuckets;
 } Fs_FilesList;
 
+/**
+ * Minimal perfect hash index generated by htmlGen, files are stored in their
+ * slot order :
+ *  bucket = fs_hash(name, 0) % hashBuckets
+ *  slot = fs_hash(name, hashSeeds[bucket]) % count
+ */
+
 #endif   //__FS_DATA_HEADER__
@@ -12,9 +12,35 @@
 
 #include <string.h>
 
+/**
+ * @brief fs_hash 16 bits FNV-1a like hash of a file name, seeded for the
+ * perfect hash index, must stay identical to the htmlGen one
+ */
+uint16_t fs_hash(const char *name, uint16_t seed)
+{
+	uint16_t hash = 0x9DC5 ^ seed;
+
+	while (*name != 0)
+	{
+		hash = (hash ^ (uint8_t)*name++) * 0x0193;
+		hash ^= hash >> 7;
+	}
+	return hash;
+}
+
 const Fs_File *getFile(const Fs_FilesList *file_list, const char *fileName)
 {
-	int i;
+	unsigned int i;
+
+	// perfect hash index, one string compare
+	if (file_list->hashSeeds != NULL && file_list->hashBuckets != 0)
+	{
+		uint16_t seed = file_list->hashSeeds[fs_hash(fileName, 0) % file_list->hashBuckets];
+		const Fs_File *file = file_list->files[fs_hash(fileName, seed) % file_list->count];
+		if (strcmp(file->name, fileName) == 0)
+			return file;
+		return NULL;
+	}
 
 	for (i=0; i<file_list->count; i++)
 	{
@@ -13,6 +13,7 @@
 
 #include "fs_data.h"
 
+uint16_t fs_hash(const char *name, uint16_t seed);
 const Fs_File *getFile(const Fs_FilesList *web_server_file_list, const char *fileName);
 
 #endif // FS_FUNCTIONS_H
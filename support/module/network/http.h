@@ -11,6 +11,11 @@
 #ifndef HTTP_H
 #define HTTP_H
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sys/buffer.h"
+
 // http querry parser
 typedef enum
 {
@@ -35,6 +40,77 @@ typedef struct
 void http_parse_init(HTTP_PARSER *parser, char *querry_str);
 HTTP_QUERRY_TYPE http_parse_querry(HTTP_PARSER *parser, char *url);
 int http_parse_field(HTTP_PARSER *parser, char *name, char *value);
+const char *http_parse_header(const HTTP_PARSER *parser, const char *name, size_t *size);
+int http_header_has_token(const char *value, size_t size, const char *token);
+int http_header_match_etag(const char *value, size_t size, const char *etag);
+int http_header_parse_range(const char *value, size_t size, uint32_t length, uint32_t *first, uint32_t *last);
+
+// http incremental request parser
+#ifndef HTTP_REQUEST_MAX_HEADERS
+ #define HTTP_REQUEST_MAX_HEADERS 16
+#endif
+
+typedef enum
+{
+    HTTP_REQUEST_METHOD = 0,
+    HTTP_REQUEST_URL,
+    HTTP_REQUEST_QUERY,
+    HTTP_REQUEST_VERSION,
+    HTTP_REQUEST_LINE_END,      // LF of the request line
+    HTTP_REQUEST_HEADER_START,  // header name or empty line
+    HTTP_REQUEST_HEADER_NAME,
+    HTTP_REQUEST_HEADER_VALUE,
+    HTTP_REQUEST_HEADER_END,    // LF of a header line
+    HTTP_REQUEST_HEADERS_END,   // LF of the empty line
+    HTTP_REQUEST_BODY,
+    HTTP_REQUEST_COMPLETE,
+    HTTP_REQUEST_ERROR
+} HTTP_REQUEST_STATE;
+
+/**
+ * @brief HTTP_SLICE part of the request in the parser buffer, NUL terminated
+ */
+typedef struct
+{
+    char *ptr;
+    uint16_t size;
+} HTTP_SLICE;
+
+typedef struct
+{
+    HTTP_SLICE name;
+    HTTP_SLICE value;
+} HTTP_HEADER;
+
+/**
+ * @brief HTTP_REQUEST request parser, fed with received packets. The request
+ * is stored once in buffer and all slices point in it, the path is percent
+ * decoded in place. The body must fit in the buffer after the headers.
+ */
+typedef struct
+{
+    char *buffer;
+    uint16_t bufferSize;
+    uint16_t size;          // bytes stored in buffer
+    uint16_t mark;          // start of the current token
+    HTTP_REQUEST_STATE state;
+    int error;              // status code to answer if state is HTTP_REQUEST_ERROR
+
+    HTTP_QUERRY_TYPE type;
+    uint8_t versionMinor;   // HTTP/1.x
+    HTTP_SLICE method;
+    HTTP_SLICE path;
+    HTTP_SLICE query;
+    HTTP_HEADER headers[HTTP_REQUEST_MAX_HEADERS];
+    uint8_t headerCount;
+    uint32_t contentLength;
+    HTTP_SLICE body;
+} HTTP_REQUEST;
+
+void http_request_init(HTTP_REQUEST *request, char *buffer, uint16_t bufferSize);
+void http_request_reset(HTTP_REQUEST *request);
+int http_request_feed(HTTP_REQUEST *request, const char *data, uint16_t size);
+const HTTP_SLICE *http_request_header(const HTTP_REQUEST *request, const char *name);
 
 // http formater
 enum {
@@ -54,17 +130,48 @@ enum {
     HTTP_UNAUTHORIZED = 401, // authentication needed, respond with auth hdr
     HTTP_PAYMENT_REQUIRED = 402,
     HTTP_NOT_FOUND = 404,
+    HTTP_METHOD_NOT_ALLOWED = 405,  // respond with an Allow field
     HTTP_FORBIDDEN = 403,
     HTTP_REQUEST_TIMEOUT = 408,
+    HTTP_LENGTH_REQUIRED = 411,
+    HTTP_PAYLOAD_TOO_LARGE = 413,
+    HTTP_URI_TOO_LONG = 414,
+    HTTP_RANGE_NOT_SATISFIABLE = 416,
+    HTTP_UPGRADE_REQUIRED = 426,    // respond with an Upgrade field
+    HTTP_HEADER_FIELDS_TOO_LARGE = 431,
     HTTP_INTERNAL_SERVER_ERROR = 500,
     HTTP_NOT_IMPLEMENTED = 501,   // used for unrecognized requests
     HTTP_BAD_GATEWAY = 502,
-    HTTP_SERVICE_UNAVAILABLE = 503 // overload, maintenance
+    HTTP_SERVICE_UNAVAILABLE = 503, // overload, maintenance
+    HTTP_VERSION_NOT_SUPPORTED = 505
 };
 
+const char *http_status_reason(int code);
+
+// header builder, fields are appended at the tail of the buffer, truncated
+// if it is full
+void http_buffer_status(Buffer *buffer, int code);
+void http_buffer_field(Buffer *buffer, const char *name, const char *value);
+void http_buffer_content_type(Buffer *buffer, const char *content_type);
+void http_buffer_content_length(Buffer *buffer, uint32_t content_length);
+void http_buffer_content_encoding(Buffer *buffer, const char *content_encoding);
+void http_buffer_content_range(Buffer *buffer, uint32_t first, uint32_t last, uint32_t length);
+void http_buffer_chunked(Buffer *buffer);
+void http_buffer_end(Buffer *buffer);
+
+// chunked transfer encoding, a chunk is its size in HTTP_CHUNK_HEAD bytes,
+// the data and HTTP_CHUNK_TAIL bytes. A chunk of size 0 ends the body
+#define HTTP_CHUNK_HEAD 6   // 4 hex digits size and CRLF
+#define HTTP_CHUNK_TAIL 2   // CRLF
+#define HTTP_CHUNK_MAX  0xFFFF
+uint16_t http_write_chunk(char *chunk, uint16_t size);
+
+// same on a 0 terminated string, http_write_header_code starts the header
 void http_write_header_code(char *buffer, int result_code);
 void http_write_content_type(char *buffer, const char *content_type);
 void http_write_content_length(char *buffer, unsigned int content_length);
+void http_write_content_encoding(char *buffer, const char *content_encoding);
+void http_write_header_field(char *buffer, const char *name, const char *value);
 void http_write_header_end(char *buffer);
 
 #endif // HTTP_H
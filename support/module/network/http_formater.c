@@ -13,40 +13,290 @@
 #include <string.h>
 #include <stdlib.h>
 
-void http_write_header_code(char *buffer, int result_code)
+typedef struct
+{
+    uint16_t code;
+    const char *reason;
+} HTTP_STATUS;
+
+// reason phrases of the status codes of the enum, sorted by code
+static const HTTP_STATUS http_status[] =
+{
+    {HTTP_CONTINUE, "Continue"},
+    {HTTP_SWITCHING_PROTOCOLS, "Switching Protocols"},
+    {HTTP_OK, "OK"},
+    {HTTP_CREATED, "Created"},
+    {HTTP_ACCEPTED, "Accepted"},
+    {HTTP_NON_AUTHORITATIVE_INFO, "Non-Authoritative Information"},
+    {HTTP_NO_CONTENT, "No Content"},
+    {HTTP_PARTIAL_CONTENT, "Partial Content"},
+    {HTTP_MULTIPLE_CHOICES, "Multiple Choices"},
+    {HTTP_MOVED_PERMANENTLY, "Moved Permanently"},
+    {HTTP_MOVED_TEMPORARILY, "Found"},
+    {HTTP_NOT_MODIFIED, "Not Modified"},
+    {HTTP_BAD_REQUEST, "Bad Request"},
+    {HTTP_UNAUTHORIZED, "Unauthorized"},
+    {HTTP_PAYMENT_REQUIRED, "Payment Required"},
+    {HTTP_FORBIDDEN, "Forbidden"},
+    {HTTP_NOT_FOUND, "Not Found"},
+    {HTTP_METHOD_NOT_ALLOWED, "Method Not Allowed"},
+    {HTTP_REQUEST_TIMEOUT, "Request Timeout"},
+    {HTTP_LENGTH_REQUIRED, "Length Required"},
+    {HTTP_PAYLOAD_TOO_LARGE, "Payload Too Large"},
+    {HTTP_URI_TOO_LONG, "URI Too Long"},
+    {HTTP_RANGE_NOT_SATISFIABLE, "Range Not Satisfiable"},
+    {HTTP_UPGRADE_REQUIRED, "Upgrade Required"},
+    {HTTP_HEADER_FIELDS_TOO_LARGE, "Request Header Fields Too Large"},
+    {HTTP_INTERNAL_SERVER_ERROR, "Internal Server Error"},
+    {HTTP_NOT_IMPLEMENTED, "Not Implemented"},
+    {HTTP_BAD_GATEWAY, "Bad Gateway"},
+    {HTTP_SERVICE_UNAVAILABLE, "Service Unavailable"},
+    {HTTP_VERSION_NOT_SUPPORTED, "HTTP Version Not Supported"}
+};
+
+// internal functions
+static void http_buffer_uint(Buffer *buffer, uint32_t value);
+static void http_string(Buffer *buffer, char *string);
+
+/**
+ * @brief http_status_reason reason phrase of a status code
+ * @return reason, empty string for unknown codes
+ */
+const char *http_status_reason(int code)
 {
-    strcpy(buffer, "HTTP/1.1 ");
-    switch (result_code)
+    uint8_t min = 0, max = sizeof(http_status) / sizeof(HTTP_STATUS);
+
+    while (min < max)
     {
-    case HTTP_OK:
-        strcat(buffer, "200 OK\r\n");
-        break;
-    case HTTP_BAD_REQUEST:
-        strcat(buffer, "400 Bad Request\r\n");
-        break;
-    case HTTP_NOT_FOUND:
-        strcat(buffer, "404 Not Found\r\n");
-        break;
-    default:
-        break;
+        uint8_t mid = (min + max) / 2;
+        if (http_status[mid].code == code)
+            return http_status[mid].reason;
+        if (http_status[mid].code < code)
+            min = mid + 1;
+        else
+            max = mid;
     }
+    return "";
+}
+
+// decimal digits, buffer_aint is limited to int
+static void http_buffer_uint(Buffer *buffer, uint32_t value)
+{
+    char digits[11];
+    char *ptr = digits + sizeof(digits) - 1;
+
+    *ptr = 0;
+    do
+    {
+        *--ptr = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    buffer_astring(buffer, ptr);
+}
+
+/**
+ * @brief http_buffer_status clears the buffer and writes the status line
+ */
+void http_buffer_status(Buffer *buffer, int code)
+{
+    buffer_clear(buffer);
+    buffer_astring(buffer, "HTTP/1.1 ");
+    http_buffer_uint(buffer, code);
+    buffer_achar(buffer, ' ');
+    buffer_astring(buffer, http_status_reason(code));
+    buffer_astring(buffer, "\r\n");
+}
+
+void http_buffer_field(Buffer *buffer, const char *name, const char *value)
+{
+    buffer_astring(buffer, name);
+    buffer_astring(buffer, ": ");
+    buffer_astring(buffer, value);
+    buffer_astring(buffer, "\r\n");
+}
+
+void http_buffer_content_type(Buffer *buffer, const char *content_type)
+{
+    http_buffer_field(buffer, "Content-Type", content_type);
+}
+
+void http_buffer_content_length(Buffer *buffer, uint32_t content_length)
+{
+    buffer_astring(buffer, "Content-Length: ");
+    http_buffer_uint(buffer, content_length);
+    buffer_astring(buffer, "\r\n");
+}
+
+void http_buffer_content_encoding(Buffer *buffer, const char *content_encoding)
+{
+    http_buffer_field(buffer, "Content-Encoding", content_encoding);
+}
+
+/**
+ * @brief http_buffer_content_range range of a 206 response, or of a 416
+ * response if first is after last (bytes * /length)
+ */
+void http_buffer_content_range(Buffer *buffer, uint32_t first, uint32_t last, uint32_t length)
+{
+    buffer_astring(buffer, "Content-Range: bytes ");
+    if (first > last)
+        buffer_achar(buffer, '*');
+    else
+    {
+        http_buffer_uint(buffer, first);
+        buffer_achar(buffer, '-');
+        http_buffer_uint(buffer, last);
+    }
+    buffer_achar(buffer, '/');
+    http_buffer_uint(buffer, length);
+    buffer_astring(buffer, "\r\n");
+}
+
+/**
+ * @brief http_buffer_chunked body sent with http_write_chunk, when its size
+ * is not known in advance (HTTP/1.1 only)
+ */
+void http_buffer_chunked(Buffer *buffer)
+{
+    http_buffer_field(buffer, "Transfer-Encoding", "chunked");
+}
+
+void http_buffer_end(Buffer *buffer)
+{
+    buffer_astring(buffer, "\r\n");
+}
+
+/**
+ * @brief http_write_chunk frames size bytes of data written at
+ * chunk + HTTP_CHUNK_HEAD, the chunk buffer needs HTTP_CHUNK_TAIL more bytes
+ * @return size of the whole chunk
+ */
+uint16_t http_write_chunk(char *chunk, uint16_t size)
+{
+    static const char hex[] = "0123456789ABCDEF";
+
+    // fixed width size, leading zeros are allowed
+    chunk[0] = hex[(size >> 12) & 0x0F];
+    chunk[1] = hex[(size >> 8) & 0x0F];
+    chunk[2] = hex[(size >> 4) & 0x0F];
+    chunk[3] = hex[size & 0x0F];
+    chunk[4] = '\r';
+    chunk[5] = '\n';
+    chunk[HTTP_CHUNK_HEAD + size] = '\r';
+    chunk[HTTP_CHUNK_HEAD + size + 1] = '\n';
+    return HTTP_CHUNK_HEAD + size + HTTP_CHUNK_TAIL;
+}
+
+// appends to a 0 terminated string with the Buffer functions, the end is
+// searched once per call
+static void http_string(Buffer *buffer, char *string)
+{
+    size_t size = strlen(string);
+    buffer->data = string;
+    buffer->size = size;
+    buffer->tail = string + size;
+    buffer->data_size = (size_t)-1 / 2;     // no limit, as strcat
+}
+
+void http_write_header_code(char *buffer, int result_code)
+{
+    Buffer header;
+    buffer[0] = 0;
+    http_string(&header, buffer);
+    http_buffer_status(&header, result_code);
 }
 
 void http_write_content_type(char *buffer, const char *content_type)
 {
-    strcat(buffer, "Content-Type: ");
-    strcat(buffer, content_type);
-    strcat(buffer, "\r\n");
+    Buffer header;
+    http_string(&header, buffer);
+    http_buffer_content_type(&header, content_type);
 }
 
 void http_write_content_length(char *buffer, unsigned int content_length)
 {
-    strcat(buffer, "Content-Length: ");
-    // strcat(buffer, content_length);
-    strcat(buffer, "\r\n");
+    Buffer header;
+    http_string(&header, buffer);
+    http_buffer_content_length(&header, content_length);
+}
+
+void http_write_content_encoding(char *buffer, const char *content_encoding)
+{
+    Buffer header;
+    http_string(&header, buffer);
+    http_buffer_content_encoding(&header, content_encoding);
+}
+
+void http_write_header_field(char *buffer, const char *name, const char *value)
+{
+    Buffer header;
+    http_string(&header, buffer);
+    http_buffer_field(&header, name, value);
 }
 
 void http_write_header_end(char *buffer)
 {
-    strcat(buffer, "\r\n");
+    Buffer header;
+    http_string(&header, buffer);
+    http_buffer_end(&header);
+}
+
+#ifdef TEST
+// gcc -DTEST -I../../../include http_formater.c ../../sys/buffer.c
+#include <stdio.h>
+#include <assert.h>
+
+int main(void)
+{
+    char data[128], string[256], chunk[32];
+    Buffer header;
+    unsigned int i;
+
+    // every status of the enum has a reason
+    for (i = 0; i < sizeof(http_status) / sizeof(HTTP_STATUS); i++)
+    {
+        assert( http_status_reason(http_status[i].code)[0] != 0 );
+        if (i > 0)
+            assert( http_status[i - 1].code < http_status[i].code );
+    }
+    assert( strcmp(http_status_reason(HTTP_PARTIAL_CONTENT), "Partial Content") == 0 );
+    assert( http_status_reason(299)[0] == 0 );
+
+    // builder, truncated to the buffer size
+    buffer_init(&header, data, sizeof(data));
+    http_buffer_status(&header, HTTP_SERVICE_UNAVAILABLE);
+    http_buffer_content_length(&header, 4000000000UL);
+    http_buffer_end(&header);
+    assert( strcmp(data, "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 4000000000\r\n\r\n") == 0 );
+    assert( header.size == strlen(data) );
+    http_buffer_status(&header, HTTP_OK);
+    http_buffer_field(&header, "X-Long", "0123456789012345678901234567890123456789012345678901234567890123456789"
+                                        "0123456789012345678901234567890123456789012345678901234567890123456789");
+    assert( header.size == sizeof(data) - 1 && strlen(data) == sizeof(data) - 1 );
+    http_buffer_status(&header, 299);
+    assert( strcmp(data, "HTTP/1.1 299 \r\n") == 0 );
+
+    // ranges
+    http_buffer_status(&header, HTTP_PARTIAL_CONTENT);
+    http_buffer_content_range(&header, 0, 99, 1000);
+    http_buffer_content_range(&header, 1, 0, 1000);
+    assert( strcmp(data, "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 0-99/1000\r\nContent-Range: bytes */1000\r\n") == 0 );
+
+    // string api
+    http_write_header_code(string, HTTP_NOT_FOUND);
+    http_write_content_type(string, "text/html");
+    http_write_content_length(string, 0);
+    http_write_header_end(string);
+    assert( strcmp(string, "HTTP/1.1 404 Not Found\r\nContent-Type: text/html\r\nContent-Length: 0\r\n\r\n") == 0 );
+
+    // chunks
+    memcpy(chunk + HTTP_CHUNK_HEAD, "hello world", 11);
+    assert( http_write_chunk(chunk, 11) == 19 );
+    assert( memcmp(chunk, "000B\r\nhello world\r\n", 19) == 0 );
+    assert( http_write_chunk(chunk, 0) == 8 );
+    assert( memcmp(chunk, "0000\r\n\r\n", 8) == 0 );
+
+    puts("http_formater OK");
+    return 0;
 }
+#endif
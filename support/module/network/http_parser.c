@@ -14,6 +14,44 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+// internal functions
+static int http_strncasecmp(const char *str1, const char *str2, size_t size);
+static int http_is_space(char c);
+static int http_is_tchar(char c);
+static int http_is_ctl(char c);
+static int http_hex_digit(char c);
+static int http_request_fail(HTTP_REQUEST *request, int error);
+static void http_request_slice(HTTP_REQUEST *request, HTTP_SLICE *slice, uint16_t end);
+static int http_request_decode_path(HTTP_REQUEST *request);
+static int http_request_method(HTTP_REQUEST *request);
+static int http_request_version(HTTP_REQUEST *request);
+static int http_request_header_end(HTTP_REQUEST *request);
+static int http_request_headers_end(HTTP_REQUEST *request);
+static uint16_t http_request_parse_whole(HTTP_REQUEST *request, const char *data, uint16_t size);
+static int http_request_parse_lines(HTTP_REQUEST *request, uint16_t headersSize);
+
+static int http_strncasecmp(const char *str1, const char *str2, size_t size)
+{
+    while (size-- > 0)
+    {
+        char c1 = *str1++, c2 = *str2++;
+        if (c1 >= 'A' && c1 <= 'Z')
+            c1 += 'a' - 'A';
+        if (c2 >= 'A' && c2 <= 'Z')
+            c2 += 'a' - 'A';
+        if (c1 != c2)
+            return c1 - c2;
+        if (c1 == 0)
+            return 0;
+    }
+    return 0;
+}
+
+static int http_is_space(char c)
+{
+    return (c == ' ' || c == '\t');
+}
+
 void http_parse_init(HTTP_PARSER *parser, char *querry_str)
 {
     parser->querry_str = querry_str;
@@ -110,7 +148,6 @@ HTTP_QUERRY_TYPE http_parse_querry(HTTP_PARSER *parser, char *url)
 
     parser->type = type;
     parser->ptr = pt_end_line + 2;
-    puts(parser->ptr);
     return type;
 }
 
@@ -147,9 +184,766 @@ int http_parse_field(HTTP_PARSER *parser, char *name, char *value)
     return 0;
 }
 
+/**
+ * @brief http_parse_header finds a header field by its case insensitive name,
+ * without copy and without moving the parser, after http_parse_querry
+ * @param size size of the value, without surrounding spaces
+ * @return pointer to the value in the querry string, NULL if not present
+ */
+const char *http_parse_header(const HTTP_PARSER *parser, const char *name, size_t *size)
+{
+    const char *line, *end_line, *value;
+    size_t name_size = strlen(name);
+
+    if (parser->ptr == parser->querry_str)
+        return NULL;
+
+    line = parser->ptr;
+    while (*line != 0 && strncmp(line, "\r\n", 2) != 0)
+    {
+        end_line = strstr(line, "\r\n");
+        if (end_line == NULL)
+            return NULL;
+
+        if (http_strncasecmp(line, name, name_size) == 0 && line[name_size] == ':')
+        {
+            value = line + name_size + 1;
+            while (value < end_line && http_is_space(*value))
+                value++;
+            while (end_line > value && http_is_space(end_line[-1]))
+                end_line--;
+            *size = end_line - value;
+            return value;
+        }
+        line = end_line + 2;
+    }
+    return NULL;
+}
+
+/**
+ * @brief http_header_has_token checks if a comma separated header value, like
+ * Accept-Encoding, lists token without a null quality (q=0)
+ * @return 1 if token is accepted, 0 otherwise
+ */
+int http_header_has_token(const char *value, size_t size, const char *token)
+{
+    const char *end = value + size, *item_end;
+    size_t token_size = strlen(token);
+
+    while (value < end)
+    {
+        while (value < end && (http_is_space(*value) || *value == ','))
+            value++;
+        item_end = value;
+        while (item_end < end && *item_end != ',' && *item_end != ';' && !http_is_space(*item_end))
+            item_end++;
+
+        if ((size_t)(item_end - value) == token_size && http_strncasecmp(value, token, token_size) == 0)
+        {
+            // parameters, only the quality is checked
+            while (item_end < end && *item_end != ',')
+            {
+                if ((*item_end == 'q' || *item_end == 'Q') && item_end + 1 < end && item_end[1] == '=')
+                {
+                    item_end += 2;
+                    if (*item_end != '0')
+                        return 1;
+                    item_end++;
+                    if (item_end < end && *item_end == '.')
+                        item_end++;
+                    while (item_end < end && *item_end == '0')
+                        item_end++;
+                    return (item_end < end && *item_end >= '1' && *item_end <= '9');
+                }
+                item_end++;
+            }
+            return 1;
+        }
+
+        while (value < end && *value != ',')
+            value++;
+    }
+    return 0;
+}
+
+/**
+ * @brief http_header_match_etag checks if an If-None-Match value lists etag,
+ * with the weak comparison of RFC 7232 (W/ prefixes are ignored)
+ * @param etag quoted entity tag
+ * @return 1 if etag matches, 0 otherwise
+ */
+int http_header_match_etag(const char *value, size_t size, const char *etag)
+{
+    const char *end = value + size, *tag_end;
+    size_t etag_size;
+
+    if (strncmp(etag, "W/", 2) == 0)
+        etag += 2;
+    etag_size = strlen(etag);
+
+    while (value < end)
+    {
+        while (value < end && (http_is_space(*value) || *value == ','))
+            value++;
+        if (value >= end)
+            break;
+        if (*value == '*')
+            return 1;
+        if (end - value > 2 && strncmp(value, "W/", 2) == 0)
+            value += 2;
+        if (*value != '"')
+            return 0;
+
+        tag_end = value + 1;
+        while (tag_end < end && *tag_end != '"')
+            tag_end++;
+        if (tag_end >= end)
+            return 0;
+        tag_end++;
+
+        if ((size_t)(tag_end - value) == etag_size && strncmp(value, etag, etag_size) == 0)
+            return 1;
+        value = tag_end;
+    }
+    return 0;
+}
+
+/**
+ * @brief http_header_parse_range parses a Range value with a single byte
+ * range (RFC 7233), as bytes=first-last, bytes=first- or bytes=-suffix
+ * @param length size of the whole content
+ * @param first first byte of the range if valid
+ * @param last last byte of the range if valid, included
+ * @return 1 if the range is valid, 0 if the field is ignored (syntax, other
+ * unit or several ranges), -1 if the range is not satisfiable
+ */
+int http_header_parse_range(const char *value, size_t size, uint32_t length, uint32_t *first, uint32_t *last)
+{
+    const char *end = value + size;
+    uint32_t number[2] = {0, 0};
+    uint8_t digits[2] = {0, 0}, i = 0;
+
+    if (size < 6 || http_strncasecmp(value, "bytes=", 6) != 0)
+        return 0;
+    for (value += 6; value < end; value++)
+    {
+        char c = *value;
+        if (c >= '0' && c <= '9')
+        {
+            if (number[i] > (0xFFFFFFFFUL - 9) / 10)
+                number[i] = 0xFFFFFFFFUL;   // saturates, out of any content
+            else
+                number[i] = number[i] * 10 + (c - '0');
+            digits[i]++;
+        }
+        else if (c == '-' && i == 0)
+            i = 1;
+        else if (!http_is_space(c))
+            return 0;   // several ranges or invalid
+    }
+    if (i == 0 || (digits[0] == 0 && digits[1] == 0))
+        return 0;
+
+    if (digits[0] == 0)
+    {
+        // suffix, last bytes of the content
+        if (number[1] == 0 || length == 0)
+            return -1;
+        *first = (number[1] >= length) ? 0 : length - number[1];
+        *last = length - 1;
+        return 1;
+    }
+    if (digits[1] != 0 && number[1] < number[0])
+        return 0;
+    if (number[0] >= length)
+        return -1;
+    *first = number[0];
+    *last = (digits[1] == 0 || number[1] >= length) ? length - 1 : number[1];
+    return 1;
+}
+
+/**
+ * @brief http_request_init initializes an incremental request parser
+ * @param buffer storage of the request line, headers and body
+ * @param bufferSize size of buffer, limit of the whole request
+ */
+void http_request_init(HTTP_REQUEST *request, char *buffer, uint16_t bufferSize)
+{
+    request->buffer = buffer;
+    request->bufferSize = bufferSize;
+    http_request_reset(request);
+}
+
+/**
+ * @brief http_request_reset prepares the parser for the next request
+ */
+void http_request_reset(HTTP_REQUEST *request)
+{
+    request->size = 0;
+    request->mark = 0;
+    request->state = HTTP_REQUEST_METHOD;
+    request->error = 0;
+    request->type = HTTP_QUERRY_TYPE_ERROR;
+    request->versionMinor = 0;
+    request->method.ptr = request->path.ptr = request->query.ptr = request->body.ptr = request->buffer;
+    request->method.size = request->path.size = request->query.size = request->body.size = 0;
+    request->headerCount = 0;
+    request->contentLength = 0;
+}
+
+static int http_request_fail(HTTP_REQUEST *request, int error)
+{
+    request->state = HTTP_REQUEST_ERROR;
+    request->error = error;
+    return -1;
+}
+
+// ends the token started at mark, the separator at end is replaced by NUL
+static void http_request_slice(HTTP_REQUEST *request, HTTP_SLICE *slice, uint16_t end)
+{
+    slice->ptr = request->buffer + request->mark;
+    slice->size = end - request->mark;
+    request->buffer[end] = 0;
+    request->mark = end + 1;
+}
+
+static int http_hex_digit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// percent decodes the path in place
+static int http_request_decode_path(HTTP_REQUEST *request)
+{
+    char *src = request->path.ptr, *dst = request->path.ptr;
+    char *end = request->path.ptr + request->path.size;
+
+    if (request->path.size == 0)
+        return -1;
+    while (src < end)
+    {
+        if (*src == '%')
+        {
+            int high, low;
+            if (end - src < 3)
+                return -1;
+            high = http_hex_digit(src[1]);
+            low = http_hex_digit(src[2]);
+            if (high < 0 || low < 0 || (high | low) == 0)
+                return -1;
+            *dst++ = (high << 4) | low;
+            src += 3;
+        }
+        else
+            *dst++ = *src++;
+    }
+    *dst = 0;
+    request->path.size = dst - request->path.ptr;
+    return 0;
+}
+
+static int http_request_method(HTTP_REQUEST *request)
+{
+    static const char * const names[] = {"GET", "HEAD", "POST", "PUT", "DELETE",
+#ifdef HTTP_COMPLETE_PROTO
+                                         "CONNECT", "OPTIONS", "TRACE",
+#endif
+                                        };
+    static const HTTP_QUERRY_TYPE types[] = {HTTP_QUERRY_TYPE_GET, HTTP_QUERRY_TYPE_HEAD, HTTP_QUERRY_TYPE_POST,
+                                             HTTP_QUERRY_TYPE_PUT, HTTP_QUERRY_TYPE_DELETE,
+#ifdef HTTP_COMPLETE_PROTO
+                                             HTTP_QUERRY_TYPE_CONNECT, HTTP_QUERRY_TYPE_OPTIONS, HTTP_QUERRY_TYPE_TRACE,
+#endif
+                                            };
+    uint8_t i;
+
+    for (i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        if (strcmp(request->method.ptr, names[i]) == 0)
+        {
+            request->type = types[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int http_request_version(HTTP_REQUEST *request)
+{
+    HTTP_SLICE version;
+
+    http_request_slice(request, &version, request->size - 1);
+    if (strncmp(version.ptr, "HTTP/", 5) != 0)
+        return http_request_fail(request, HTTP_BAD_REQUEST);
+    if (strcmp(version.ptr + 5, "1.1") == 0)
+        request->versionMinor = 1;
+    else if (strcmp(version.ptr + 5, "1.0") == 0)
+        request->versionMinor = 0;
+    else
+        return http_request_fail(request, HTTP_VERSION_NOT_SUPPORTED);
+    return 0;
+}
+
+// ends a header value, without surrounding spaces
+static int http_request_header_end(HTTP_REQUEST *request)
+{
+    HTTP_HEADER *header = &request->headers[request->headerCount];
+    uint16_t end = request->size - 1;
+
+    while (end > request->mark && http_is_space(request->buffer[end - 1]))
+        end--;
+    http_request_slice(request, &header->value, end);
+    request->headerCount++;
+
+    // framing of the body
+    if (http_strncasecmp(header->name.ptr, "Content-Length", 15) == 0)
+    {
+        uint32_t length = 0;
+        char *ptr = header->value.ptr;
+
+        if (*ptr == 0)
+            return http_request_fail(request, HTTP_BAD_REQUEST);
+        for (; *ptr != 0; ptr++)
+        {
+            if (*ptr < '0' || *ptr > '9')
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            if (length > (UINT16_MAX / 10))
+                return http_request_fail(request, HTTP_PAYLOAD_TOO_LARGE);
+            length = length * 10 + (*ptr - '0');
+        }
+        if (request->contentLength != 0 && request->contentLength != length)
+            return http_request_fail(request, HTTP_BAD_REQUEST);
+        request->contentLength = length;
+    }
+    else if (http_strncasecmp(header->name.ptr, "Transfer-Encoding", 18) == 0)
+        return http_request_fail(request, HTTP_NOT_IMPLEMENTED);    // chunked bodies are not supported
+    return 0;
+}
+
+static int http_request_headers_end(HTTP_REQUEST *request)
+{
+    request->body.ptr = request->buffer + request->size;
+    if (request->contentLength == 0)
+    {
+        request->buffer[request->size] = 0;
+        request->state = HTTP_REQUEST_COMPLETE;
+        return 0;
+    }
+    // the body and its NUL must fit in the buffer
+    if (request->contentLength >= (uint32_t)(request->bufferSize - request->size))
+        return http_request_fail(request, HTTP_PAYLOAD_TOO_LARGE);
+    request->state = HTTP_REQUEST_BODY;
+    return 0;
+}
+
+static int http_is_tchar(char c)
+{
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return 1;
+    return (c != 0 && strchr("!#$%&'*+-.^_`|~", c) != NULL);
+}
+
+static int http_is_ctl(char c)
+{
+    return ((unsigned char)c < 0x20 || c == 0x7F);
+}
+
+/**
+ * @brief http_request_parse_whole parses the request line and the headers of
+ * a request received at once, line by line instead of byte by byte. Only
+ * valid requests with CRLF line ends are parsed, anything else is left to
+ * the byte parser which gives the status code of the error
+ * @return number of bytes used, up to the end of the headers, 0 if the
+ * request is left to the byte parser
+ */
+static uint16_t http_request_parse_whole(HTTP_REQUEST *request, const char *data, uint16_t size)
+{
+    const char *end = data + size, *found = data;
+    uint16_t headersSize;
+
+    // end of the headers, they must fit in the buffer as for the byte parser
+    if (size > request->bufferSize - 1)
+        end = data + request->bufferSize - 1;
+    for (;;)
+    {
+        found = memchr(found, '\n', end - found);
+        if (found == NULL)
+            return 0;
+        if (found - data >= 3 && found[-1] == '\r' && found[-2] == '\n' && found[-3] == '\r')
+            break;
+        found++;
+    }
+    headersSize = found + 1 - data;
+    memcpy(request->buffer, data, headersSize);
+
+    if (http_request_parse_lines(request, headersSize) < 0)
+    {
+        http_request_reset(request);
+        return 0;
+    }
+    return headersSize;
+}
+
+// tokenizes the request line and the headers copied in the buffer
+static int http_request_parse_lines(HTTP_REQUEST *request, uint16_t headersSize)
+{
+    char *buffer = request->buffer, *line, *eol, *sep, *query, *ptr;
+
+    // request line, method
+    line = buffer;
+    eol = memchr(line, '\n', headersSize);
+    sep = memchr(line, ' ', eol - line);
+    if (eol == line || eol[-1] != '\r' || sep == NULL || sep == line || sep - line > 7)
+        return -1;
+    for (ptr = line; ptr < sep; ptr++)
+    {
+        if (*ptr < 'A' || *ptr > 'Z')
+            return -1;
+    }
+    http_request_slice(request, &request->method, sep - buffer);
+    if (http_request_method(request) < 0)
+        return -1;
+
+    // path and query
+    line = sep + 1;
+    sep = memchr(line, ' ', eol - line);
+    if (sep == NULL)
+        return -1;
+    for (ptr = line; ptr < sep; ptr++)
+    {
+        if (http_is_ctl(*ptr))
+            return -1;
+    }
+    query = memchr(line, '?', sep - line);
+    http_request_slice(request, &request->path, (query != NULL ? query : sep) - buffer);
+    if (http_request_decode_path(request) < 0)
+        return -1;
+    if (query != NULL)
+        http_request_slice(request, &request->query, sep - buffer);
+    else
+        request->query.ptr = sep;
+
+    // version, ends at the CR
+    if (eol - 1 - (sep + 1) > 8)
+        return -1;
+    request->size = eol - buffer;
+    if (http_request_version(request) < 0)
+        return -1;
+
+    // headers, up to the empty line
+    for (;;)
+    {
+        line = eol + 1;
+        eol = memchr(line, '\n', buffer + headersSize - line);
+        if (eol[-1] != '\r')
+            return -1;
+        if (eol == line + 1)
+            break;
+
+        sep = memchr(line, ':', eol - line);
+        if (sep == NULL || sep == line || request->headerCount >= HTTP_REQUEST_MAX_HEADERS)
+            return -1;
+        for (ptr = line; ptr < sep; ptr++)
+        {
+            if (!http_is_tchar(*ptr))
+                return -1;
+        }
+        request->mark = line - buffer;
+        http_request_slice(request, &request->headers[request->headerCount].name, sep - buffer);
+
+        for (ptr = sep + 1; ptr < eol - 1 && http_is_space(*ptr); ptr++);
+        request->mark = ptr - buffer;
+        for (; ptr < eol - 1; ptr++)
+        {
+            if (http_is_ctl(*ptr) && *ptr != '\t')
+                return -1;
+        }
+        request->size = eol - buffer;
+        if (http_request_header_end(request) < 0)
+            return -1;
+    }
+
+    request->size = headersSize;
+    return http_request_headers_end(request);
+}
+
+/**
+ * @brief http_request_feed parses the next received bytes of a request, the
+ * request can be split in any number of packets
+ * @param data received bytes
+ * @param size number of bytes
+ * @return number of bytes used, less than size if the request is complete
+ * and the packet holds the start of a pipelined request, -1 if the request
+ * is invalid (error gives the status code to answer)
+ */
+int http_request_feed(HTTP_REQUEST *request, const char *data, uint16_t size)
+{
+    uint16_t used = 0;
+
+    // request line and headers in the first packet
+    if (request->state == HTTP_REQUEST_METHOD && request->size == 0)
+        used = http_request_parse_whole(request, data, size);
+
+    while (used < size)
+    {
+        char c;
+        uint16_t pos;
+
+        if (request->state == HTTP_REQUEST_COMPLETE)
+            break;
+        if (request->state == HTTP_REQUEST_ERROR)
+            return -1;
+
+        // body, copied by chunk
+        if (request->state == HTTP_REQUEST_BODY)
+        {
+            uint16_t chunk = size - used;
+            if (chunk > request->contentLength - request->body.size)
+                chunk = request->contentLength - request->body.size;
+            memcpy(request->buffer + request->size, data + used, chunk);
+            request->size += chunk;
+            request->body.size += chunk;
+            used += chunk;
+            if (request->body.size == request->contentLength)
+            {
+                request->buffer[request->size] = 0;
+                request->state = HTTP_REQUEST_COMPLETE;
+            }
+            continue;
+        }
+
+        // header values, copied by runs of plain characters
+        if (request->state == HTTP_REQUEST_HEADER_VALUE && request->mark != request->size)
+        {
+            uint16_t run = 0, room = request->bufferSize - 1 - request->size;
+            while (run < size - used && run < room && !http_is_ctl(data[used + run]))
+                run++;
+            if (run > 0)
+            {
+                memcpy(request->buffer + request->size, data + used, run);
+                request->size += run;
+                used += run;
+                continue;
+            }
+        }
+
+        // request line and headers, parsed byte by byte
+        if (request->size >= request->bufferSize - 1)
+        {
+            if (request->state <= HTTP_REQUEST_QUERY)
+                return http_request_fail(request, HTTP_URI_TOO_LONG);
+            return http_request_fail(request, HTTP_HEADER_FIELDS_TOO_LARGE);
+        }
+        c = data[used++];
+        pos = request->size;
+        request->buffer[request->size++] = c;
+
+        switch (request->state)
+        {
+        case HTTP_REQUEST_METHOD:
+            if ((c == '\r' || c == '\n') && pos == 0)
+                request->size = 0;  // empty lines before the request line are ignored
+            else if (c == ' ')
+            {
+                http_request_slice(request, &request->method, pos);
+                if (http_request_method(request) < 0)
+                    return http_request_fail(request, HTTP_NOT_IMPLEMENTED);
+                request->state = HTTP_REQUEST_URL;
+            }
+            else if (c < 'A' || c > 'Z' || pos >= 7)
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            break;
+
+        case HTTP_REQUEST_URL:
+        case HTTP_REQUEST_QUERY:
+            if (c == ' ' || (c == '?' && request->state == HTTP_REQUEST_URL))
+            {
+                if (request->state == HTTP_REQUEST_URL)
+                {
+                    http_request_slice(request, &request->path, pos);
+                    if (http_request_decode_path(request) < 0)
+                        return http_request_fail(request, HTTP_BAD_REQUEST);
+                    request->query.ptr = request->buffer + pos;
+                }
+                else
+                    http_request_slice(request, &request->query, pos);
+                request->state = (c == '?') ? HTTP_REQUEST_QUERY : HTTP_REQUEST_VERSION;
+            }
+            else if (http_is_ctl(c))
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            break;
+
+        case HTTP_REQUEST_VERSION:
+            if (c == '\r' || c == '\n')
+            {
+                if (http_request_version(request) < 0)
+                    return -1;
+                request->state = (c == '\r') ? HTTP_REQUEST_LINE_END : HTTP_REQUEST_HEADER_START;
+            }
+            else if (pos - request->mark >= 8)
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            break;
+
+        case HTTP_REQUEST_LINE_END:
+        case HTTP_REQUEST_HEADER_END:
+            if (c != '\n')
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            request->mark = request->size;
+            request->state = HTTP_REQUEST_HEADER_START;
+            break;
+
+        case HTTP_REQUEST_HEADER_START:
+            if (c == '\r')
+                request->state = HTTP_REQUEST_HEADERS_END;
+            else if (c == '\n')
+            {
+                if (http_request_headers_end(request) < 0)
+                    return -1;
+            }
+            else if (http_is_tchar(c))
+            {
+                request->mark = pos;
+                request->state = HTTP_REQUEST_HEADER_NAME;
+            }
+            else
+                return http_request_fail(request, HTTP_BAD_REQUEST);  // obsolete line folding included
+            break;
+
+        case HTTP_REQUEST_HEADER_NAME:
+            if (c == ':')
+            {
+                if (request->headerCount >= HTTP_REQUEST_MAX_HEADERS)
+                    return http_request_fail(request, HTTP_HEADER_FIELDS_TOO_LARGE);
+                http_request_slice(request, &request->headers[request->headerCount].name, pos);
+                request->state = HTTP_REQUEST_HEADER_VALUE;
+            }
+            else if (!http_is_tchar(c))
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            break;
+
+        case HTTP_REQUEST_HEADER_VALUE:
+            if (c == '\r' || c == '\n')
+            {
+                if (http_request_header_end(request) < 0)
+                    return -1;
+                request->state = (c == '\r') ? HTTP_REQUEST_HEADER_END : HTTP_REQUEST_HEADER_START;
+            }
+            else if (http_is_space(c) && pos == request->mark)
+                request->mark++;    // leading spaces
+            else if (http_is_ctl(c) && c != '\t')
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            break;
+
+        case HTTP_REQUEST_HEADERS_END:
+            if (c != '\n')
+                return http_request_fail(request, HTTP_BAD_REQUEST);
+            if (http_request_headers_end(request) < 0)
+                return -1;
+            break;
+
+        default:
+            return http_request_fail(request, HTTP_INTERNAL_SERVER_ERROR);
+        }
+    }
+    return used;
+}
+
+/**
+ * @brief http_request_header finds a header of a parsed request by its case
+ * insensitive name
+ * @return header value, NULL if not present
+ */
+const HTTP_SLICE *http_request_header(const HTTP_REQUEST *request, const char *name)
+{
+    uint8_t i;
+    size_t size = strlen(name);
+
+    for (i = 0; i < request->headerCount; i++)
+    {
+        if (request->headers[i].name.size == size && http_strncasecmp(request->headers[i].name.ptr, name, size) == 0)
+            return &request->headers[i].value;
+    }
+    return NULL;
+}
+
 #ifdef TEST
+// gcc -DTEST -I../../../include http_parser.c
 #include <stdio.h>
 #include <assert.h>
+#include <time.h>
+
+// feeds data in random packets of 1 to maxPacket bytes
+static int test_feed_split(HTTP_REQUEST *request, const char *data, int size, int maxPacket)
+{
+    int pos = 0;
+    while (pos < size && request->state != HTTP_REQUEST_COMPLETE)
+    {
+        int packet = 1 + rand() % maxPacket, used;
+        if (packet > size - pos)
+            packet = size - pos;
+        used = http_request_feed(request, data + pos, packet);
+        if (used < 0)
+            return -1;
+        pos += used;
+    }
+    return pos;
+}
+
+static void test_slice_bounds(const HTTP_REQUEST *request, const HTTP_SLICE *slice)
+{
+    assert( slice->ptr >= request->buffer );
+    assert( slice->ptr + slice->size < request->buffer + request->bufferSize );
+    assert( slice->ptr[slice->size] == 0 );
+}
+
+static void test_request_bounds(const HTTP_REQUEST *request)
+{
+    uint8_t i;
+    assert( request->size < request->bufferSize );
+    if (request->state != HTTP_REQUEST_COMPLETE)
+        return;
+    test_slice_bounds(request, &request->method);
+    test_slice_bounds(request, &request->path);
+    test_slice_bounds(request, &request->query);
+    test_slice_bounds(request, &request->body);
+    assert( request->headerCount <= HTTP_REQUEST_MAX_HEADERS );
+    for (i = 0; i < request->headerCount; i++)
+    {
+        test_slice_bounds(request, &request->headers[i].name);
+        test_slice_bounds(request, &request->headers[i].value);
+    }
+}
+
+static void test_request_equal(const HTTP_REQUEST *a, const HTTP_REQUEST *b)
+{
+    uint8_t i;
+    assert( a->state == b->state && a->type == b->type && a->versionMinor == b->versionMinor );
+    assert( strcmp(a->path.ptr, b->path.ptr) == 0 && strcmp(a->query.ptr, b->query.ptr) == 0 );
+    assert( a->body.size == b->body.size && memcmp(a->body.ptr, b->body.ptr, a->body.size) == 0 );
+    assert( a->headerCount == b->headerCount );
+    for (i = 0; i < a->headerCount; i++)
+    {
+        assert( strcmp(a->headers[i].name.ptr, b->headers[i].name.ptr) == 0 );
+        assert( strcmp(a->headers[i].value.ptr, b->headers[i].value.ptr) == 0 );
+    }
+}
+
+static int test_request_error(const char *data, uint16_t bufferSize)
+{
+    static char buffer[1024];
+    HTTP_REQUEST request;
+    http_request_init(&request, buffer, bufferSize);
+    if (http_request_feed(&request, data, strlen(data)) >= 0)
+        return 0;
+    return request.error;
+}
+
 int main(void)
 {
     char querry[]="GET /index%20r.html HTTP/1.1\r\n\
@@ -179,6 +973,190 @@ Cache-Control: max-age=0\r\n\
         num++;
 
     assert ( num == 9 );
+
+    const char *accept;
+    size_t size;
+    http_parse_init(&parser, querry);
+    http_parse_querry(&parser, url);
+    accept = http_parse_header(&parser, "accept-encoding", &size);
+    assert( accept != NULL && strncmp(accept, "gzip, deflate", size) == 0 );
+    assert( http_header_has_token(accept, size, "gzip") == 1 );
+    assert( http_header_has_token(accept, size, "deflate") == 1 );
+    assert( http_header_has_token(accept, size, "br") == 0 );
+    assert( http_parse_header(&parser, "Accept-Charset", &size) == NULL );
+    assert( http_header_has_token("gzip;q=0", 8, "gzip") == 0 );
+    assert( http_header_has_token("gzip ; q=0.000, br", 18, "gzip") == 0 );
+    assert( http_header_has_token("br, GZIP;q=0.5", 14, "gzip") == 1 );
+    assert( http_header_has_token("xgzip, gzipx", 12, "gzip") == 0 );
+
+    assert( http_header_match_etag("\"1a2b\"", 6, "\"1a2b\"") == 1 );
+    assert( http_header_match_etag("\"ff\", W/\"1a2b\"", 15, "\"1a2b\"") == 1 );
+    assert( http_header_match_etag("*", 1, "\"1a2b\"") == 1 );
+    assert( http_header_match_etag("\"1a2b3\", \"1a2\"", 14, "\"1a2b\"") == 0 );
+    assert( http_header_match_etag("\"1a2b", 5, "\"1a2b\"") == 0 );
+
+    // byte ranges
+    {
+        uint32_t first = 0, last = 0;
+        assert( http_header_parse_range("bytes=0-99", 10, 1000, &first, &last) == 1 && first == 0 && last == 99 );
+        assert( http_header_parse_range("bytes=900-", 10, 1000, &first, &last) == 1 && first == 900 && last == 999 );
+        assert( http_header_parse_range("bytes=-100", 10, 1000, &first, &last) == 1 && first == 900 && last == 999 );
+        assert( http_header_parse_range("bytes=-5000", 11, 1000, &first, &last) == 1 && first == 0 && last == 999 );
+        assert( http_header_parse_range("BYTES=10-5000", 13, 1000, &first, &last) == 1 && first == 10 && last == 999 );
+        assert( http_header_parse_range("bytes=1000-", 11, 1000, &first, &last) == -1 );
+        assert( http_header_parse_range("bytes=99999999999999-", 21, 1000, &first, &last) == -1 );
+        assert( http_header_parse_range("bytes=-0", 8, 1000, &first, &last) == -1 );
+        assert( http_header_parse_range("bytes=0-", 8, 0, &first, &last) == -1 );
+        assert( http_header_parse_range("bytes=5-1", 9, 1000, &first, &last) == 0 );
+        assert( http_header_parse_range("bytes=0-1,5-6", 13, 1000, &first, &last) == 0 );
+        assert( http_header_parse_range("bytes=-", 7, 1000, &first, &last) == 0 );
+        assert( http_header_parse_range("items=0-1", 9, 1000, &first, &last) == 0 );
+    }
+
+    // incremental parser, whole request
+    const char request_str[] = "GET /index%20r.html?lang=fr&x=1 HTTP/1.1\r\n\
+Host: 192.168.4.1\r\n\
+User-Agent: Mozilla/5.0 (Android 7.0; Mobile; rv:53.0) Gecko/53.0 Firefox/53.0\r\n\
+Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n\
+Accept-Language: fr,fr-FR;q=0.8,en-US;q=0.5,en;q=0.3\r\n\
+Accept-Encoding:gzip, deflate  \r\n\
+DNT: 1\r\n\
+Connection: keep-alive\r\n\
+Upgrade-Insecure-Requests: 1\r\n\
+Cache-Control: max-age=0\r\n\
+\r\n";
+    const int request_size = sizeof(request_str) - 1;
+    static char ref_buffer[1024], buffer[1024];
+    HTTP_REQUEST ref, request;
+    const HTTP_SLICE *slice;
+    int i, used;
+
+    http_request_init(&ref, ref_buffer, sizeof(ref_buffer));
+    assert( http_request_feed(&ref, request_str, request_size) == request_size );
+    assert( ref.state == HTTP_REQUEST_COMPLETE && ref.type == HTTP_QUERRY_TYPE_GET );
+    assert( ref.versionMinor == 1 );
+    assert( strcmp(ref.method.ptr, "GET") == 0 );
+    assert( strcmp(ref.path.ptr, "/index r.html") == 0 && ref.path.size == 13 );
+    assert( strcmp(ref.query.ptr, "lang=fr&x=1") == 0 );
+    assert( ref.headerCount == 9 && ref.body.size == 0 );
+    slice = http_request_header(&ref, "accept-encoding");
+    assert( slice != NULL && strcmp(slice->ptr, "gzip, deflate") == 0 && slice->size == 13 );
+    assert( http_request_header(&ref, "Accept-Charset") == NULL );
+    test_request_bounds(&ref);
+
+    // same request split in any number of packets
+    srand(1);
+    http_request_init(&request, buffer, sizeof(buffer));
+    for (i = 0; i < 5000; i++)
+    {
+        http_request_reset(&request);
+        assert( test_feed_split(&request, request_str, request_size, 1 + i % 64) == request_size );
+        test_request_equal(&ref, &request);
+    }
+
+    // body and pipelined request in the same packet
+    const char post_str[] = "POST /api/led HTTP/1.1\r\nContent-Length: 11\r\n\r\n{\"led\":255}\r\nGET / HTTP/1.0\n\n";
+    int post_used;
+    http_request_reset(&request);
+    used = post_used = http_request_feed(&request, post_str, sizeof(post_str) - 1);
+    assert( request.state == HTTP_REQUEST_COMPLETE && request.type == HTTP_QUERRY_TYPE_POST );
+    assert( strcmp(request.body.ptr, "{\"led\":255}") == 0 && request.body.size == 11 );
+    assert( strncmp(post_str + used, "\r\nGET", 5) == 0 );
+    http_request_reset(&request);
+    assert( http_request_feed(&request, post_str + used, sizeof(post_str) - 1 - used) == (int)sizeof(post_str) - 1 - used );
+    assert( request.state == HTTP_REQUEST_COMPLETE && request.versionMinor == 0 );
+    assert( strcmp(request.path.ptr, "/") == 0 && request.headerCount == 0 );
+    for (i = 0; i < 1000; i++)
+    {
+        http_request_reset(&request);
+        used = test_feed_split(&request, post_str, sizeof(post_str) - 1, 1 + i % 16);
+        assert( used == post_used && strcmp(request.body.ptr, "{\"led\":255}") == 0 );
+    }
+
+    // limits and malformed requests
+    assert( test_request_error("GET /aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa HTTP/1.1\r\n\r\n", 64) == HTTP_URI_TOO_LONG );
+    assert( test_request_error("GET / HTTP/1.1\r\nCookie: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n\r\n", 64) == HTTP_HEADER_FIELDS_TOO_LARGE );
+    assert( test_request_error("GET / HTTP/1.1\r\na:\r\nb:\r\nc:\r\nd:\r\ne:\r\nf:\r\ng:\r\nh:\r\ni:\r\nj:\r\nk:\r\nl:\r\nm:\r\nn:\r\no:\r\np:\r\nq:\r\n\r\n", 1024) == HTTP_HEADER_FIELDS_TOO_LARGE );
+    assert( test_request_error("POST / HTTP/1.1\r\nContent-Length: 2000\r\n\r\n", 1024) == HTTP_PAYLOAD_TOO_LARGE );
+    assert( test_request_error("POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n", 1024) == HTTP_PAYLOAD_TOO_LARGE );
+    assert( test_request_error("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n", 1024) == HTTP_NOT_IMPLEMENTED );
+    assert( test_request_error("BREW /pot HTTP/1.1\r\n\r\n", 1024) == HTTP_NOT_IMPLEMENTED );
+    assert( test_request_error("get / HTTP/1.1\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET / HTTP/2.0\r\n\r\n", 1024) == HTTP_VERSION_NOT_SUPPORTED );
+    assert( test_request_error("GET / FTP/1.1\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET /%2 HTTP/1.1\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET /%00 HTTP/1.1\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET / HTTP/1.1\r\nHost: a\r\n folded\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET / HTTP/1.1\r\nBad Name: a\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+    assert( test_request_error("GET / HTTP/1.1\r\r\n\r\n", 1024) == HTTP_BAD_REQUEST );
+
+    // fuzz, mutated requests in random packets never overflow the buffer
+    static char fuzz_str[sizeof(request_str)];
+    int complete = 0, failed = 0;
+    for (i = 0; i < 100000; i++)
+    {
+        int mutations = 1 + rand() % 8;
+        memcpy(fuzz_str, request_str, request_size);
+        while (mutations-- > 0)
+            fuzz_str[rand() % request_size] = (i & 1) ? rand() : " :\r\n%?/Hh0"[rand() % 10];
+
+        http_request_init(&request, buffer, 128 + rand() % (sizeof(buffer) - 128));
+        used = test_feed_split(&request, fuzz_str, request_size, 1 + rand() % 64);
+        assert( used == -1 || (used >= 0 && used <= request_size) );
+        assert( (used == -1) == (request.state == HTTP_REQUEST_ERROR) );
+        if (request.state == HTTP_REQUEST_ERROR)
+            assert( request.error >= 400 && request.error <= 505 );
+        test_request_bounds(&request);
+
+        // received at once, same result as the byte parser
+        http_request_init(&ref, ref_buffer, request.bufferSize);
+        assert( http_request_feed(&ref, fuzz_str, request_size) == used );
+        assert( ref.state == request.state && ref.error == request.error );
+        test_request_bounds(&ref);
+        if (request.state == HTTP_REQUEST_COMPLETE)
+            test_request_equal(&ref, &request);
+        complete += (request.state == HTTP_REQUEST_COMPLETE);
+        failed += (request.state == HTTP_REQUEST_ERROR);
+    }
+    printf("fuzz : %d complete, %d rejected, %d incomplete\n", complete, failed, 100000 - complete - failed);
+
+    // throughput on host, whole request and byte by byte
+    clock_t start;
+    const int bench_count = 200000;
+    double seconds;
+
+    start = clock();
+    for (i = 0; i < bench_count; i++)
+    {
+        http_request_reset(&request);
+        http_request_feed(&request, request_str, request_size);
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("bench whole : %.1f MB/s, %.0f requests/s\n", bench_count * request_size / seconds / 1e6, bench_count / seconds);
+
+    start = clock();
+    for (i = 0; i < bench_count / 10; i++)
+    {
+        int pos;
+        http_request_reset(&request);
+        for (pos = 0; pos < request_size; pos++)
+            http_request_feed(&request, request_str + pos, 1);
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("bench bytes : %.1f MB/s, %.0f requests/s\n", bench_count / 10 * request_size / seconds / 1e6, bench_count / 10 / seconds);
+
+    start = clock();
+    for (i = 0; i < bench_count; i++)
+    {
+        char copy[sizeof(request_str)];
+        memcpy(copy, request_str, sizeof(request_str));
+        http_parse_init(&parser, copy);
+        http_parse_querry(&parser, url);
+        while (http_parse_field(&parser, name, value) == 0);
+    }
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("bench strstr : %.1f MB/s, %.0f requests/s\n", bench_count * request_size / seconds / 1e6, bench_count / seconds);
     return 0;
 };
 
@@ -13,6 +13,7 @@
 
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include "sys/buffer.h"
 
@@ -49,7 +50,85 @@ void json_open_list(JsonBuffer *json);
 void json_close_list(JsonBuffer *json);
 void json_add_list(JsonBuffer *json, const char *name);
 
+//STREAMED WRITING
+// output of a full JsonWriter buffer, returns -1 in case of error
+typedef int (*JSON_WRITER_FLUSH)(const char *data, uint16_t size, void *arg);
+
+#define JSON_WRITER_DEPTH 16    ///< max nesting of objects and arrays
+#define JSON_ERROR_FLUSH -4     ///< the flush callback failed
+
+/**
+ * @brief JsonWriter compact JSON output through a small buffer, flushed when
+ * full, or filled in place by web_server_stream producers
+ */
+typedef struct
+{
+    char *data;
+    uint16_t size;      ///< buffer size
+    uint16_t pos;       ///< written bytes in the buffer
+    JSON_WRITER_FLUSH flush;
+    void *arg;
+    uint16_t items;     ///< bit n is set once the level n has a value
+    uint8_t level;
+    int8_t error;       ///< 0 or the first JSON_ERROR_*
+} JsonWriter;
+
+void json_writer_init(JsonWriter *json, char *data, uint16_t size, JSON_WRITER_FLUSH flush, void *arg);
+void json_writer_setBuffer(JsonWriter *json, char *data, uint16_t size);
+uint16_t json_writer_size(const JsonWriter *json);
+uint16_t json_writer_free(const JsonWriter *json);
+int json_writer_flush(JsonWriter *json);
+
+void json_writer_open_object(JsonWriter *json, const char *name);
+void json_writer_close_object(JsonWriter *json);
+void json_writer_open_array(JsonWriter *json, const char *name);
+void json_writer_close_array(JsonWriter *json);
+
+void json_writer_string(JsonWriter *json, const char *name, const char *value);
+void json_writer_int(JsonWriter *json, const char *name, int32_t value);
+void json_writer_fixed(JsonWriter *json, const char *name, int32_t value, uint8_t decimals);
+void json_writer_float(JsonWriter *json, const char *name, float value, uint8_t decimals);
+void json_writer_bool(JsonWriter *json, const char *name, uint8_t value);
+void json_writer_null(JsonWriter *json, const char *name);
+
 //PARSING
-void json_get_next_field(const JsonBuffer *json, char *name, char *value);
+typedef enum
+{
+    JSON_TYPE_UNDEFINED = 0,
+    JSON_TYPE_OBJECT,
+    JSON_TYPE_ARRAY,
+    JSON_TYPE_STRING,
+    JSON_TYPE_PRIMITIVE     ///< number, true, false or null
+} JSON_TYPE;
+
+/**
+ * @brief JsonToken one value of a parsed document, given by its offsets in
+ * the document text. Tokens are in document order, children of objects are
+ * the keys and each key has its value as only child
+ */
+typedef struct
+{
+    uint16_t start;     ///< first char, after the quote of strings
+    uint16_t end;       ///< after the last char, before the quote of strings
+    uint16_t size;      ///< members of objects, items of arrays, 1 for keys
+    uint8_t type;       ///< JSON_TYPE
+} JsonToken;
+
+#define JSON_ERROR_NOMEM -1     ///< not enough tokens
+#define JSON_ERROR_INVAL -2     ///< invalid document
+#define JSON_ERROR_PART  -3     ///< incomplete document
+
+int json_parse(const char *json, size_t size, JsonToken *tokens, uint16_t count);
+
+int json_skip(const JsonToken *tokens, int count, int id);
+int json_object_get(const char *json, const JsonToken *tokens, int count, int object, const char *name);
+int json_array_get(const JsonToken *tokens, int count, int array, uint16_t index);
+int json_find(const char *json, const JsonToken *tokens, int count, const char *path);
+
+int json_token_equals(const char *json, const JsonToken *token, const char *str);
+int json_get_int(const char *json, const JsonToken *token, int32_t *value);
+int json_get_fixed(const char *json, const JsonToken *token, uint8_t decimals, int32_t *value);
+int json_get_bool(const char *json, const JsonToken *token, uint8_t *value);
+int json_get_string(const char *json, const JsonToken *token, char *str, size_t size);
 
 #endif // JSON_H
@@ -5,61 +5,756 @@
  *
  * @date June 4, 2017, 11:15 AM
  *
- * @brief JSON parsing protocol
+ * @brief JSON parsing protocol, single pass tokenizer writing into a token
+ * array given by the caller, without allocation
  */
 
 #include "json.h"
 
-//get next field
-// -> go through buffer until met a comma
-void json_get_next_field(const JsonBuffer *json, char *name, char *value)
+#define JSON_TOKEN_OPEN 0xFFFF  // end of a container not closed yet
+
+// next expected token
+typedef enum
+{
+    JSON_EXPECT_VALUE,
+    JSON_EXPECT_VALUE_OR_CLOSE,     // first item of an array
+    JSON_EXPECT_KEY,
+    JSON_EXPECT_KEY_OR_CLOSE,       // first member of an object
+    JSON_EXPECT_COLON,
+    JSON_EXPECT_COMMA_OR_CLOSE,
+    JSON_EXPECT_END                 // after the top level value
+} JSON_EXPECT;
+
+// internal functions
+static int json_parseString(const char *json, size_t size, uint16_t *pos);
+static int json_parsePrimitive(const char *json, size_t size, uint16_t *pos);
+static uint16_t json_digits(const char *str, uint16_t size, uint16_t i);
+static int json_isNumber(const char *str, uint16_t size);
+static int json_container(const JsonToken *tokens, int id);
+static int json_equals(const char *json, const JsonToken *token, const char *str, size_t size);
+static int json_objectGet(const char *json, const JsonToken *tokens, int count, int object, const char *name, size_t size);
+static int json_fixedDigit(uint32_t *value, uint8_t digit, uint32_t limit);
+static int json_hex(char c);
+static uint16_t json_hex4(const char *str);
+static uint8_t json_utf8(uint32_t code, char *utf8);
+
+/**
+ * @brief json_parse splits a JSON document in tokens
+ * @param json document, ends at size or at the first NUL char
+ * @param size document size, up to 65534 bytes
+ * @param tokens array filled with the tokens, in document order
+ * @param count size of tokens
+ * @return number of tokens, JSON_ERROR_NOMEM if tokens is too small,
+ * JSON_ERROR_INVAL if the document is invalid, JSON_ERROR_PART if it ends
+ * before the end of the top level value
+ */
+int json_parse(const char *json, size_t size, JsonToken *tokens, uint16_t count)
+{
+    uint16_t pos, next = 0;
+    int super = -1, key = -1, status;
+    uint8_t expect = JSON_EXPECT_VALUE;
+    JsonToken *token;
+    char c;
+
+    if (size >= JSON_TOKEN_OPEN)
+        return JSON_ERROR_INVAL;   // offsets are 16 bits
+
+    for (pos = 0; pos < size && json[pos] != '\0'; pos++)
+    {
+        c = json[pos];
+        switch (c)
+        {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            break;
+
+        case ':':
+            if (expect != JSON_EXPECT_COLON)
+                return JSON_ERROR_INVAL;
+            expect = JSON_EXPECT_VALUE;
+            break;
+
+        case ',':
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE)
+                return JSON_ERROR_INVAL;
+            expect = (tokens[super].type == JSON_TYPE_OBJECT) ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+            break;
+
+        case '}':
+        case ']':
+            if (super < 0 || tokens[super].type != ((c == '}') ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY))
+                return JSON_ERROR_INVAL;
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE
+             && expect != ((c == '}') ? JSON_EXPECT_KEY_OR_CLOSE : JSON_EXPECT_VALUE_OR_CLOSE))
+                return JSON_ERROR_INVAL;
+            tokens[super].end = pos + 1;
+            super = json_container(tokens, super);
+            expect = (super < 0) ? JSON_EXPECT_END : JSON_EXPECT_COMMA_OR_CLOSE;
+            break;
+
+        default:
+            // key or value
+            if (expect == JSON_EXPECT_KEY || expect == JSON_EXPECT_KEY_OR_CLOSE)
+            {
+                if (c != '"')
+                    return JSON_ERROR_INVAL;
+            }
+            else if (expect != JSON_EXPECT_VALUE && expect != JSON_EXPECT_VALUE_OR_CLOSE)
+                return JSON_ERROR_INVAL;
+            if (next >= count)
+                return JSON_ERROR_NOMEM;
+
+            token = &tokens[next];
+            token->size = 0;
+            token->start = pos;
+            if (c == '{' || c == '[')
+            {
+                token->type = (c == '{') ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY;
+                token->end = JSON_TOKEN_OPEN;
+            }
+            else if (c == '"')
+            {
+                token->type = JSON_TYPE_STRING;
+                token->start = pos + 1;
+                status = json_parseString(json, size, &pos);
+                if (status < 0)
+                    return status;
+                token->end = pos;
+            }
+            else
+            {
+                token->type = JSON_TYPE_PRIMITIVE;
+                status = json_parsePrimitive(json, size, &pos);
+                if (status < 0)
+                    return status;
+                token->end = pos + 1;
+            }
+
+            if (expect == JSON_EXPECT_KEY || expect == JSON_EXPECT_KEY_OR_CLOSE)
+            {
+                tokens[super].size++;
+                key = next;
+                expect = JSON_EXPECT_COLON;
+            }
+            else
+            {
+                if (super >= 0)
+                {
+                    if (tokens[super].type == JSON_TYPE_ARRAY)
+                        tokens[super].size++;
+                    else
+                        tokens[key].size = 1;
+                }
+                if (token->type == JSON_TYPE_OBJECT || token->type == JSON_TYPE_ARRAY)
+                {
+                    super = next;
+                    expect = (c == '{') ? JSON_EXPECT_KEY_OR_CLOSE : JSON_EXPECT_VALUE_OR_CLOSE;
+                }
+                else
+                    expect = (super < 0) ? JSON_EXPECT_END : JSON_EXPECT_COMMA_OR_CLOSE;
+            }
+            next++;
+            break;
+        }
+    }
+
+    if (expect != JSON_EXPECT_END)
+        return JSON_ERROR_PART;
+    return next;
+}
+
+// pos is on the opening quote, set on the closing quote
+static int json_parseString(const char *json, size_t size, uint16_t *pos)
+{
+    uint16_t i;
+    uint8_t k;
+    char c;
+
+    for (i = *pos + 1; i < size && json[i] != '\0'; i++)
+    {
+        c = json[i];
+        if (c == '"')
+        {
+            *pos = i;
+            return 0;
+        }
+        if ((unsigned char)c < 0x20)
+            return JSON_ERROR_INVAL;
+        if (c != '\\')
+            continue;
+
+        i++;
+        if (i >= size || json[i] == '\0')
+            break;
+        switch (json[i])
+        {
+        case '"':
+        case '\\':
+        case '/':
+        case 'b':
+        case 'f':
+        case 'n':
+        case 'r':
+        case 't':
+            break;
+        case 'u':
+            for (k = 0; k < 4; k++)
+            {
+                i++;
+                if (i >= size || json[i] == '\0')
+                    return JSON_ERROR_PART;
+                if (json_hex(json[i]) < 0)
+                    return JSON_ERROR_INVAL;
+            }
+            break;
+        default:
+            return JSON_ERROR_INVAL;
+        }
+    }
+    return JSON_ERROR_PART;
+}
+
+// pos is on the first char, set on the last char
+static int json_parsePrimitive(const char *json, size_t size, uint16_t *pos)
+{
+    uint16_t i, len;
+    const char *str = json + *pos;
+
+    for (i = *pos; i < size; i++)
+    {
+        char c = json[i];
+        if (c == '\0' || c == ' ' || c == '\t' || c == '\r' || c == '\n'
+         || c == ',' || c == ']' || c == '}' || c == ':')
+            break;
+    }
+    len = i - *pos;
+
+    if ((len == 4 && strncmp(str, "true", 4) == 0)
+     || (len == 5 && strncmp(str, "false", 5) == 0)
+     || (len == 4 && strncmp(str, "null", 4) == 0)
+     || json_isNumber(str, len))
+    {
+        *pos = i - 1;
+        return 0;
+    }
+    return JSON_ERROR_INVAL;
+}
+
+static uint16_t json_digits(const char *str, uint16_t size, uint16_t i)
+{
+    while (i < size && str[i] >= '0' && str[i] <= '9')
+        i++;
+    return i;
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static int json_isNumber(const char *str, uint16_t size)
+{
+    uint16_t i = 0, digits;
+
+    if (i < size && str[i] == '-')
+        i++;
+    if (i < size && str[i] == '0')
+        i++;
+    else
+    {
+        digits = json_digits(str, size, i);
+        if (digits == i)
+            return 0;
+        i = digits;
+    }
+    if (i < size && str[i] == '.')
+    {
+        digits = json_digits(str, size, i + 1);
+        if (digits == i + 1)
+            return 0;
+        i = digits;
+    }
+    if (i < size && (str[i] == 'e' || str[i] == 'E'))
+    {
+        i++;
+        if (i < size && (str[i] == '+' || str[i] == '-'))
+            i++;
+        digits = json_digits(str, size, i);
+        if (digits == i)
+            return 0;
+        i = digits;
+    }
+    return (i == size);
+}
+
+// innermost container still open before id, -1 at the top level
+static int json_container(const JsonToken *tokens, int id)
+{
+    for (id--; id >= 0; id--)
+    {
+        if ((tokens[id].type == JSON_TYPE_OBJECT || tokens[id].type == JSON_TYPE_ARRAY)
+         && tokens[id].end == JSON_TOKEN_OPEN)
+            return id;
+    }
+    return -1;
+}
+
+/**
+ * @brief json_skip next token after the value id and its children
+ * @return id of the next token, count at the end of the document
+ */
+int json_skip(const JsonToken *tokens, int count, int id)
+{
+    uint16_t end = tokens[id].end;
+
+    for (id++; id < count && tokens[id].start < end; id++);
+    return id;
+}
+
+static int json_equals(const char *json, const JsonToken *token, const char *str, size_t size)
+{
+    return ((size_t)(token->end - token->start) == size && strncmp(json + token->start, str, size) == 0);
+}
+
+/**
+ * @brief json_token_equals compares the text of a token, escape sequences of
+ * strings are not decoded
+ * @return 1 if equal, 0 otherwise
+ */
+int json_token_equals(const char *json, const JsonToken *token, const char *str)
+{
+    return json_equals(json, token, str, strlen(str));
+}
+
+static int json_objectGet(const char *json, const JsonToken *tokens, int count, int object, const char *name, size_t size)
+{
+    uint16_t i;
+    int id;
+
+    if (object < 0 || object >= count || tokens[object].type != JSON_TYPE_OBJECT)
+        return -1;
+
+    id = object + 1;
+    for (i = 0; i < tokens[object].size && id + 1 < count; i++)
+    {
+        if (json_equals(json, &tokens[id], name, size))
+            return id + 1;
+        id = json_skip(tokens, count, id + 1);
+    }
+    return -1;
+}
+
+/**
+ * @brief json_object_get value of a member of an object
+ * @param object id of the object token
+ * @param name member name
+ * @return id of the value token, -1 if not found
+ */
+int json_object_get(const char *json, const JsonToken *tokens, int count, int object, const char *name)
+{
+    return json_objectGet(json, tokens, count, object, name, strlen(name));
+}
+
+/**
+ * @brief json_array_get item of an array
+ * @param array id of the array token
+ * @return id of the item token, -1 if out of the array
+ */
+int json_array_get(const JsonToken *tokens, int count, int array, uint16_t index)
+{
+    uint16_t i;
+    int id;
+
+    if (array < 0 || array >= count || tokens[array].type != JSON_TYPE_ARRAY || index >= tokens[array].size)
+        return -1;
+
+    id = array + 1;
+    for (i = 0; i < index; i++)
+        id = json_skip(tokens, count, id);
+    return (id < count) ? id : -1;
+}
+
+/**
+ * @brief json_find value at a path from the top level value, as
+ * "motors[1].speed", "" is the top level value
+ * @return id of the value token, -1 if not found
+ */
+int json_find(const char *json, const JsonToken *tokens, int count, const char *path)
+{
+    uint32_t index;
+    size_t size;
+    int id = 0;
+
+    if (count <= 0)
+        return -1;
+
+    while (*path != '\0')
+    {
+        if (*path == '[')
+        {
+            path++;
+            if (*path < '0' || *path > '9')
+                return -1;
+            for (index = 0; *path >= '0' && *path <= '9' && index <= 0xFFFF; path++)
+                index = index * 10 + (*path - '0');
+            if (*path != ']' || index > 0xFFFF)
+                return -1;
+            path++;
+            id = json_array_get(tokens, count, id, index);
+        }
+        else
+        {
+            if (*path == '.')
+                path++;
+            size = strcspn(path, ".[");
+            id = json_objectGet(json, tokens, count, id, path, size);
+            path += size;
+        }
+        if (id < 0)
+            return -1;
+    }
+    return id;
+}
+
+static int json_fixedDigit(uint32_t *value, uint8_t digit, uint32_t limit)
+{
+    if (*value > (limit - digit) / 10)
+        return -1;
+    *value = *value * 10 + digit;
+    return 0;
+}
+
+/**
+ * @brief json_get_fixed reads a number as a fixed point value, 12.345 is read
+ * as 1235 with 2 decimals, rounded half away from zero. Exponents are not
+ * supported
+ * @param decimals number of decimals of the value
+ * @return 0 if success, -1 if the token is not a number or overflows
+ */
+int json_get_fixed(const char *json, const JsonToken *token, uint8_t decimals, int32_t *value)
 {
-	int i = 0;
-	while ( *(json->buffer.data + i) == ',')
-	{
+    const char *str = json + token->start, *end = json + token->end;
+    uint32_t mantissa = 0, limit;
+    uint8_t negative = 0, fraction = 0, round = 0;
+
+    if (token->type != JSON_TYPE_PRIMITIVE)
+        return -1;
+    if (str < end && *str == '-')
+    {
+        negative = 1;
+        str++;
+    }
+    limit = negative ? 0x80000000UL : 0x7FFFFFFFUL;
+    if (str >= end || *str < '0' || *str > '9')
+        return -1;  // true, false or null
 
-		++i;
-	}
+    for (; str < end && *str >= '0' && *str <= '9'; str++)
+    {
+        if (json_fixedDigit(&mantissa, *str - '0', limit) < 0)
+            return -1;
+    }
+    if (str < end && *str == '.')
+    {
+        for (str++; str < end && *str >= '0' && *str <= '9'; str++)
+        {
+            if (fraction < decimals)
+            {
+                if (json_fixedDigit(&mantissa, *str - '0', limit) < 0)
+                    return -1;
+                fraction++;
+            }
+            else if (fraction == decimals)
+            {
+                round = (*str >= '5');
+                fraction++;     // next digits are dropped
+            }
+        }
+    }
+    if (str != end)
+        return -1;
 
+    for (; fraction < decimals; fraction++)
+    {
+        if (json_fixedDigit(&mantissa, 0, limit) < 0)
+            return -1;
+    }
+    if (round)
+    {
+        if (mantissa == limit)
+            return -1;
+        mantissa++;
+    }
+
+    if (negative && mantissa != 0)
+        *value = -(int32_t)(mantissa - 1) - 1;
+    else
+        *value = (int32_t)mantissa;
+    return 0;
 }
 
+/**
+ * @brief json_get_int reads an integer number
+ * @return 0 if success, -1 if the token is not an integer or overflows
+ */
+int json_get_int(const char *json, const JsonToken *token, int32_t *value)
+{
+    uint16_t i;
 
+    for (i = token->start; i < token->end; i++)
+    {
+        if (json[i] == '.' || json[i] == 'e' || json[i] == 'E')
+            return -1;
+    }
+    return json_get_fixed(json, token, 0, value);
+}
 
+/**
+ * @brief json_get_bool reads true or false
+ * @return 0 if success, -1 if the token is not a boolean
+ */
+int json_get_bool(const char *json, const JsonToken *token, uint8_t *value)
+{
+    if (token->type != JSON_TYPE_PRIMITIVE)
+        return -1;
+    if (json_token_equals(json, token, "true"))
+        *value = 1;
+    else if (json_token_equals(json, token, "false"))
+        *value = 0;
+    else
+        return -1;
+    return 0;
+}
 
+static int json_hex(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
 
+static uint16_t json_hex4(const char *str)
+{
+    return (json_hex(str[0]) << 12) | (json_hex(str[1]) << 8) | (json_hex(str[2]) << 4) | json_hex(str[3]);
+}
 
+static uint8_t json_utf8(uint32_t code, char *utf8)
+{
+    if (code < 0x80)
+    {
+        utf8[0] = code;
+        return 1;
+    }
+    if (code < 0x800)
+    {
+        utf8[0] = 0xC0 | (code >> 6);
+        utf8[1] = 0x80 | (code & 0x3F);
+        return 2;
+    }
+    if (code < 0x10000)
+    {
+        utf8[0] = 0xE0 | (code >> 12);
+        utf8[1] = 0x80 | ((code >> 6) & 0x3F);
+        utf8[2] = 0x80 | (code & 0x3F);
+        return 3;
+    }
+    utf8[0] = 0xF0 | (code >> 18);
+    utf8[1] = 0x80 | ((code >> 12) & 0x3F);
+    utf8[2] = 0x80 | ((code >> 6) & 0x3F);
+    utf8[3] = 0x80 | (code & 0x3F);
+    return 4;
+}
 
+/**
+ * @brief json_get_string copies a string with its escape sequences decoded,
+ * \\u escapes are written in UTF-8. The raw text is used without copy from
+ * json + token->start to json + token->end
+ * @param str destination, NUL terminated
+ * @param size size of str
+ * @return length of the string, -1 if the token is not a string or str is
+ * too small
+ */
+int json_get_string(const char *json, const JsonToken *token, char *str, size_t size)
+{
+    char utf8[4];
+    uint32_t code, low;
+    size_t len = 0;
+    uint16_t i;
+    uint8_t n;
+    char c;
 
+    if (token->type != JSON_TYPE_STRING || size == 0)
+        return -1;
 
+    for (i = token->start; i < token->end; i++)
+    {
+        c = json[i];
+        if (c == '\\')
+        {
+            c = json[++i];
+            switch (c)
+            {
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'u':
+                code = json_hex4(json + i + 1);
+                i += 4;
+                // surrogate pair of characters out of the BMP
+                if (code >= 0xD800 && code < 0xDC00 && i + 6 < token->end
+                 && json[i + 1] == '\\' && json[i + 2] == 'u')
+                {
+                    low = json_hex4(json + i + 3);
+                    if (low >= 0xDC00 && low < 0xE000)
+                    {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        i += 6;
+                    }
+                }
+                if (code >= 0xD800 && code < 0xE000)
+                    code = 0xFFFD;  // lone surrogate
+                n = json_utf8(code, utf8);
+                if (len + n >= size)
+                    return -1;
+                memcpy(str + len, utf8, n);
+                len += n;
+                continue;
+            }
+        }
+        if (len + 1 >= size)
+            return -1;
+        str[len++] = c;
+    }
+    str[len] = '\0';
+    return len;
+}
 
-#ifdef TEST_JSON_PARSER
+#ifdef TEST
+// gcc -DTEST -I../../../include json_parser.c
 #include <stdio.h>
-#include <string.h>
-#include "../../sys/buffer.c"
-#include "json_formater.c"
+#include <assert.h>
+#include <time.h>
+
+// representative REST payloads
+static const char *json_test_payloads[] = {
+    "{\"led\":1,\"state\":true}",
+    "{\"motors\":[{\"id\":0,\"speed\":-12.5,\"enabled\":true},{\"id\":1,\"speed\":12.75,\"enabled\":false}],\"mode\":\"manual\"}",
+    "{\n\t\"name\": \"swarm2\",\n\t\"wifi\": {\"ssid\": \"robotips\", \"password\": \"p\\u00e9\\\"ss\", \"channel\": 6},\n"
+    "\t\"pid\": {\"kp\": 1.25, \"ki\": 0.005, \"kd\": 0.3, \"limits\": [-100, 100]},\n"
+    "\t\"leds\": [true, false, true, true, false, false, true, false],\n"
+    "\t\"path\": [[0, 0], [120, 0], [120, 85], [0, 85], [0, 0]],\n"
+    "\t\"comment\": null\n}"
+};
 
 int main(void)
 {
-    JsonBuffer json;
-    char data [500];
-    // sprintf(data, "{\"name1\": \"value1\",\"name2\": \"42\",\"list1\": [\"name10\": \"value10\",\"name11\": \"value11\",\"name12\": \"value12\" ],\"obj1\": {\"name3\": \"42\",\"name4\": \"42\" },\"obj2\": {\"name5\": \"42\",\"name6\": \"42\" },\"list2\": [\"name20\": \"value20\",\"name21\": \"value21\",\"name22\": \"value22\" ] }");
-    sprintf(data, "bonjour");
-    printf("%s\n", data);
+    JsonToken tokens[64];
+    char str[32];
+    int32_t value;
+    uint8_t b;
+    int count, id, i;
+    const char *json;
+
+    // structure
+    json = json_test_payloads[1];
+    count = json_parse(json, strlen(json), tokens, 64);
+    assert(count == 19);
+    assert(tokens[0].type == JSON_TYPE_OBJECT && tokens[0].size == 2 && tokens[0].end == strlen(json));
+    assert(tokens[1].type == JSON_TYPE_STRING && tokens[1].size == 1 && json_token_equals(json, &tokens[1], "motors"));
+    assert(tokens[2].type == JSON_TYPE_ARRAY && tokens[2].size == 2);
+    assert(json_skip(tokens, count, 2) == 17);
+
+    // lookup and typed extraction
+    id = json_find(json, tokens, count, "motors[1].speed");
+    assert(id > 0 && json_get_fixed(json, &tokens[id], 2, &value) == 0 && value == 1275);
+    assert(json_get_fixed(json, &tokens[id], 1, &value) == 0 && value == 128);
+    assert(json_get_int(json, &tokens[id], &value) < 0);
+    id = json_find(json, tokens, count, "motors[0].speed");
+    assert(json_get_fixed(json, &tokens[id], 3, &value) == 0 && value == -12500);
+    assert(json_get_fixed(json, &tokens[id], 0, &value) == 0 && value == -13);
+    id = json_find(json, tokens, count, "motors[1].enabled");
+    assert(json_get_bool(json, &tokens[id], &b) == 0 && b == 0);
+    id = json_find(json, tokens, count, "mode");
+    assert(json_get_string(json, &tokens[id], str, sizeof(str)) == 6 && strcmp(str, "manual") == 0);
+    assert(json_get_string(json, &tokens[id], str, 6) < 0);
+    assert(json_find(json, tokens, count, "motors[2]") < 0);
+    assert(json_find(json, tokens, count, "motors.id") < 0);
+    assert(json_find(json, tokens, count, "mode2") < 0);
+    assert(json_find(json, tokens, count, "") == 0);
+
+    json = json_test_payloads[2];
+    count = json_parse(json, strlen(json), tokens, 64);
+    assert(count > 0);
+    id = json_find(json, tokens, count, "wifi.password");
+    assert(json_get_string(json, &tokens[id], str, sizeof(str)) == 6 && strcmp(str, "p\xc3\xa9\"ss") == 0);
+    id = json_find(json, tokens, count, "path[2][1]");
+    assert(json_get_int(json, &tokens[id], &value) == 0 && value == 85);
+    id = json_find(json, tokens, count, "pid.limits[0]");
+    assert(json_get_int(json, &tokens[id], &value) == 0 && value == -100);
+    id = json_find(json, tokens, count, "comment");
+    assert(id > 0 && tokens[id].type == JSON_TYPE_PRIMITIVE && json_get_int(json, &tokens[id], &value) < 0);
+    assert(json_parse(json, strlen(json), tokens, 10) == JSON_ERROR_NOMEM);
 
-    json_init(&json, data, 500, JSON_MONOBLOC);
-    printf("json.buffer.data_size: %ld", json.buffer.data_size);
-    printf("%s\n", data);
-    printf("%s\n", json.buffer.data);
+    // numbers limits
+    assert(json_parse("2147483647", 10, tokens, 1) == 1 && json_get_int("2147483647", tokens, &value) == 0 && value == 2147483647);
+    assert(json_parse("-2147483648", 11, tokens, 1) == 1 && json_get_int("-2147483648", tokens, &value) == 0 && value == (-2147483647 - 1));
+    assert(json_parse("2147483648", 10, tokens, 1) == 1 && json_get_int("2147483648", tokens, &value) < 0);
+    assert(json_parse("1e3", 3, tokens, 1) == 1 && json_get_fixed("1e3", tokens, 0, &value) < 0);
 
-    char data2 [500];
-    sprintf(data2, "hello");
-    printf("%s\n", data2);
+    // unicode escapes
+    json = "\"\\ud83d\\ude00\\u0041\\ud800\"";
+    assert(json_parse(json, strlen(json), tokens, 1) == 1);
+    assert(json_get_string(json, tokens, str, sizeof(str)) == 8 && memcmp(str, "\xf0\x9f\x98\x80" "A" "\xef\xbf\xbd", 8) == 0);
 
+    // invalid and partial documents
+    assert(json_parse("{\"a\":1,}", 8, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("[1 2]", 5, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("{\"a\" 1}", 7, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("{1:2}", 5, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("[01]", 4, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("[tru]", 5, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("[1]]", 4, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("{]", 2, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("\"\\x\"", 4, tokens, 64) == JSON_ERROR_INVAL);
+    assert(json_parse("{\"a\":[1,2", 9, tokens, 64) == JSON_ERROR_PART);
+    assert(json_parse("\"abc", 4, tokens, 64) == JSON_ERROR_PART);
+    assert(json_parse("  ", 2, tokens, 64) == JSON_ERROR_PART);
+    assert(json_parse("{}", 2, tokens, 64) == 1 && tokens[0].size == 0);
+    assert(json_parse("[[],{}] ", 8, tokens, 64) == 3 && tokens[0].size == 2);
 
+    // benchmark
+    for (i = 0; i < 3; i++)
+    {
+        const long loops = 200000;
+        size_t size = strlen(json_test_payloads[i]);
+        clock_t start;
+        double time;
+        long l;
 
-	// json_get_next_field();
+        start = clock();
+        for (l = 0; l < loops; l++)
+            count = json_parse(json_test_payloads[i], size, tokens, 64);
+        time = (double)(clock() - start) / CLOCKS_PER_SEC;
+        printf("payload %d: %4lu bytes %3d tokens %7.3f us/parse %6.1f MB/s\n",
+               i, (unsigned long)size, count, time * 1e6 / loops, size * loops / time / 1e6);
+    }
+    printf("sizeof(JsonToken) = %lu\n", (unsigned long)sizeof(JsonToken));
 
+    printf("OK\n");
     return 0;
 }
 
-#endif // TEST_JSON_PARSER
+#endif // TEST
@@ -0,0 +1,508 @@
+/**
+ * @file json_writer.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Streamed JSON writer, documents larger than the RAM are written
+ * through a small buffer. Numbers are formatted without printf and without
+ * 32 bits divisions
+ */
+
+#include "json.h"
+
+static const uint32_t json_writer_powers[] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+#define JSON_WRITER_FLOAT_DIGITS 7      // significant digits of a float
+#define JSON_WRITER_FLOAT_EXACT 16777216.0f  // 2^24, floats are exact integers below
+#define JSON_WRITER_FLOAT_MAX 2147483520.0f  // greatest float below 2^31
+
+// internal functions
+static void json_writer_write(JsonWriter *json, const char *data, uint16_t size);
+static void json_writer_quoted(JsonWriter *json, const char *str);
+static void json_writer_begin(JsonWriter *json, const char *name);
+static void json_writer_open(JsonWriter *json, const char *name, const char *open);
+static void json_writer_close(JsonWriter *json, const char *close);
+static void json_writer_number(JsonWriter *json, uint32_t value, uint8_t negative, uint8_t decimals);
+static int32_t json_writer_round(float value);
+
+/**
+ * @brief json_writer_init starts a document
+ * @param data buffer of the writer
+ * @param size size of data
+ * @param flush called with the buffer when it is full and by
+ * json_writer_flush. Without flush, the document has to fit in data, see
+ * json_writer_setBuffer
+ * @param arg argument of flush, as a socket or a device
+ */
+void json_writer_init(JsonWriter *json, char *data, uint16_t size, JSON_WRITER_FLUSH flush, void *arg)
+{
+    json->data = data;
+    json->size = size;
+    json->pos = 0;
+    json->flush = flush;
+    json->arg = arg;
+    json->items = 0;
+    json->level = 0;
+    json->error = 0;
+}
+
+/**
+ * @brief json_writer_setBuffer continues the document in a new buffer. A
+ * web_server_stream producer keeps its JsonWriter between calls, gives it the
+ * buffer to fill, writes values while json_writer_free() is enough for the
+ * next one and returns json_writer_size()
+ */
+void json_writer_setBuffer(JsonWriter *json, char *data, uint16_t size)
+{
+    json->data = data;
+    json->size = size;
+    json->pos = 0;
+}
+
+/**
+ * @brief json_writer_size bytes written in the buffer since the last flush
+ */
+uint16_t json_writer_size(const JsonWriter *json)
+{
+    return json->pos;
+}
+
+/**
+ * @brief json_writer_free bytes left in the buffer before a flush
+ */
+uint16_t json_writer_free(const JsonWriter *json)
+{
+    return json->size - json->pos;
+}
+
+/**
+ * @brief json_writer_flush outputs the buffered data, to call at the end of
+ * the document. Without flush callback, the data stays in the buffer
+ * @return 0 if success, the first error of the document otherwise
+ */
+int json_writer_flush(JsonWriter *json)
+{
+    if (json->error != 0 || json->flush == NULL || json->pos == 0)
+        return json->error;
+    if ((*json->flush)(json->data, json->pos, json->arg) < 0)
+        json->error = JSON_ERROR_FLUSH;
+    json->pos = 0;
+    return json->error;
+}
+
+static void json_writer_write(JsonWriter *json, const char *data, uint16_t size)
+{
+    uint16_t part;
+
+    while (size > 0 && json->error == 0)
+    {
+        if (json->pos == json->size)
+        {
+            if (json->flush == NULL)
+            {
+                json->error = JSON_ERROR_NOMEM;
+                return;
+            }
+            if (json_writer_flush(json) < 0)
+                return;
+        }
+        part = json->size - json->pos;
+        if (part > size)
+            part = size;
+        memcpy(json->data + json->pos, data, part);
+        json->pos += part;
+        data += part;
+        size -= part;
+    }
+}
+
+static void json_writer_quoted(JsonWriter *json, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char *start;
+    char escape[6];
+
+    json_writer_write(json, "\"", 1);
+    while (*str != '\0')
+    {
+        for (start = str; *str != '\0' && *str != '"' && *str != '\\' && (unsigned char)*str >= 0x20; str++);
+        json_writer_write(json, start, str - start);
+        if (*str == '\0')
+            break;
+
+        escape[0] = '\\';
+        switch (*str)
+        {
+        case '"':
+        case '\\':
+            escape[1] = *str;
+            break;
+        case '\n':
+            escape[1] = 'n';
+            break;
+        case '\r':
+            escape[1] = 'r';
+            break;
+        case '\t':
+            escape[1] = 't';
+            break;
+        default:
+            escape[1] = 'u';
+            escape[2] = '0';
+            escape[3] = '0';
+            escape[4] = hex[(*str >> 4) & 0x0F];
+            escape[5] = hex[*str & 0x0F];
+            json_writer_write(json, escape, 6);
+            str++;
+            continue;
+        }
+        json_writer_write(json, escape, 2);
+        str++;
+    }
+    json_writer_write(json, "\"", 1);
+}
+
+// separator and name of a new value, name is NULL in arrays
+static void json_writer_begin(JsonWriter *json, const char *name)
+{
+    uint16_t bit = 1U << json->level;
+
+    if (json->level > 0)
+    {
+        if (json->items & bit)
+            json_writer_write(json, ",", 1);
+        json->items |= bit;
+    }
+    if (name != NULL)
+    {
+        json_writer_quoted(json, name);
+        json_writer_write(json, ":", 1);
+    }
+}
+
+static void json_writer_open(JsonWriter *json, const char *name, const char *open)
+{
+    if (json->level + 1 >= JSON_WRITER_DEPTH)
+    {
+        json->error = JSON_ERROR_INVAL;
+        return;
+    }
+    json_writer_begin(json, name);
+    json_writer_write(json, open, 1);
+    json->level++;
+    json->items &= ~(1U << json->level);
+}
+
+static void json_writer_close(JsonWriter *json, const char *close)
+{
+    if (json->level == 0)
+    {
+        json->error = JSON_ERROR_INVAL;
+        return;
+    }
+    json->level--;
+    json_writer_write(json, close, 1);
+}
+
+void json_writer_open_object(JsonWriter *json, const char *name)
+{
+    json_writer_open(json, name, "{");
+}
+
+void json_writer_close_object(JsonWriter *json)
+{
+    json_writer_close(json, "}");
+}
+
+void json_writer_open_array(JsonWriter *json, const char *name)
+{
+    json_writer_open(json, name, "[");
+}
+
+void json_writer_close_array(JsonWriter *json)
+{
+    json_writer_close(json, "]");
+}
+
+void json_writer_string(JsonWriter *json, const char *name, const char *value)
+{
+    json_writer_begin(json, name);
+    json_writer_quoted(json, value);
+}
+
+// decimal digits by subtraction of powers of ten, cheaper than 32 bits
+// divisions on 16 bits cores
+static void json_writer_number(JsonWriter *json, uint32_t value, uint8_t negative, uint8_t decimals)
+{
+    char digits[12];    // sign, 10 digits and point
+    uint8_t i, len = 0, started = 0;
+    char digit;
+
+    if (negative)
+        digits[len++] = '-';
+    for (i = 0; i < 10; i++)
+    {
+        for (digit = '0'; value >= json_writer_powers[i]; digit++)
+            value -= json_writer_powers[i];
+        if (digit != '0' || started || i + decimals >= 9)
+        {
+            if (decimals > 0 && i + decimals == 10)
+                digits[len++] = '.';
+            digits[len++] = digit;
+            started = 1;
+        }
+    }
+    json_writer_write(json, digits, len);
+}
+
+void json_writer_int(JsonWriter *json, const char *name, int32_t value)
+{
+    json_writer_fixed(json, name, value, 0);
+}
+
+/**
+ * @brief json_writer_fixed writes a fixed point number, 1234 with 2 decimals
+ * is written 12.34
+ * @param decimals number of decimals of value, up to 9
+ */
+void json_writer_fixed(JsonWriter *json, const char *name, int32_t value, uint8_t decimals)
+{
+    uint32_t magnitude = (value < 0) ? 0UL - (uint32_t)value : (uint32_t)value;
+
+    if (decimals > 9)
+        decimals = 9;
+    json_writer_begin(json, name);
+    json_writer_number(json, magnitude, value < 0, decimals);
+}
+
+// value + 0.5f would be rounded again above 2^23
+static int32_t json_writer_round(float value)
+{
+    int32_t integer = (int32_t)value;
+
+    if (value - integer >= 0.5f)
+        integer++;
+    else if (integer - value >= 0.5f)
+        integer--;
+    return integer;
+}
+
+/**
+ * @brief json_writer_float writes a float rounded to decimals, up to 7.
+ * Decimals after the float precision are dropped, values above 2^31 are
+ * written with an exponent. NaN and infinities are written as null
+ */
+void json_writer_float(JsonWriter *json, const char *name, float value, uint8_t decimals)
+{
+    float scaled, magnitude;
+    uint8_t i, exponent = 0;
+    int32_t mantissa;
+
+    if (value != value || value > 3.4028235e38f || value < -3.4028235e38f)
+    {
+        json_writer_null(json, name);
+        return;
+    }
+
+    if (decimals > JSON_WRITER_FLOAT_DIGITS)
+        decimals = JSON_WRITER_FLOAT_DIGITS;
+    for (;;)
+    {
+        scaled = value;
+        for (i = 0; i < decimals; i++)
+            scaled *= 10.0f;
+        if (decimals > 0 && (scaled >= JSON_WRITER_FLOAT_EXACT || scaled <= -JSON_WRITER_FLOAT_EXACT))
+        {
+            decimals--;     // digits after the float precision
+            continue;
+        }
+        if (scaled < JSON_WRITER_FLOAT_MAX && scaled > -JSON_WRITER_FLOAT_MAX)
+        {
+            json_writer_fixed(json, name, json_writer_round(scaled), decimals);
+            return;
+        }
+        break;
+    }
+
+    // d.dddddde+x
+    magnitude = (value < 0) ? -value : value;
+    while (magnitude >= 10.0f)
+    {
+        magnitude /= 10.0f;
+        exponent++;
+    }
+    mantissa = json_writer_round(magnitude * 1000000.0f);
+    if (mantissa >= 10000000L)
+    {
+        mantissa = 1000000L;
+        exponent++;
+    }
+    json_writer_begin(json, name);
+    json_writer_number(json, mantissa, value < 0, JSON_WRITER_FLOAT_DIGITS - 1);
+    json_writer_write(json, "e", 1);
+    json_writer_number(json, exponent, 0, 0);
+}
+
+void json_writer_bool(JsonWriter *json, const char *name, uint8_t value)
+{
+    json_writer_begin(json, name);
+    if (value)
+        json_writer_write(json, "true", 4);
+    else
+        json_writer_write(json, "false", 5);
+}
+
+void json_writer_null(JsonWriter *json, const char *name)
+{
+    json_writer_begin(json, name);
+    json_writer_write(json, "null", 4);
+}
+
+#ifdef TEST
+// gcc -DTEST -I../../../include -c json_writer.c && gcc json_writer.o json_parser.c -I../../../include
+#include <stdio.h>
+#include <assert.h>
+
+static char test_out[1024];
+static uint16_t test_outSize, test_flushes;
+
+static int test_flush(const char *data, uint16_t size, void *arg)
+{
+    assert(arg == test_out);
+    memcpy(test_out + test_outSize, data, size);
+    test_outSize += size;
+    test_flushes++;
+    return 0;
+}
+
+static const char *test_float(float value, uint8_t decimals)
+{
+    JsonWriter json;
+    static char data[32];
+
+    json_writer_init(&json, data, sizeof(data) - 1, NULL, NULL);
+    json_writer_float(&json, NULL, value, decimals);
+    data[json_writer_size(&json)] = '\0';
+    return data;
+}
+
+static const char *test_fixed(int32_t value, uint8_t decimals)
+{
+    JsonWriter json;
+    static char data[32];
+
+    json_writer_init(&json, data, sizeof(data) - 1, NULL, NULL);
+    json_writer_fixed(&json, NULL, value, decimals);
+    data[json_writer_size(&json)] = '\0';
+    return data;
+}
+
+int main(void)
+{
+    JsonWriter json;
+    JsonToken tokens[160];
+    char data[8], str[32];
+    int count, id, i;
+    int32_t value;
+
+    // numbers
+    assert(strcmp(test_fixed(0, 0), "0") == 0);
+    assert(strcmp(test_fixed(-42, 0), "-42") == 0);
+    assert(strcmp(test_fixed(1234, 2), "12.34") == 0);
+    assert(strcmp(test_fixed(-5, 3), "-0.005") == 0);
+    assert(strcmp(test_fixed(2147483647L, 0), "2147483647") == 0);
+    assert(strcmp(test_fixed(-2147483647L - 1, 9), "-2.147483648") == 0);
+    assert(strcmp(test_float(3.14159f, 3), "3.142") == 0);
+    assert(strcmp(test_float(-0.004f, 2), "0.00") == 0);
+    assert(strcmp(test_float(12.5f, 0), "13") == 0);
+    assert(strcmp(test_float(1234.5f, 7), "1234.5000") == 0);
+    assert(strcmp(test_float(123456.789f, 7), "123456.79") == 0);
+    assert(strcmp(test_float(16777216.0f, 0), "16777216") == 0);
+    assert(strcmp(test_float(3.0e10f, 2), "3.000000e10") == 0);
+    assert(strcmp(test_float(-9.9999999e20f, 2), "-1.000000e21") == 0);
+    assert(strcmp(test_float(0.0f / 0.0f, 2), "null") == 0);
+
+    // document through a 8 bytes buffer
+    test_outSize = 0;
+    json_writer_init(&json, data, sizeof(data), test_flush, test_out);
+    json_writer_open_object(&json, NULL);
+    json_writer_string(&json, "name", "swarm \"2\"\n\x01");
+    json_writer_open_array(&json, "samples");
+    for (i = 0; i < 20; i++)
+    {
+        json_writer_open_object(&json, NULL);
+        json_writer_int(&json, "t", i * 10);
+        json_writer_fixed(&json, "bat", 3700 - i, 3);
+        json_writer_bool(&json, "ok", i & 1);
+        json_writer_close_object(&json);
+    }
+    json_writer_close_array(&json);
+    json_writer_open_array(&json, "empty");
+    json_writer_close_array(&json);
+    json_writer_null(&json, "none");
+    json_writer_close_object(&json);
+    assert(json_writer_flush(&json) == 0 && json.level == 0);
+    test_out[test_outSize] = '\0';
+    printf("%s\n%d flushes\n", test_out, test_flushes);
+    assert(test_flushes > 60);
+
+    count = json_parse(test_out, test_outSize, tokens, 160);
+    assert(count == 149);
+    id = json_find(test_out, tokens, count, "samples[19].bat");
+    assert(json_get_fixed(test_out, &tokens[id], 3, &value) == 0 && value == 3681);
+    id = json_find(test_out, tokens, count, "name");
+    assert(json_get_string(test_out, &tokens[id], str, sizeof(str)) == 11 && strcmp(str, "swarm \"2\"\n\x01") == 0);
+    assert(strncmp(test_out, "{\"name\":\"swarm \\\"2\\\"\\n\\u0001\",\"samples\":[{\"t\":0,\"bat\":3.700,\"ok\":false},{", 70) == 0);
+    assert(strcmp(test_out + test_outSize - 26, "}],\"empty\":[],\"none\":null}") == 0);
+    count = json_parse(test_out, 115, tokens, 64);
+    assert(count == JSON_ERROR_PART);
+
+    // nesting errors
+    json_writer_init(&json, data, sizeof(data), test_flush, test_out);
+    json_writer_close_object(&json);
+    assert(json_writer_flush(&json) == JSON_ERROR_INVAL);
+
+    // producer of web_server_stream, values are written while they fit
+    {
+        char stream[2048];
+        char part[40];
+        uint16_t size = 0, n, sample = 0;
+
+        json_writer_init(&json, NULL, 0, NULL, NULL);
+        do
+        {
+            json_writer_setBuffer(&json, part, sizeof(part));
+            if (sample == 0)
+            {
+                json_writer_open_object(&json, NULL);
+                json_writer_open_array(&json, "v");
+                sample++;
+            }
+            while (sample <= 50 && json_writer_free(&json) >= 16)
+                json_writer_fixed(&json, NULL, sample++ * 25, 2);
+            if (sample == 51 && json_writer_free(&json) >= 2)
+            {
+                json_writer_close_array(&json);
+                json_writer_close_object(&json);
+                sample++;
+            }
+            n = json_writer_size(&json);
+            memcpy(stream + size, part, n);
+            size += n;
+        } while (n > 0);
+        assert(json.error == 0);
+        count = json_parse(stream, size, tokens, 64);
+        assert(count == 53);
+        id = json_find(stream, tokens, count, "v[49]");
+        assert(json_get_fixed(stream, &tokens[id], 2, &value) == 0 && value == 1250);
+        assert(json_get_string(stream, &tokens[1], str, sizeof(str)) == 1);
+    }
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif // TEST
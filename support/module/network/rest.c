@@ -0,0 +1,513 @@
+/**
+ * @file rest.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief REST api routes, compiled in a tree of path segments. A lookup
+ * walks the url segments once, whatever the number of routes
+ */
+
+#include "rest.h"
+
+#include <string.h>
+
+#define REST_NONE 0xFF
+
+typedef struct
+{
+    const char *segment;    // in the route path
+    uint8_t size;
+    uint8_t param;          // {param} segment, matches any value
+    uint8_t child;          // first child node
+    uint8_t next;           // next sibling node
+    uint8_t route;          // first route of the node
+} RestNode;
+
+typedef struct
+{
+    HTTP_QUERRY_TYPE method;
+    REST_HANDLER handler;
+    const char *path;       // names of the {param} segments
+    uint8_t next;           // next route of the same node
+} RestNodeRoute;
+
+// {param} values of a lookup, in the url
+typedef struct
+{
+    uint8_t count;
+    const char *value[REST_PARAM_MAX];
+    uint8_t size[REST_PARAM_MAX];
+    uint8_t allowed;        // first node of the url without the method
+} RestMatch;
+
+static RestNode rest_nodes[REST_NODE_COUNT];
+static uint8_t rest_nodeCount = 0;
+static RestNodeRoute rest_routes[REST_ROUTE_COUNT];
+static uint8_t rest_routeCount = 0;
+
+// method names, by HTTP_QUERRY_TYPE
+static const char * const rest_methods[] = {"", "CONNECT", "DELETE", "GET", "HEAD",
+                                            "OPTIONS", "POST", "PUT", "TRACE"};
+
+// internal functions
+static uint8_t rest_match(uint8_t node, const char *url, HTTP_QUERRY_TYPE method, RestMatch *match);
+static uint8_t rest_route(uint8_t node, HTTP_QUERRY_TYPE method);
+static int rest_params(RestParams *params, const RestMatch *match, uint8_t route);
+static void rest_notAllowed(uint8_t node, char *buffer);
+static void rest_allow(char *allow, size_t size, HTTP_QUERRY_TYPE method);
+
+/**
+ * @brief rest_init removes all the routes
+ */
+void rest_init()
+{
+    rest_nodes[0].segment = "";
+    rest_nodes[0].size = 0;
+    rest_nodes[0].param = 0;
+    rest_nodes[0].child = REST_NONE;
+    rest_nodes[0].next = REST_NONE;
+    rest_nodes[0].route = REST_NONE;
+    rest_nodeCount = 1;
+    rest_routeCount = 0;
+}
+
+/**
+ * @brief rest_addRoute adds a route to the tree. Static segments are
+ * preferred to {param} segments, params at the same place in different
+ * routes share a node but are named by each route
+ * @param method method of the route, REST_METHOD_ANY for all
+ * @param path path after /api/, kept by the tree, as "motors/{id}/speed"
+ * @return 0 if success, -1 if the tree is full, the path is invalid or the
+ * route exists
+ */
+int rest_addRoute(HTTP_QUERRY_TYPE method, const char *path, REST_HANDLER handler)
+{
+    RestNode *node;
+    const char *segment;
+    const char *routePath = path;
+    uint8_t id = 0, child, param, route;
+    size_t size;
+
+    if (rest_nodeCount == 0)
+        rest_init();
+    if (rest_routeCount >= REST_ROUTE_COUNT || handler == NULL)
+        return -1;
+
+    for (;;)
+    {
+        while (*path == '/')
+            path++;
+        if (*path == '\0')
+            break;
+        size = strcspn(path, "/");
+        segment = path;
+        path += size;
+
+        param = 0;
+        if (segment[0] == '{')
+        {
+            if (size < 3 || segment[size - 1] != '}')
+                return -1;
+            segment++;
+            size -= 2;
+            param = 1;
+        }
+        if (size > 0xFF)
+            return -1;
+
+        for (child = rest_nodes[id].child; child != REST_NONE; child = rest_nodes[child].next)
+        {
+            node = &rest_nodes[child];
+            if (node->param && param)
+                break;
+            if (!node->param && !param && node->size == size && strncmp(node->segment, segment, size) == 0)
+                break;
+        }
+        if (child == REST_NONE)
+        {
+            if (rest_nodeCount >= REST_NODE_COUNT)
+                return -1;
+            child = rest_nodeCount++;
+            node = &rest_nodes[child];
+            node->segment = segment;
+            node->size = size;
+            node->param = param;
+            node->child = REST_NONE;
+            node->route = REST_NONE;
+            node->next = rest_nodes[id].child;
+            rest_nodes[id].child = child;
+        }
+        id = child;
+    }
+
+    for (route = rest_nodes[id].route; route != REST_NONE; route = rest_routes[route].next)
+    {
+        if (rest_routes[route].method == method)
+            return -1;
+    }
+    route = rest_routeCount++;
+    rest_routes[route].method = method;
+    rest_routes[route].handler = handler;
+    rest_routes[route].path = routePath;
+    rest_routes[route].next = rest_nodes[id].route;
+    rest_nodes[id].route = route;
+    return 0;
+}
+
+/**
+ * @brief rest_addRoutes adds a table of routes
+ * @return 0 if success, -1 if a route is not added
+ */
+int rest_addRoutes(const RestRoute *routes, uint8_t count)
+{
+    int status = 0;
+    uint8_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        if (rest_addRoute(routes[i].method, routes[i].path, routes[i].handler) < 0)
+            status = -1;
+    }
+    return status;
+}
+
+// node of a route of the method matching url, static segments first, then
+// {param}. The first node matching url without the method is kept for 405
+static uint8_t rest_match(uint8_t node, const char *url, HTTP_QUERRY_TYPE method, RestMatch *match)
+{
+    uint8_t child, found, pass;
+    size_t size;
+
+    while (*url == '/')
+        url++;
+    if (*url == '\0')
+    {
+        if (rest_nodes[node].route == REST_NONE)
+            return REST_NONE;
+        if (rest_route(node, method) != REST_NONE)
+            return node;
+        if (match->allowed == REST_NONE)
+            match->allowed = node;
+        return REST_NONE;
+    }
+    size = strcspn(url, "/");
+
+    for (pass = 0; pass < 2; pass++)
+    {
+        for (child = rest_nodes[node].child; child != REST_NONE; child = rest_nodes[child].next)
+        {
+            const RestNode *next = &rest_nodes[child];
+
+            if (pass == 0 && (next->param || next->size != size || strncmp(next->segment, url, size) != 0))
+                continue;
+            if (pass == 1)
+            {
+                if (!next->param || match->count >= REST_PARAM_MAX || size > 0xFF)
+                    continue;
+                match->value[match->count] = url;
+                match->size[match->count] = size;
+                match->count++;
+            }
+
+            found = rest_match(child, url + size, method, match);
+            if (found != REST_NONE)
+                return found;
+            if (pass == 1)
+                match->count--;
+        }
+    }
+    return REST_NONE;
+}
+
+// route of a method, the route of all methods otherwise, HEAD falls back to
+// GET
+static uint8_t rest_route(uint8_t node, HTTP_QUERRY_TYPE method)
+{
+    uint8_t route, any = REST_NONE;
+
+    for (route = rest_nodes[node].route; route != REST_NONE; route = rest_routes[route].next)
+    {
+        if (rest_routes[route].method == method)
+            return route;
+        if (rest_routes[route].method == REST_METHOD_ANY)
+            any = route;
+    }
+    if (any == REST_NONE && method == HTTP_QUERRY_TYPE_HEAD)
+        return rest_route(node, HTTP_QUERRY_TYPE_GET);
+    return any;
+}
+
+// values of match named by the {param} segments of the route path
+static int rest_params(RestParams *params, const RestMatch *match, uint8_t route)
+{
+    const char *path = rest_routes[route].path;
+    uint8_t i, pos = 0;
+    size_t size;
+
+    params->count = match->count;
+    for (i = 0; i < match->count; i++)
+    {
+        if (pos + match->size[i] + 1 > REST_PARAM_DATA_SIZE)
+            return -1;
+        memcpy(params->data + pos, match->value[i], match->size[i]);
+        params->data[pos + match->size[i]] = '\0';
+        params->param[i].value = params->data + pos;
+        pos += match->size[i] + 1;
+
+        // next {param} segment, the path is checked by rest_addRoute
+        for (;;)
+        {
+            while (*path == '/')
+                path++;
+            size = strcspn(path, "/");
+            if (path[0] == '{')
+                break;
+            path += size;
+        }
+        params->param[i].name = path + 1;
+        params->param[i].nameSize = size - 2;
+        path += size;
+    }
+    return 0;
+}
+
+// 405 answer, Allow lists the methods of the node, HEAD is served by its GET
+// route if it has no HEAD route
+static void rest_notAllowed(uint8_t node, char *buffer)
+{
+    char allow[48] = "";
+    uint8_t route, get = 0, head = 0;
+    HTTP_QUERRY_TYPE method;
+
+    for (route = rest_nodes[node].route; route != REST_NONE; route = rest_routes[route].next)
+    {
+        method = rest_routes[route].method;
+        if (method == HTTP_QUERRY_TYPE_GET)
+            get = 1;
+        if (method == HTTP_QUERRY_TYPE_HEAD)
+            head = 1;
+        rest_allow(allow, sizeof(allow), method);
+    }
+    if (get && !head)
+        rest_allow(allow, sizeof(allow), HTTP_QUERRY_TYPE_HEAD);
+    http_write_header_code(buffer, HTTP_METHOD_NOT_ALLOWED);
+    http_write_header_field(buffer, "Allow", allow);
+    http_write_header_end(buffer);
+}
+
+// appends a method to an Allow list
+static void rest_allow(char *allow, size_t size, HTTP_QUERRY_TYPE method)
+{
+    if (method >= sizeof(rest_methods) / sizeof(rest_methods[0])
+     || strlen(allow) + strlen(rest_methods[method]) + 2 >= size)
+        return;
+    if (allow[0] != '\0')
+        strcat(allow, ", ");
+    strcat(allow, rest_methods[method]);
+}
+
+/**
+ * @brief rest_exec runs the handler of the route of url, answers 404 if no
+ * route matches and 405 if no route of url has a handler for the method. To
+ * give to web_server_setRestApi
+ */
+void rest_exec(char *url, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    RestMatch match;
+    RestParams params;
+    uint8_t node = REST_NONE, route = REST_NONE;
+
+    match.count = 0;
+    match.allowed = REST_NONE;
+    if (rest_nodeCount > 0)
+        node = rest_match(0, url, method, &match);
+    if (node == REST_NONE && match.allowed != REST_NONE)
+    {
+        rest_notAllowed(match.allowed, buffer);
+        return;
+    }
+
+    if (node != REST_NONE)
+        route = rest_route(node, method);
+    if (node == REST_NONE || rest_params(&params, &match, route) < 0)
+    {
+        http_write_header_code(buffer, HTTP_NOT_FOUND);
+        http_write_header_end(buffer);
+        return;
+    }
+    (*rest_routes[route].handler)(&params, method, buffer);
+}
+
+/**
+ * @brief rest_param value of a {param} segment
+ * @return NUL terminated value, NULL if the route has no such param
+ */
+const char *rest_param(const RestParams *params, const char *name)
+{
+    size_t size = strlen(name);
+    uint8_t i;
+
+    for (i = 0; i < params->count; i++)
+    {
+        if (params->param[i].nameSize == size && strncmp(params->param[i].name, name, size) == 0)
+            return params->param[i].value;
+    }
+    return NULL;
+}
+
+/**
+ * @brief rest_param_int value of a {param} segment as an integer
+ * @return 0 if success, -1 if the param is missing, not an integer or
+ * overflows
+ */
+int rest_param_int(const RestParams *params, const char *name, int32_t *value)
+{
+    const char *str = rest_param(params, name);
+    uint32_t number = 0, limit = 0x7FFFFFFFUL;
+    uint8_t negative = 0, digit;
+
+    if (str == NULL)
+        return -1;
+    if (*str == '-')
+    {
+        negative = 1;
+        limit = 0x80000000UL;
+        str++;
+    }
+    if (*str == '\0')
+        return -1;
+    for (; *str != '\0'; str++)
+    {
+        if (*str < '0' || *str > '9')
+            return -1;
+        digit = *str - '0';
+        if (number > (limit - digit) / 10)
+            return -1;
+        number = number * 10 + digit;
+    }
+
+    if (negative && number != 0)
+        *value = -(int32_t)(number - 1) - 1;
+    else
+        *value = (int32_t)number;
+    return 0;
+}
+
+#ifdef TEST
+// gcc -DTEST -I../../../include -c rest.c && gcc rest.o http_formater.c ../../sys/buffer.c -I../../../include
+#include <stdio.h>
+#include <assert.h>
+
+static const char *test_handler;
+static RestParams test_params;
+
+#define TEST_HANDLER(name) \
+static void name(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer) \
+{ \
+    (void)method; \
+    test_handler = #name; \
+    test_params = *params; \
+    http_write_header_code(buffer, HTTP_OK); \
+    http_write_header_end(buffer); \
+}
+TEST_HANDLER(status)
+TEST_HANDLER(motor)
+TEST_HANDLER(motorSpeed)
+TEST_HANDLER(motorSpeedSet)
+TEST_HANDLER(motorsStop)
+TEST_HANDLER(motorStop)
+TEST_HANDLER(led)
+TEST_HANDLER(file)
+
+static const RestRoute test_routes[] = {
+    {HTTP_QUERRY_TYPE_GET, "status", status},
+    {HTTP_QUERRY_TYPE_GET, "motors/{id}", motor},
+    {HTTP_QUERRY_TYPE_GET, "motors/{id}/speed", motorSpeed},
+    {HTTP_QUERRY_TYPE_PUT, "/motors/{motor}/speed/", motorSpeedSet},
+    {HTTP_QUERRY_TYPE_POST, "motors/all/stop", motorsStop},
+    {HTTP_QUERRY_TYPE_GET, "motors/{motor}/stop", motorStop},
+    {REST_METHOD_ANY, "leds/{id}/{state}", led},
+    {HTTP_QUERRY_TYPE_GET, "files/{dir}/{name}", file}
+};
+
+static const char *test_exec(const char *url, HTTP_QUERRY_TYPE method)
+{
+    static char buffer[256];
+    char path[128];
+
+    strcpy(path, url);
+    buffer[0] = '\0';
+    test_handler = NULL;
+    rest_exec(path, method, buffer);
+    return buffer;
+}
+
+int main(void)
+{
+    int32_t value;
+
+    rest_init();
+    assert(rest_addRoutes(test_routes, sizeof(test_routes) / sizeof(test_routes[0])) == 0);
+    assert(rest_addRoute(HTTP_QUERRY_TYPE_GET, "status", status) < 0);
+    assert(rest_addRoute(HTTP_QUERRY_TYPE_GET, "bad/{x", status) < 0);
+
+    assert(strstr(test_exec("status", HTTP_QUERRY_TYPE_GET), "200 OK") && strcmp(test_handler, "status") == 0);
+    assert(strstr(test_exec("status", HTTP_QUERRY_TYPE_HEAD), "200 OK") && strcmp(test_handler, "status") == 0);
+    assert(strstr(test_exec("status/", HTTP_QUERRY_TYPE_GET), "200 OK"));
+    assert(strstr(test_exec("statu", HTTP_QUERRY_TYPE_GET), "404 Not Found") && test_handler == NULL);
+    assert(strstr(test_exec("", HTTP_QUERRY_TYPE_GET), "404 Not Found"));
+
+    test_exec("motors/12", HTTP_QUERRY_TYPE_GET);
+    assert(strcmp(test_handler, "motor") == 0 && test_params.count == 1);
+    assert(rest_param_int(&test_params, "id", &value) == 0 && value == 12);
+    test_exec("motors/-3/speed", HTTP_QUERRY_TYPE_GET);
+    assert(strcmp(test_handler, "motorSpeed") == 0 && rest_param_int(&test_params, "id", &value) == 0 && value == -3);
+    test_exec("motors/3/speed", HTTP_QUERRY_TYPE_PUT);
+    assert(strcmp(test_handler, "motorSpeedSet") == 0 && strcmp(rest_param(&test_params, "motor"), "3") == 0);
+    assert(rest_param(&test_params, "id") == NULL);
+
+    // static segment first, then back to the {id} param
+    test_exec("motors/all/stop", HTTP_QUERRY_TYPE_POST);
+    assert(strcmp(test_handler, "motorsStop") == 0 && test_params.count == 0);
+    test_exec("motors/all/speed", HTTP_QUERRY_TYPE_GET);
+    assert(strcmp(test_handler, "motorSpeed") == 0 && strcmp(rest_param(&test_params, "id"), "all") == 0);
+    assert(rest_param_int(&test_params, "id", &value) < 0);
+
+    // static segment without the method, back to the {motor} param
+    test_exec("motors/all/stop", HTTP_QUERRY_TYPE_GET);
+    assert(strcmp(test_handler, "motorStop") == 0 && strcmp(rest_param(&test_params, "motor"), "all") == 0);
+
+    // method not allowed, methods of the first matching path
+    assert(strstr(test_exec("motors/all/stop", HTTP_QUERRY_TYPE_DELETE), "405 Method Not Allowed\r\nAllow: POST\r\n"));
+    assert(strstr(test_exec("motors/1/speed", HTTP_QUERRY_TYPE_DELETE), "Allow: PUT, GET, HEAD\r\n") && test_handler == NULL);
+    assert(strstr(test_exec("status", HTTP_QUERRY_TYPE_POST), "405 Method Not Allowed\r\nAllow: GET, HEAD\r\n"));
+
+    test_exec("leds/2/on", HTTP_QUERRY_TYPE_DELETE);
+    assert(strcmp(test_handler, "led") == 0 && test_params.count == 2);
+    assert(strcmp(rest_param(&test_params, "id"), "2") == 0 && strcmp(rest_param(&test_params, "state"), "on") == 0);
+    assert(strstr(test_exec("leds/2", HTTP_QUERRY_TYPE_GET), "404"));
+
+    // params larger than REST_PARAM_DATA_SIZE
+    assert(strstr(test_exec("files/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa/bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb", HTTP_QUERRY_TYPE_GET), "404"));
+    test_exec("files/aaaaaaaaaaaaaaaaaaaaaaaaaaaaaa/bbbbbbbbbbbbbbbbbbbbbbbbbbbbbb", HTTP_QUERRY_TYPE_GET);
+    assert(strcmp(test_handler, "file") == 0);
+
+    // tree full, nodes keep the paths
+    {
+        static char names[REST_NODE_COUNT][4];
+
+        rest_init();
+        for (value = 0; value < REST_NODE_COUNT; value++)
+        {
+            sprintf(names[value], "n%d", (int)value);
+            if (rest_addRoute(HTTP_QUERRY_TYPE_GET, names[value], status) < 0)
+                break;
+        }
+        assert(value == REST_NODE_COUNT - 1);
+    }
+
+    printf("OK\n");
+    return 0;
+}
+
+#endif // TEST
@@ -0,0 +1,70 @@
+/**
+ * @file rest.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief REST api routes, compiled in a tree of path segments
+ */
+
+#ifndef REST_H
+#define REST_H
+
+#include <stdint.h>
+
+#include "http.h"
+
+// sizes of the route tree, nodes are path segments shared by routes
+#ifndef REST_NODE_COUNT
+ #define REST_NODE_COUNT 32
+#endif
+#ifndef REST_ROUTE_COUNT
+ #define REST_ROUTE_COUNT 32
+#endif
+
+// {param} segments of a path, values are copied in REST_PARAM_DATA_SIZE bytes
+#ifndef REST_PARAM_MAX
+ #define REST_PARAM_MAX 4
+#endif
+#ifndef REST_PARAM_DATA_SIZE
+ #define REST_PARAM_DATA_SIZE 64
+#endif
+
+#define REST_METHOD_ANY HTTP_QUERRY_TYPE_ERROR  ///< route of every method
+
+typedef struct
+{
+    const char *name;       ///< in the route path, not NUL terminated
+    uint8_t nameSize;
+    const char *value;      ///< NUL terminated
+} RestParam;
+
+typedef struct
+{
+    uint8_t count;
+    RestParam param[REST_PARAM_MAX];
+    char data[REST_PARAM_DATA_SIZE];
+} RestParams;
+
+/**
+ * @brief REST_HANDLER handler of a route, writes the response header and body
+ * in buffer as the web_server_setRestApi callback
+ */
+typedef void (*REST_HANDLER)(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer);
+
+typedef struct
+{
+    HTTP_QUERRY_TYPE method;
+    const char *path;       ///< after /api/, as "motors/{id}/speed"
+    REST_HANDLER handler;
+} RestRoute;
+
+void rest_init();
+int rest_addRoute(HTTP_QUERRY_TYPE method, const char *path, REST_HANDLER handler);
+int rest_addRoutes(const RestRoute *routes, uint8_t count);
+
+void rest_exec(char *url, HTTP_QUERRY_TYPE method, char *buffer);
+
+const char *rest_param(const RestParams *params, const char *name);
+int rest_param_int(const RestParams *params, const char *name, int32_t *value);
+
+#endif // REST_H
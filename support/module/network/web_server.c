@@ -17,89 +17,1096 @@
 #include <string.h>
 
 #include "board.h"
+#include "modules.h"
+
+#ifdef USE_MODULE_assets
+ #include "module/assets.h"
+#endif
+
+// Cache-Control of files with an ETag, browsers revalidate them with
+// If-None-Match and get a 304 without the body while they are unchanged
+#ifndef WEB_SERVER_CACHE_CONTROL
+ #define WEB_SERVER_CACHE_CONTROL "no-cache"
+#endif
+
+// request storage of each link, limit of the request line, headers and body
+#ifndef WEB_SERVER_REQUEST_SIZE
+ #define WEB_SERVER_REQUEST_SIZE 1024
+#endif
+
+// persistent connections, idle links are closed after WEB_SERVER_IDLE_TIMEOUT
+// ms, counted by web_server_tick
+#ifndef WEB_SERVER_IDLE_TIMEOUT
+ #define WEB_SERVER_IDLE_TIMEOUT 5000
+#endif
+#ifndef WEB_SERVER_KEEPALIVE_MAX
+ #define WEB_SERVER_KEEPALIVE_MAX 100   // requests per connection
+#endif
+
+// response header of a link, kept until it is sent, file bodies are sent
+// from the file data without copy
+#ifndef WEB_SERVER_HEADER_SIZE
+ #define WEB_SERVER_HEADER_SIZE 320
+#endif
+
+// WebSocket links are pinged after WEB_SERVER_WEBSOCKET_PING ms without
+// received data and closed after twice this time
+#ifndef WEB_SERVER_WEBSOCKET_PING
+ #define WEB_SERVER_WEBSOCKET_PING 10000
+#endif
+// published frame, head and payload, sent to all subscribers without copy
+#ifndef WEB_SERVER_WEBSOCKET_FRAME_SIZE
+ #define WEB_SERVER_WEBSOCKET_FRAME_SIZE 512
+#endif
+
+#ifdef USE_MODULE_assets
+ // mime type of files served from the asset pack, metadata of ASSETS_TYPE_FILE
+ #ifndef WEB_SERVER_ASSET_TYPE_SIZE
+  #define WEB_SERVER_ASSET_TYPE_SIZE 64
+ #endif
+#endif
 
 char web_server_buffer[2048];
+uint8_t web_server_bufferPending = 0;   // queued writes of web_server_buffer
 void (*web_server_restApi)(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer) = NULL;
 
 const Fs_FilesList *web_server_file_list = NULL;
 
+typedef struct
+{
+    uint8_t open;
+    uint8_t closing;        // closed by the server, until CIPCLOSE is done
+    uint8_t closePending;   // CIPCLOSE to queue once the write queue has room
+    uint8_t requests;       // requests answered on this connection
+    uint16_t lastActivity;  // web_server_time of the last received data
+    uint8_t pending;        // queued writes of header
+    Buffer header;
+    char headerData[WEB_SERVER_HEADER_SIZE];
+    WEB_SERVER_STREAM stream;   // producer of a chunked rest response
+    void *streamArg;
+    uint8_t streamChunked;      // 0 for HTTP/1.0 clients, the end of connection ends the body
+    uint8_t keepAlive;          // of the streamed response
+#ifdef USE_MODULE_assets
+    Asset asset;                // streamed file of the asset pack
+#endif
+    uint8_t webSocket;          // upgraded, requestBuffer stores the received messages
+    uint8_t webSocketPing;      // ping sent since the last received data
+    WEBSOCKET_DECODER ws;
+    HTTP_REQUEST request;
+    char requestBuffer[WEB_SERVER_REQUEST_SIZE];
+} WebServerLink;
+WebServerLink web_server_links[ESP8266_LINK_COUNT];
+uint8_t web_server_nextLink = 0;
+const HTTP_REQUEST *web_server_request = NULL;
+uint8_t web_server_requestSock = 0;
+WEB_SERVER_STREAM web_server_streamNew = NULL;  // set by web_server_stream from the rest api
+void *web_server_streamArg = NULL;
+volatile uint16_t web_server_time = 0;
+
+const char *web_server_wsPath = NULL;
+WEB_SERVER_WEBSOCKET web_server_wsReceive = NULL;
+char web_server_wsFrame[WEB_SERVER_WEBSOCKET_FRAME_SIZE];
+uint8_t web_server_wsPending = 0;       // queued writes of web_server_wsFrame
+WEB_SERVER_STREAM web_server_wsPublisher = NULL;
+void *web_server_wsPublisherArg = NULL;
+uint8_t web_server_wsPublisherOpcode = WEBSOCKET_OPCODE_TEXT;
+uint16_t web_server_wsPublisherPeriod = 0; // in ticks
+uint16_t web_server_wsPublished = 0;       // web_server_time of the last publisher call
+
+// write queue entries used by a response : header, body and close
+#define WEB_SERVER_RESPONSE_WRITES 3
+
+// internal functions
+static void web_server_serve(uint8_t sock);
+static uint8_t web_server_ready(uint8_t sock, uint8_t useBuffer);
+static void web_server_sendChunk(uint8_t sock);
+static void web_server_end(uint8_t sock, uint8_t keepAlive);
+static uint8_t web_server_isRest(const HTTP_REQUEST *request);
+static uint8_t web_server_keepAlive(uint8_t sock, const HTTP_REQUEST *request);
+static void web_server_writeConnection(Buffer *header, const HTTP_REQUEST *request, uint8_t keepAlive);
+static void web_server_sent(uint8_t sock, int status, void *arg);
+static void web_server_write(uint8_t sock, const char *data, uint32_t size, uint8_t *pending);
+static Buffer *web_server_header(uint8_t sock);
+static uint8_t web_server_respond(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive);
+static void web_server_sendFile(uint8_t sock, const HTTP_REQUEST *request, const Fs_File *file, uint8_t keepAlive);
+static int web_server_range(const HTTP_REQUEST *request, uint32_t length, const char *etag, uint32_t *first, uint32_t *last);
+static uint32_t web_server_writeRange(Buffer *header, int status, uint32_t first, uint32_t last, uint32_t length);
+#ifdef USE_MODULE_assets
+static int web_server_sendAsset(uint8_t sock, const HTTP_REQUEST *request, const char *name, uint8_t keepAlive);
+static uint16_t web_server_streamAsset(char *buffer, uint16_t size, void *arg);
+#endif
+static uint8_t web_server_sendRest(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive);
+static uint8_t web_server_sendStream(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive, char *end);
+static void web_server_sendError(uint8_t sock, int code);
+static void web_server_close(uint8_t sock);
+static void web_server_queueClose(uint8_t sock);
+static void web_server_closed(uint8_t sock, int status, void *arg);
+static void web_server_checkLinks();
+static uint8_t web_server_isWebSocket(const HTTP_REQUEST *request);
+static uint8_t web_server_acceptWebSocket(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive);
+static void web_server_serveWebSocket(uint8_t sock);
+static void web_server_sendControl(uint8_t sock, uint8_t opcode, const char *data, uint8_t size);
+static void web_server_closeWebSocket(uint8_t sock, uint16_t status);
+static uint16_t web_server_frame(uint8_t opcode, const char *data, uint16_t size);
+static void web_server_runPublisher();
+
 void web_server_init()
 {
+    uint8_t sock;
+
     // services init
+    memset(web_server_links, 0, sizeof(web_server_links));
+    for (sock = 0; sock < ESP8266_LINK_COUNT; sock++)
+    {
+        WebServerLink *link = &web_server_links[sock];
+        http_request_init(&link->request, link->requestBuffer, WEB_SERVER_REQUEST_SIZE);
+    }
+    web_server_nextLink = 0;
+    web_server_request = NULL;
+}
+
+/**
+ * @brief web_server_tick time base of idle timeouts, to call every
+ * WEB_SERVER_TICK_MS ms, from a timer handler for example. Without it
+ * connections are only closed by clients
+ */
+void web_server_tick()
+{
+    web_server_time++;
 }
 
+/**
+ * @brief web_server_task serves the links in turn, each link has its own
+ * request parser fed with its received data and gets at most one response
+ * per call. Pipelined requests of a persistent connection are answered in
+ * order, once the previous response header is sent
+ */
 void web_server_task()
 {
-    if (esp8266_getRec() != 1)
+    uint8_t i;
+
+    if (web_server_links[0].request.buffer == NULL)
+        web_server_init();
+
+    web_server_checkLinks();
+    web_server_runPublisher();
+    for (i = 0; i < ESP8266_LINK_COUNT; i++)
+        web_server_serve((web_server_nextLink + i) % ESP8266_LINK_COUNT);
+
+    // the next call starts with the next link to share the write queue
+    web_server_nextLink = (web_server_nextLink + 1) % ESP8266_LINK_COUNT;
+}
+
+/**
+ * @brief web_server_serve feeds the received data of a link to its parser
+ * until a request is complete and answers it if the response buffers are
+ * free, else the request is answered by a next call
+ */
+static void web_server_serve(uint8_t sock)
+{
+    WebServerLink *link = &web_server_links[sock];
+    HTTP_REQUEST *request = &link->request;
+    uint8_t keepAlive;
+    uint16_t size;
+    int used;
+
+    if (!link->open)
+        return;
+    if (esp8266_getRecOverflow(sock))
+    {
+        web_server_close(sock);     // the request stream lost data
+        return;
+    }
+    if (link->webSocket)
+    {
+        web_server_serveWebSocket(sock);
+        return;
+    }
+    if (link->stream != NULL)
+    {
+        web_server_sendChunk(sock);  // next requests wait for the end of the body
+        return;
+    }
+
+    while (request->state != HTTP_REQUEST_COMPLETE && request->state != HTTP_REQUEST_ERROR)
+    {
+        size = esp8266_getRecSize(sock);
+        if (size == 0)
+            return;     // wait for the end of the request
+        link->lastActivity = web_server_time;
+        used = http_request_feed(request, esp8266_getRecData(sock), size);
+        if (used < 0)
+            break;
+        esp8266_releaseRec(sock, used);
+    }
+
+    if (!web_server_ready(sock, request->state == HTTP_REQUEST_COMPLETE && web_server_isRest(request)))
+        return;
+    if (request->state == HTTP_REQUEST_ERROR)
+    {
+        web_server_sendError(sock, request->error);
+        web_server_close(sock);
+        return;
+    }
+
+    web_server_request = request;
+    web_server_requestSock = sock;
+    keepAlive = web_server_keepAlive(sock, request);
+    keepAlive = web_server_respond(sock, request, keepAlive);
+    web_server_request = NULL;
+    http_request_reset(request);
+    if (!link->open)
+        return;     // closed by a write that did not fit
+    if (link->stream != NULL)
+    {
+        link->keepAlive = keepAlive;    // body sent by the next calls
+        return;
+    }
+    web_server_end(sock, keepAlive);
+}
+
+// end of a response, the connection waits for the next request or is closed
+static void web_server_end(uint8_t sock, uint8_t keepAlive)
+{
+    if (!keepAlive)
+    {
+        web_server_close(sock);
         return;
+    }
+    web_server_links[sock].requests++;
+}
 
-    unsigned char sock = esp8266_getRecSocket();
-    char *querry = esp8266_getRecData();
-    HTTP_PARSER parser;
-    char url[50];
+/**
+ * @brief web_server_ready checks that a response can be queued without
+ * waiting : header of the link sent, rest buffer free if it is used and
+ * room in the write queue
+ */
+static uint8_t web_server_ready(uint8_t sock, uint8_t useBuffer)
+{
+    if (web_server_links[sock].pending > 0)
+        return 0;
+    if (useBuffer && web_server_bufferPending > 0)
+        return 0;
+    return (esp8266_write_free() >= WEB_SERVER_RESPONSE_WRITES);
+}
+
+/**
+ * @brief web_server_sendChunk asks the next part of a streamed body to its
+ * producer, once the previous part is sent, and queues it as a chunk
+ */
+static void web_server_sendChunk(uint8_t sock)
+{
+    WebServerLink *link = &web_server_links[sock];
+    uint16_t size, head = 0, tail = 0;
+
+    if (!web_server_ready(sock, 1))
+        return;
+
+    if (link->streamChunked)
+    {
+        head = HTTP_CHUNK_HEAD;
+        tail = HTTP_CHUNK_TAIL;
+    }
+    size = (*link->stream)(web_server_buffer + head, sizeof(web_server_buffer) - head - tail, link->streamArg);
+    if (size > sizeof(web_server_buffer) - head - tail)
+        size = 0;
+    if (link->streamChunked)
+        web_server_write(sock, web_server_buffer, http_write_chunk(web_server_buffer, size), &web_server_bufferPending);
+    else
+        web_server_write(sock, web_server_buffer, size, &web_server_bufferPending);
+
+    if (size == 0)
+    {
+        link->stream = NULL;
+        web_server_end(sock, link->keepAlive);
+    }
+}
 
-    querry[esp8266_getRecSize()] = 0;
+static uint8_t web_server_isRest(const HTTP_REQUEST *request)
+{
+    return (web_server_restApi != NULL && strncmp(request->path.ptr, "/api/", 5) == 0);
+}
+
+/**
+ * @brief web_server_currentRequest request being answered, gives the rest api
+ * access to the query string, headers and body
+ */
+const HTTP_REQUEST *web_server_currentRequest()
+{
+    return web_server_request;
+}
 
-    http_parse_init(&parser, querry);
-    HTTP_QUERRY_TYPE type = http_parse_querry(&parser, url);
+/**
+ * @brief web_server_currentSocket link of the request being answered, a link
+ * has at most one streamed response, its state can be indexed by socket
+ * @return socket, -1 if no request is answered
+ */
+int8_t web_server_currentSocket()
+{
+    if (web_server_request == NULL)
+        return -1;
+    return web_server_requestSock;
+}
 
-    if (type != HTTP_QUERRY_TYPE_ERROR)
+// tracks new links, forgets links closed by clients and closes idle ones
+static void web_server_checkLinks()
+{
+    uint16_t idle;
+    uint8_t sock;
+    for (sock = 0; sock < ESP8266_LINK_COUNT; sock++)
     {
-        if (web_server_restApi && strncmp(url, "/api/", 5) == 0)
+        WebServerLink *link = &web_server_links[sock];
+        if (link->closing)
         {
-            (*web_server_restApi)(url+5,
-                                  type, web_server_buffer);
-            esp8266_write_socket_string(sock, web_server_buffer);
+            if (link->closePending)
+                web_server_queueClose(sock);
+            continue;
         }
-        else
+        if (!link->open)
         {
-            const Fs_File *file;
-
-            if (strcmp(url, "/") == 0)
-                file = getFile(web_server_file_list, "index.html");
-            else
-                file = getFile(web_server_file_list, url + 1);
-
-            if (file == NULL)  // search in fs
+            if (esp8266_isLinkConnected(sock))
             {
-                http_write_header_code(web_server_buffer, HTTP_NOT_FOUND);
-                http_write_header_end(web_server_buffer);
-                esp8266_write_socket_string(sock, web_server_buffer);
+                link->open = 1;
+                link->requests = 0;
+                link->stream = NULL;
+                link->webSocket = 0;
+                link->lastActivity = web_server_time;
+                http_request_reset(&link->request);
             }
-            else
+            continue;
+        }
+        if (!esp8266_isLinkConnected(sock))
+        {
+            link->open = 0;
+            link->stream = NULL;
+            link->webSocket = 0;
+        }
+        else if (link->webSocket)
+        {
+            // clients answer pings with a pong, silent links are lost
+            idle = web_server_time - link->lastActivity;
+            if (idle >= 2 * (WEB_SERVER_WEBSOCKET_PING / WEB_SERVER_TICK_MS))
+                web_server_closeWebSocket(sock, WEBSOCKET_CLOSE_GOING_AWAY);
+            else if (idle >= WEB_SERVER_WEBSOCKET_PING / WEB_SERVER_TICK_MS && !link->webSocketPing
+                     && link->pending == 0 && esp8266_write_free() > 0)
             {
-                unsigned int idData = 0, start;
-                http_write_header_code(web_server_buffer, HTTP_OK);
-
-                // content type
-                http_write_content_type(web_server_buffer, file->type);
-
-                // end of header
-                http_write_header_end(web_server_buffer);
-                start = strlen(web_server_buffer);
-
-                while (idData + 2048 < file->size)
-                {
-                    memcpy(web_server_buffer + start, file->data + idData,
-                           2048 - start);
-                    esp8266_write_socket(sock, web_server_buffer, 2048);
-                    idData += 2048 - start;
-                    start = 0;
-                }
-                memcpy(web_server_buffer + start, file->data + idData,
-                       file->size - idData);
-                esp8266_write_socket(sock, web_server_buffer,
-                                     file->size - idData + start);
+                web_server_sendControl(sock, WEBSOCKET_OPCODE_PING, NULL, 0);
+                link->webSocketPing = 1;
             }
         }
+        else if (link->pending == 0
+                 && (uint16_t)(web_server_time - link->lastActivity) >= WEB_SERVER_IDLE_TIMEOUT / WEB_SERVER_TICK_MS)
+            web_server_close(sock);
+    }
+}
+
+/**
+ * @brief web_server_close stops serving a link and queues its CIPCLOSE, or
+ * lets web_server_task queue it if the write queue is full
+ */
+static void web_server_close(uint8_t sock)
+{
+    if (web_server_links[sock].closing)
+        return;
+    web_server_links[sock].open = 0;
+    web_server_links[sock].closing = 1;
+    web_server_links[sock].stream = NULL;
+    web_server_links[sock].webSocket = 0;
+    web_server_links[sock].requests = 0;
+    http_request_reset(&web_server_links[sock].request);
+    web_server_queueClose(sock);
+}
+
+static void web_server_queueClose(uint8_t sock)
+{
+    WebServerLink *link = &web_server_links[sock];
+    link->closePending = (esp8266_close_socket_async(sock, web_server_closed, link) < 0);
+}
+
+// the link can be used by a new connection
+static void web_server_closed(uint8_t sock, int status, void *arg)
+{
+    (void)sock;
+    (void)status;
+    ((WebServerLink *)arg)->closing = 0;
+}
+
+// HTTP/1.1 connections are persistent unless closed, HTTP/1.0 ones on demand
+static uint8_t web_server_keepAlive(uint8_t sock, const HTTP_REQUEST *request)
+{
+    const HTTP_SLICE *connection = http_request_header(request, "Connection");
+
+    if (web_server_links[sock].requests + 1 >= WEB_SERVER_KEEPALIVE_MAX)
+        return 0;
+    if (connection != NULL && http_header_has_token(connection->ptr, connection->size, "close"))
+        return 0;
+    if (request->versionMinor >= 1)
+        return 1;
+    return (connection != NULL && http_header_has_token(connection->ptr, connection->size, "keep-alive"));
+}
+
+static void web_server_writeConnection(Buffer *header, const HTTP_REQUEST *request, uint8_t keepAlive)
+{
+    if (!keepAlive)
+        http_buffer_field(header, "Connection", "close");
+    else if (request->versionMinor == 0)
+        http_buffer_field(header, "Connection", "keep-alive");
+}
+
+// completion of a queued write, releases its buffer
+static void web_server_sent(uint8_t sock, int status, void *arg)
+{
+    (void)sock;
+    (void)status;
+    (*(uint8_t *)arg)--;
+}
+
+/**
+ * @brief web_server_write queues a write, data must stay valid until the
+ * pending counter given is decremented. Callers check the room in the write
+ * queue first, a write that does not fit truncates the response, the link
+ * is closed
+ */
+static void web_server_write(uint8_t sock, const char *data, uint32_t size, uint8_t *pending)
+{
+    if (size == 0 || !web_server_links[sock].open)
+        return;
+    if (esp8266_write_socket_async(sock, data, size, web_server_sent, pending) < 0)
+    {
+        web_server_close(sock);
+        return;
     }
+    (*pending)++;
+}
+
+// empty header buffer of a link, free once checked by web_server_ready
+static Buffer *web_server_header(uint8_t sock)
+{
+    WebServerLink *link = &web_server_links[sock];
+    buffer_init(&link->header, link->headerData, WEB_SERVER_HEADER_SIZE);
+    return &link->header;
+}
+
+/**
+ * @return keepAlive, cleared if the response cannot be delimited
+ */
+static uint8_t web_server_respond(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive)
+{
+    const Fs_File *file;
+    const char *name;
+    Buffer *header;
+
+    if (web_server_isWebSocket(request))
+        return web_server_acceptWebSocket(sock, request, keepAlive);
+    if (web_server_isRest(request))
+        return web_server_sendRest(sock, request, keepAlive);
+
+    if (strcmp(request->path.ptr, "/") == 0)
+        name = "index.html";
     else
+        name = request->path.ptr + 1;
+    file = getFile(web_server_file_list, name);
+
+    if (file == NULL)  // search in fs
     {
-        http_write_header_code(web_server_buffer, HTTP_BAD_REQUEST);
-        http_write_header_end(web_server_buffer);
-        esp8266_write_socket_string(sock, web_server_buffer);
+#ifdef USE_MODULE_assets
+        if (web_server_sendAsset(sock, request, name, keepAlive) == 0)
+            return keepAlive;
+#endif
+        header = web_server_header(sock);
+        http_buffer_status(header, HTTP_NOT_FOUND);
+        http_buffer_content_length(header, 0);
+        web_server_writeConnection(header, request, keepAlive);
+        http_buffer_end(header);
+        web_server_write(sock, header->data, header->size, &web_server_links[sock].pending);
     }
-    esp8266_close_socket(sock);
+    else
+        web_server_sendFile(sock, request, file, keepAlive);
+    return keepAlive;
+}
+
+/**
+ * @brief web_server_sendRest calls the rest api and adds the Content-Length
+ * and Connection fields to its response, or the Transfer-Encoding field if
+ * the body is streamed. The body is dropped for HEAD requests
+ * @return keepAlive, cleared if the response has no header end
+ */
+static uint8_t web_server_sendRest(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive)
+{
+    char fields[64] = "";
+    char *end, *length;
+    size_t size, fieldsSize;
+
+    web_server_buffer[0] = 0;
+    web_server_streamNew = NULL;
+    (*web_server_restApi)(request->path.ptr + 5,
+                          request->type, web_server_buffer);
+
+    size = strlen(web_server_buffer);
+    end = strstr(web_server_buffer, "\r\n\r\n");
+    if (web_server_streamNew != NULL)
+        return web_server_sendStream(sock, request, keepAlive, end);
+
+    if (end == NULL)
+        keepAlive = 0;  // the end of connection delimits the response
+    else
+    {
+        end += 2;
+        length = strstr(web_server_buffer, "Content-Length:");
+        if (length == NULL || length > end)
+            http_write_content_length(fields, size - (end + 2 - web_server_buffer));
+        if (!keepAlive)
+            strcat(fields, "Connection: close\r\n");
+        else if (request->versionMinor == 0)
+            strcat(fields, "Connection: keep-alive\r\n");
+
+        fieldsSize = strlen(fields);
+        if (size + fieldsSize < sizeof(web_server_buffer))
+        {
+            memmove(end + fieldsSize, end, size - (end - web_server_buffer) + 1);
+            memcpy(end, fields, fieldsSize);
+            end += fieldsSize;
+        }
+        else
+            keepAlive = 0;
+
+        // HEAD gets the header only, its Content-Length is the one of the body
+        if (request->type == HTTP_QUERRY_TYPE_HEAD)
+            end[2] = 0;
+    }
+    web_server_write(sock, web_server_buffer, strlen(web_server_buffer), &web_server_bufferPending);
+    return keepAlive;
+}
+
+/**
+ * @brief web_server_sendStream ends the header written by the rest api, the
+ * body is produced by the stream given to web_server_stream, chunked for
+ * HTTP/1.1 clients and delimited by the end of connection for HTTP/1.0 ones
+ * @param end header end written by the rest api, NULL if none
+ * @return keepAlive
+ */
+static uint8_t web_server_sendStream(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive, char *end)
+{
+    WebServerLink *link = &web_server_links[sock];
+    Buffer header;
+
+    if (end != NULL)
+        end[2] = 0;     // body is only produced by the stream
+    header.data = web_server_buffer;
+    header.size = strlen(web_server_buffer);
+    header.tail = web_server_buffer + header.size;
+    header.data_size = sizeof(web_server_buffer);
+
+    link->streamChunked = (request->versionMinor >= 1);
+    if (link->streamChunked)
+        http_buffer_chunked(&header);
+    else
+        keepAlive = 0;
+    web_server_writeConnection(&header, request, keepAlive);
+    http_buffer_end(&header);
+    web_server_write(sock, header.data, header.size, &web_server_bufferPending);
+
+    // HEAD gets the header only
+    if (request->type != HTTP_QUERRY_TYPE_HEAD)
+    {
+        link->stream = web_server_streamNew;
+        link->streamArg = web_server_streamArg;
+    }
+    web_server_streamNew = NULL;
+    return keepAlive;
+}
+
+static void web_server_sendFile(uint8_t sock, const HTTP_REQUEST *request, const Fs_File *file, uint8_t keepAlive)
+{
+    const char *data = file->data;
+    uint32_t size = file->size, first, last;
+    const HTTP_SLICE *accept, *match = NULL;
+    Buffer *header = web_server_header(sock);
+    uint8_t *pending = &web_server_links[sock].pending;
+    int status;
+
+    // conditional request, the cached copy is still valid
+    if (file->etag != NULL)
+        match = http_request_header(request, "If-None-Match");
+    if (match != NULL && http_header_match_etag(match->ptr, match->size, file->etag))
+    {
+        http_buffer_status(header, HTTP_NOT_MODIFIED);
+        http_buffer_field(header, "ETag", file->etag);
+        http_buffer_field(header, "Cache-Control", WEB_SERVER_CACHE_CONTROL);
+        if (file->flags & FS_FILE_GZIP)
+            http_buffer_field(header, "Vary", "Accept-Encoding");
+        web_server_writeConnection(header, request, keepAlive);
+        http_buffer_end(header);
+        web_server_write(sock, header->data, header->size, pending);
+        return;
+    }
+
+    status = web_server_range(request, file->size, file->etag, &first, &last);
+    http_buffer_status(header, status);
+
+    // content type
+    http_buffer_content_type(header, file->type);
+
+    // gzip variant if the client accepts it, ranges are served from the
+    // identity data
+    if (file->flags & FS_FILE_GZIP)
+    {
+        accept = http_request_header(request, "Accept-Encoding");
+        if (status == HTTP_OK && accept != NULL && http_header_has_token(accept->ptr, accept->size, "gzip"))
+        {
+            data = file->gzipData;
+            size = file->gzipSize;
+            http_buffer_content_encoding(header, "gzip");
+        }
+        http_buffer_field(header, "Vary", "Accept-Encoding");
+    }
+
+    // validator for conditional requests
+    if (file->etag != NULL)
+    {
+        http_buffer_field(header, "ETag", file->etag);
+        http_buffer_field(header, "Cache-Control", WEB_SERVER_CACHE_CONTROL);
+    }
+
+    // framing of persistent connections
+    if (data == file->data)
+    {
+        http_buffer_field(header, "Accept-Ranges", "bytes");
+        size = web_server_writeRange(header, status, first, last, size);
+        data += first;
+    }
+    else
+        http_buffer_content_length(header, size);
+    web_server_writeConnection(header, request, keepAlive);
+
+    // end of header
+    http_buffer_end(header);
+    web_server_write(sock, header->data, header->size, pending);
+
+    // HEAD gets the header of the GET response only, the body is sent from
+    // the file data, without copy
+    if (request->type != HTTP_QUERRY_TYPE_HEAD)
+        web_server_write(sock, data, size, pending);
+}
+
+/**
+ * @brief web_server_range byte range of a GET response asked by the Range
+ * field. If-Range must be the current etag, otherwise the whole body is sent
+ * @param length size of the body
+ * @param etag validator of the body, NULL if none
+ * @param first first byte of the range, 0 if the whole body is sent
+ * @param last last byte of the range
+ * @return HTTP_OK, HTTP_PARTIAL_CONTENT or HTTP_RANGE_NOT_SATISFIABLE
+ */
+static int web_server_range(const HTTP_REQUEST *request, uint32_t length, const char *etag, uint32_t *first, uint32_t *last)
+{
+    const HTTP_SLICE *range, *ifRange;
+    int valid;
+
+    *first = 0;
+    *last = length - 1;
+    if (request->type != HTTP_QUERRY_TYPE_GET)
+        return HTTP_OK;
+    range = http_request_header(request, "Range");
+    if (range == NULL)
+        return HTTP_OK;
+
+    // If-Range with a date or an old etag, the client copy is not valid
+    ifRange = http_request_header(request, "If-Range");
+    if (ifRange != NULL
+     && (etag == NULL || ifRange->size != strlen(etag) || strncmp(ifRange->ptr, etag, ifRange->size) != 0))
+        return HTTP_OK;
+
+    valid = http_header_parse_range(range->ptr, range->size, length, first, last);
+    if (valid < 0)
+        return HTTP_RANGE_NOT_SATISFIABLE;
+    if (valid == 0)
+    {
+        *first = 0;
+        *last = length - 1;
+        return HTTP_OK;     // multiple ranges or invalid field, ignored
+    }
+    return HTTP_PARTIAL_CONTENT;
+}
+
+/**
+ * @brief web_server_writeRange Content-Range and Content-Length of a file body
+ * @param status returned by web_server_range
+ * @return size of the body to send
+ */
+static uint32_t web_server_writeRange(Buffer *header, int status, uint32_t first, uint32_t last, uint32_t length)
+{
+    if (status == HTTP_RANGE_NOT_SATISFIABLE)
+    {
+        http_buffer_content_range(header, 1, 0, length);
+        length = 0;
+    }
+    else if (status == HTTP_PARTIAL_CONTENT)
+    {
+        http_buffer_content_range(header, first, last, length);
+        length = last - first + 1;
+    }
+    http_buffer_content_length(header, length);
+    return length;
+}
+
+#ifdef USE_MODULE_assets
+/**
+ * @brief web_server_sendAsset sends a ASSETS_TYPE_FILE asset of the opened
+ * pack, without copy if the pack is memory mapped, streamed from the storage
+ * otherwise
+ * @return 0 if sent, -1 if the asset is not found
+ */
+static int web_server_sendAsset(uint8_t sock, const HTTP_REQUEST *request, const char *name, uint8_t keepAlive)
+{
+    WebServerLink *link = &web_server_links[sock];
+    Asset *asset = &link->asset;
+    char type[WEB_SERVER_ASSET_TYPE_SIZE];
+    const char *data;
+    uint32_t size, first, last;
+    ssize_t typeSize;
+    Buffer *header;
+    int status;
+
+    if (assets_find(asset, name) < 0 || asset->type != ASSETS_TYPE_FILE)
+        return -1;
+    typeSize = assets_readMeta(asset, type, sizeof(type) - 1);
+    if (typeSize < 0)
+        return -1;
+    type[typeSize] = '\0';
+
+    header = web_server_header(sock);
+    status = web_server_range(request, asset->size, NULL, &first, &last);
+    http_buffer_status(header, status);
+    http_buffer_content_type(header, type);
+    http_buffer_field(header, "Accept-Ranges", "bytes");
+    size = web_server_writeRange(header, status, first, last, asset->size);
+    web_server_writeConnection(header, request, keepAlive);
+    http_buffer_end(header);
+    web_server_write(sock, header->data, header->size, &link->pending);
+
+    if (request->type == HTTP_QUERRY_TYPE_HEAD || size == 0)
+        return 0;
+
+    data = (const char *)assets_map(asset);
+    if (data != NULL)
+    {
+        web_server_write(sock, data + first, size, &link->pending);
+        return 0;
+    }
+
+    // external flash, read by web_server_buffer sized blocks, the asset ends
+    // at the end of the range
+    asset->size = first + size;
+    assets_seek(asset, first);
+    link->stream = web_server_streamAsset;
+    link->streamArg = link;
+    link->streamChunked = 0;
+    return 0;
+}
+
+static uint16_t web_server_streamAsset(char *buffer, uint16_t size, void *arg)
+{
+    WebServerLink *link = (WebServerLink *)arg;
+    ssize_t read;
+
+    read = assets_read(&link->asset, buffer, size);
+    if (read < 0)
+    {
+        link->keepAlive = 0;    // storage error, the body is truncated
+        return 0;
+    }
+    return read;
+}
+#endif
+
+static void web_server_sendError(uint8_t sock, int code)
+{
+    Buffer *header = web_server_header(sock);
+
+    http_buffer_status(header, code);
+    http_buffer_content_length(header, 0);
+    http_buffer_field(header, "Connection", "close");
+    http_buffer_end(header);
+    web_server_write(sock, header->data, header->size, &web_server_links[sock].pending);
+}
+
+/**
+ * @brief web_server_stream called by the rest api instead of writing a body,
+ * the header written in the buffer is sent, then the body is asked to stream
+ * by parts, once the previous part is sent
+ * @param stream producer of the body, writes at most size bytes, returns the
+ * written size, 0 at the end of the body
+ * @param arg argument given to stream
+ */
+void web_server_stream(WEB_SERVER_STREAM stream, void *arg)
+{
+    web_server_streamNew = stream;
+    web_server_streamArg = arg;
+}
+
+/**
+ * @brief web_server_isWebSocket checks for an upgrade request of the
+ * WebSocket endpoint
+ */
+static uint8_t web_server_isWebSocket(const HTTP_REQUEST *request)
+{
+    const HTTP_SLICE *upgrade;
+
+    if (web_server_wsPath == NULL || request->type != HTTP_QUERRY_TYPE_GET)
+        return 0;
+    if (strcmp(request->path.ptr, web_server_wsPath) != 0)
+        return 0;
+    upgrade = http_request_header(request, "Upgrade");
+    return (upgrade != NULL && http_header_has_token(upgrade->ptr, upgrade->size, "websocket"));
+}
+
+/**
+ * @brief web_server_acceptWebSocket answers the handshake, the link then
+ * decodes its received data as frames in its request buffer
+ * @return keepAlive, set if the link is upgraded
+ */
+static uint8_t web_server_acceptWebSocket(uint8_t sock, const HTTP_REQUEST *request, uint8_t keepAlive)
+{
+    WebServerLink *link = &web_server_links[sock];
+    const HTTP_SLICE *version = http_request_header(request, "Sec-WebSocket-Version");
+    const HTTP_SLICE *key = http_request_header(request, "Sec-WebSocket-Key");
+    char accept[WEBSOCKET_ACCEPT_SIZE];
+    Buffer *header = web_server_header(sock);
+
+    if (version == NULL || strcmp(version->ptr, "13") != 0)
+    {
+        http_buffer_status(header, HTTP_UPGRADE_REQUIRED);
+        http_buffer_field(header, "Sec-WebSocket-Version", "13");
+    }
+    else if (key == NULL || websocket_accept(key->ptr, key->size, accept) < 0)
+        http_buffer_status(header, HTTP_BAD_REQUEST);
+    else
+    {
+        http_buffer_status(header, HTTP_SWITCHING_PROTOCOLS);
+        http_buffer_field(header, "Upgrade", "websocket");
+        http_buffer_field(header, "Connection", "Upgrade");
+        http_buffer_field(header, "Sec-WebSocket-Accept", accept);
+        http_buffer_end(header);
+        web_server_write(sock, header->data, header->size, &link->pending);
+
+        link->webSocket = 1;
+        link->webSocketPing = 0;
+        websocket_init(&link->ws, link->requestBuffer, WEB_SERVER_REQUEST_SIZE);
+        return 1;
+    }
+    http_buffer_content_length(header, 0);
+    web_server_writeConnection(header, request, keepAlive);
+    http_buffer_end(header);
+    web_server_write(sock, header->data, header->size, &link->pending);
+    return keepAlive;
+}
+
+/**
+ * @brief web_server_serveWebSocket decodes the received frames of an
+ * upgraded link, answers control frames and gives messages to the receive
+ * callback, one message per call. A message waits until the previous
+ * control frame of the link is sent
+ */
+static void web_server_serveWebSocket(uint8_t sock)
+{
+    WebServerLink *link = &web_server_links[sock];
+    WEBSOCKET_DECODER *ws = &link->ws;
+    uint16_t size;
+
+    if (!web_server_ready(sock, 0))
+        return;
+
+    while (ws->state != WEBSOCKET_STATE_MESSAGE && ws->state != WEBSOCKET_STATE_ERROR)
+    {
+        size = esp8266_getRecSize(sock);
+        if (size == 0)
+            return;
+        link->lastActivity = web_server_time;
+        link->webSocketPing = 0;
+        esp8266_releaseRec(sock, websocket_feed(ws, esp8266_getRecData(sock), size));
+    }
+    if (ws->state == WEBSOCKET_STATE_ERROR)
+    {
+        web_server_closeWebSocket(sock, ws->error);
+        return;
+    }
+
+    switch (ws->opcode)
+    {
+    case WEBSOCKET_OPCODE_PING:
+        web_server_sendControl(sock, WEBSOCKET_OPCODE_PONG, ws->data, ws->dataSize);
+        break;
+    case WEBSOCKET_OPCODE_PONG:
+        break;
+    case WEBSOCKET_OPCODE_CLOSE:
+        // the status of the client is echoed
+        web_server_sendControl(sock, WEBSOCKET_OPCODE_CLOSE, ws->data, ws->dataSize < 2 ? 0 : 2);
+        web_server_close(sock);
+        return;
+    default:
+        if (web_server_wsReceive != NULL)
+            (*web_server_wsReceive)(sock, ws->opcode, ws->data, ws->dataSize);
+        break;
+    }
+    websocket_next(ws);
+}
+
+// control frame of a link, copied in its header buffer until it is sent
+static void web_server_sendControl(uint8_t sock, uint8_t opcode, const char *data, uint8_t size)
+{
+    WebServerLink *link = &web_server_links[sock];
+    uint8_t head;
+
+    head = websocket_frame_head(link->headerData, opcode, size);
+    if (size > 0)
+        memcpy(link->headerData + head, data, size);
+    web_server_write(sock, link->headerData, head + size, &link->pending);
+}
+
+static void web_server_closeWebSocket(uint8_t sock, uint16_t status)
+{
+    char data[2];
+
+    // close frame and CIPCLOSE
+    if (web_server_links[sock].pending == 0 && esp8266_write_free() >= 2)
+    {
+        data[0] = status >> 8;
+        data[1] = status & 0xFF;
+        web_server_sendControl(sock, WEBSOCKET_OPCODE_CLOSE, data, 2);
+    }
+    web_server_close(sock);
+}
+
+/**
+ * @brief web_server_frame writes a frame in web_server_wsFrame
+ * @return frame size, 0 if the frame buffer is used or too small
+ */
+static uint16_t web_server_frame(uint8_t opcode, const char *data, uint16_t size)
+{
+    uint8_t head;
+
+    if (web_server_wsPending > 0 || size > WEB_SERVER_WEBSOCKET_FRAME_SIZE - WEBSOCKET_HEAD_MAX)
+        return 0;
+    head = websocket_frame_head(web_server_wsFrame, opcode, size);
+    if (data != web_server_wsFrame + WEBSOCKET_HEAD_MAX)
+        memcpy(web_server_wsFrame + head, data, size);
+    else if (head < WEBSOCKET_HEAD_MAX)
+        memmove(web_server_wsFrame + head, data, size);  // written by the publisher
+    return head + size;
+}
+
+// calls the publisher each period while there are subscribers
+static void web_server_runPublisher()
+{
+    uint16_t size;
+
+    if (web_server_wsPublisher == NULL || web_server_wsPending > 0)
+        return;
+    if ((uint16_t)(web_server_time - web_server_wsPublished) < web_server_wsPublisherPeriod)
+        return;
+    if (web_server_subscribers() == 0)
+        return;
+    web_server_wsPublished = web_server_time;
+
+    size = (*web_server_wsPublisher)(web_server_wsFrame + WEBSOCKET_HEAD_MAX,
+                                     WEB_SERVER_WEBSOCKET_FRAME_SIZE - WEBSOCKET_HEAD_MAX,
+                                     web_server_wsPublisherArg);
+    if (size == 0 || size > WEB_SERVER_WEBSOCKET_FRAME_SIZE - WEBSOCKET_HEAD_MAX)
+        return;
+    web_server_publish(web_server_wsPublisherOpcode, web_server_wsFrame + WEBSOCKET_HEAD_MAX, size);
+}
+
+/**
+ * @brief web_server_setWebSocket enables the WebSocket endpoint
+ * @param path path of the upgrade requests, as "/ws"
+ * @param receive called with the text and binary messages of the clients,
+ * can be NULL
+ */
+void web_server_setWebSocket(const char *path, WEB_SERVER_WEBSOCKET receive)
+{
+    web_server_wsPath = path;
+    web_server_wsReceive = receive;
+}
+
+/**
+ * @brief web_server_subscribers number of upgraded links
+ */
+uint8_t web_server_subscribers()
+{
+    uint8_t sock, count = 0;
+
+    for (sock = 0; sock < ESP8266_LINK_COUNT; sock++)
+    {
+        if (web_server_links[sock].open && web_server_links[sock].webSocket)
+            count++;
+    }
+    return count;
+}
+
+/**
+ * @brief web_server_publish sends a frame to all WebSocket clients. The
+ * frame is copied once and queued for each client, it is dropped while the
+ * previous frame is sent, so slow clients lower the rate instead of
+ * delaying the next frames
+ * @param opcode WEBSOCKET_OPCODE_TEXT or WEBSOCKET_OPCODE_BINARY
+ * @return number of clients, -1 if the frame is dropped
+ */
+int web_server_publish(uint8_t opcode, const char *data, uint16_t size)
+{
+    uint8_t sock, count = web_server_subscribers();
+    uint16_t frameSize;
+
+    if (count == 0)
+        return 0;
+    if (esp8266_write_free() < count)
+        return -1;
+    frameSize = web_server_frame(opcode, data, size);
+    if (frameSize == 0)
+        return -1;
+    for (sock = 0; sock < ESP8266_LINK_COUNT; sock++)
+    {
+        if (web_server_links[sock].open && web_server_links[sock].webSocket)
+            web_server_write(sock, web_server_wsFrame, frameSize, &web_server_wsPending);
+    }
+    return count;
+}
+
+/**
+ * @brief web_server_webSocketSend sends a frame to one WebSocket client, as
+ * an answer from the receive callback
+ * @return 0 if success, -1 if the frame is dropped
+ */
+int web_server_webSocketSend(uint8_t sock, uint8_t opcode, const char *data, uint16_t size)
+{
+    uint16_t frameSize;
+
+    if (sock >= ESP8266_LINK_COUNT || !web_server_links[sock].open || !web_server_links[sock].webSocket)
+        return -1;
+    if (esp8266_write_free() == 0)
+        return -1;
+    frameSize = web_server_frame(opcode, data, size);
+    if (frameSize == 0)
+        return -1;
+    web_server_write(sock, web_server_wsFrame, frameSize, &web_server_wsPending);
+    return 0;
+}
+
+/**
+ * @brief web_server_setPublisher publishes frames at a fixed rate, the
+ * producer is called by web_server_task each period while there are
+ * subscribers and its previous frame is sent
+ * @param producer writes the frame payload, at most size bytes, returns the
+ * written size, 0 to skip this period
+ * @param period in ms, multiple of WEB_SERVER_TICK_MS
+ */
+void web_server_setPublisher(uint8_t opcode, WEB_SERVER_STREAM producer, void *arg, uint16_t period)
+{
+    web_server_wsPublisherOpcode = opcode;
+    web_server_wsPublisher = producer;
+    web_server_wsPublisherArg = arg;
+    web_server_wsPublisherPeriod = period / WEB_SERVER_TICK_MS;
+    web_server_wsPublished = web_server_time - web_server_wsPublisherPeriod;
 }
 
 void web_server_setRestApi( void (*restApi)(char *url, HTTP_QUERRY_TYPE code, char *buffer) )
@@ -13,10 +13,32 @@
 
 #include "http.h"
 #include "json.h"
+#include "rest.h"
+#include "websocket.h"
 #include "fs_data.h"
 
+// period of web_server_tick calls, time base of idle connections timeouts
+#ifndef WEB_SERVER_TICK_MS
+ #define WEB_SERVER_TICK_MS 100
+#endif
+
 void web_server_init();
 void web_server_task();
+void web_server_tick();
+const HTTP_REQUEST *web_server_currentRequest();
+int8_t web_server_currentSocket();
+
+// producer of a streamed rest response body, see web_server_stream
+typedef uint16_t (*WEB_SERVER_STREAM)(char *buffer, uint16_t size, void *arg);
+void web_server_stream(WEB_SERVER_STREAM stream, void *arg);
+
+// WebSocket endpoint, messages of clients are given to the receive callback
+typedef void (*WEB_SERVER_WEBSOCKET)(uint8_t sock, uint8_t opcode, const char *data, uint16_t size);
+void web_server_setWebSocket(const char *path, WEB_SERVER_WEBSOCKET receive);
+uint8_t web_server_subscribers();
+int web_server_publish(uint8_t opcode, const char *data, uint16_t size);
+int web_server_webSocketSend(uint8_t sock, uint8_t opcode, const char *data, uint16_t size);
+void web_server_setPublisher(uint8_t opcode, WEB_SERVER_STREAM producer, void *arg, uint16_t period);
 
 void web_server_setRestApi( void (*restApi)(char *url, HTTP_QUERRY_TYPE code, char *buffer) );
 void web_server_setRootFS(const Fs_FilesList *file_list);
@@ -0,0 +1,440 @@
+/**
+ * @file websocket.c
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief WebSocket protocol (RFC 6455) handshake and framing
+ */
+
+#include "websocket.h"
+
+#include <string.h>
+
+#define WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WEBSOCKET_KEY_SIZE 24   // base64 of 16 bytes
+
+#define WEBSOCKET_ROL(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
+
+// internal functions
+static void websocket_sha1Block(uint32_t *state, const uint8_t *block);
+static void websocket_sha1(const uint8_t *data, uint16_t size, uint8_t *digest);
+static void websocket_frameDone(WEBSOCKET_DECODER *ws);
+static int websocket_headDone(WEBSOCKET_DECODER *ws);
+static uint8_t websocket_headSize(const uint8_t *head);
+static void websocket_fail(WEBSOCKET_DECODER *ws, uint16_t error);
+
+static void websocket_sha1Block(uint32_t *state, const uint8_t *block)
+{
+    uint32_t w[16], a, b, c, d, e, f, k, t;
+    uint8_t i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16)
+             | ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    for (i = 0; i < 80; i++)
+    {
+        // message schedule in a 16 words ring
+        if (i >= 16)
+        {
+            t = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+            w[i & 15] = WEBSOCKET_ROL(t, 1);
+        }
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999UL;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1UL;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDCUL;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6UL;
+        }
+        t = WEBSOCKET_ROL(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = WEBSOCKET_ROL(b, 30);
+        b = a;
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static void websocket_sha1(const uint8_t *data, uint16_t size, uint8_t *digest)
+{
+    uint32_t state[5] = {0x67452301UL, 0xEFCDAB89UL, 0x98BADCFEUL, 0x10325476UL, 0xC3D2E1F0UL};
+    uint32_t bits = (uint32_t)size * 8;
+    uint8_t block[64];
+    uint16_t pos;
+    uint8_t i, last;
+
+    for (pos = 0; size - pos >= 64; pos += 64)
+        websocket_sha1Block(state, data + pos);
+
+    // padding, then the size in bits on 64 bits
+    last = size - pos;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + pos, last);
+    block[last] = 0x80;
+    if (last >= 56)
+    {
+        websocket_sha1Block(state, block);
+        memset(block, 0, sizeof(block));
+    }
+    for (i = 0; i < 4; i++)
+        block[63 - i] = bits >> (8 * i);
+    websocket_sha1Block(state, block);
+
+    for (i = 0; i < 20; i++)
+        digest[i] = state[i / 4] >> (24 - 8 * (i % 4));
+}
+
+/**
+ * @brief websocket_accept computes the Sec-WebSocket-Accept field of the
+ * handshake, base64 of the SHA-1 of the key and the protocol GUID
+ * @param key Sec-WebSocket-Key value
+ * @param accept WEBSOCKET_ACCEPT_SIZE bytes, NUL terminated
+ * @return 0 if success, -1 if the key is invalid
+ */
+int websocket_accept(const char *key, size_t keySize, char *accept)
+{
+    static const char base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    uint8_t text[WEBSOCKET_KEY_SIZE + sizeof(WEBSOCKET_GUID) - 1];
+    uint8_t digest[21];
+    uint32_t group;
+    uint8_t i;
+
+    if (keySize != WEBSOCKET_KEY_SIZE)
+        return -1;
+    memcpy(text, key, WEBSOCKET_KEY_SIZE);
+    memcpy(text + WEBSOCKET_KEY_SIZE, WEBSOCKET_GUID, sizeof(WEBSOCKET_GUID) - 1);
+    websocket_sha1(text, sizeof(text), digest);
+
+    // 20 bytes are 6 groups of 3 bytes and 2 bytes padded with '='
+    digest[20] = 0;
+    for (i = 0; i < 7; i++)
+    {
+        group = ((uint32_t)digest[3 * i] << 16) | ((uint32_t)digest[3 * i + 1] << 8) | digest[3 * i + 2];
+        accept[4 * i] = base64[(group >> 18) & 0x3F];
+        accept[4 * i + 1] = base64[(group >> 12) & 0x3F];
+        accept[4 * i + 2] = base64[(group >> 6) & 0x3F];
+        accept[4 * i + 3] = base64[group & 0x3F];
+    }
+    accept[27] = '=';
+    accept[28] = '\0';
+    return 0;
+}
+
+/**
+ * @brief websocket_frame_head writes the head of a server frame, final and
+ * not masked
+ * @param head WEBSOCKET_HEAD_MAX bytes
+ * @return head size
+ */
+uint8_t websocket_frame_head(char *head, uint8_t opcode, uint16_t size)
+{
+    head[0] = 0x80 | opcode;
+    if (size < 126)
+    {
+        head[1] = size;
+        return 2;
+    }
+    head[1] = 126;
+    head[2] = size >> 8;
+    head[3] = size & 0xFF;
+    return 4;
+}
+
+/**
+ * @brief websocket_init prepares a decoder
+ * @param buffer storage of the received messages
+ * @param size size of buffer, limit of the messages
+ */
+void websocket_init(WEBSOCKET_DECODER *ws, char *buffer, uint16_t size)
+{
+    memset(ws, 0, sizeof(WEBSOCKET_DECODER));
+    ws->buffer = buffer;
+    ws->bufferSize = size;
+    ws->state = WEBSOCKET_STATE_HEAD;
+}
+
+static void websocket_fail(WEBSOCKET_DECODER *ws, uint16_t error)
+{
+    ws->state = WEBSOCKET_STATE_ERROR;
+    ws->error = error;
+}
+
+// size of a frame head from its first two bytes
+static uint8_t websocket_headSize(const uint8_t *head)
+{
+    uint8_t size = 2;
+
+    if ((head[1] & 0x7F) == 126)
+        size += 2;
+    else if ((head[1] & 0x7F) == 127)
+        size += 8;
+    if (head[1] & 0x80)
+        size += 4;
+    return size;
+}
+
+static int websocket_headDone(WEBSOCKET_DECODER *ws)
+{
+    uint8_t *head = ws->head, pos = 2, i;
+
+    ws->frameFin = head[0] >> 7;
+    ws->frameOpcode = head[0] & 0x0F;
+    if ((head[0] & 0x70) != 0 || (head[1] & 0x80) == 0)
+        return WEBSOCKET_CLOSE_PROTOCOL_ERROR;  // extension bits or client frame not masked
+
+    switch (ws->frameOpcode)
+    {
+    case WEBSOCKET_OPCODE_CONTINUATION:
+        if (ws->messageOpcode == 0)
+            return WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+        break;
+    case WEBSOCKET_OPCODE_TEXT:
+    case WEBSOCKET_OPCODE_BINARY:
+        if (ws->messageOpcode != 0)
+            return WEBSOCKET_CLOSE_PROTOCOL_ERROR;  // fragmented message not ended
+        break;
+    case WEBSOCKET_OPCODE_CLOSE:
+    case WEBSOCKET_OPCODE_PING:
+    case WEBSOCKET_OPCODE_PONG:
+        if (!ws->frameFin || (head[1] & 0x7F) > WEBSOCKET_CONTROL_MAX)
+            return WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+        break;
+    default:
+        return WEBSOCKET_CLOSE_PROTOCOL_ERROR;
+    }
+
+    if ((head[1] & 0x7F) < 126)
+        ws->frameSize = head[1] & 0x7F;
+    else if ((head[1] & 0x7F) == 126)
+    {
+        ws->frameSize = ((uint16_t)head[2] << 8) | head[3];
+        pos = 4;
+    }
+    else
+    {
+        for (i = 2; i < 8; i++)
+        {
+            if (head[i] != 0)
+                return WEBSOCKET_CLOSE_TOO_BIG;
+        }
+        ws->frameSize = ((uint16_t)head[8] << 8) | head[9];
+        pos = 10;
+    }
+    memcpy(ws->mask, head + pos, 4);
+
+    if ((uint32_t)ws->messageSize + ws->frameSize > ws->bufferSize)
+        return WEBSOCKET_CLOSE_TOO_BIG;
+    return 0;
+}
+
+static void websocket_frameDone(WEBSOCKET_DECODER *ws)
+{
+    ws->headSize = 0;
+    ws->framePos = 0;
+    ws->state = WEBSOCKET_STATE_HEAD;
+
+    if (ws->frameOpcode & 0x08)
+    {
+        // control frame, stored after the fragments of the message
+        ws->opcode = ws->frameOpcode;
+        ws->data = ws->buffer + ws->messageSize;
+        ws->dataSize = ws->frameSize;
+        ws->state = WEBSOCKET_STATE_MESSAGE;
+        return;
+    }
+
+    if (ws->frameOpcode != WEBSOCKET_OPCODE_CONTINUATION)
+        ws->messageOpcode = ws->frameOpcode;
+    ws->messageSize += ws->frameSize;
+    if (!ws->frameFin)
+        return;     // next fragment
+
+    ws->opcode = ws->messageOpcode;
+    ws->data = ws->buffer;
+    ws->dataSize = ws->messageSize;
+    ws->messageOpcode = 0;
+    ws->messageSize = 0;
+    ws->state = WEBSOCKET_STATE_MESSAGE;
+}
+
+/**
+ * @brief websocket_feed decodes received data, stops after each message
+ * @return number of used bytes, the others are given again after
+ * websocket_next
+ */
+int websocket_feed(WEBSOCKET_DECODER *ws, const char *data, uint16_t size)
+{
+    uint16_t used = 0, part, i;
+    char *payload;
+    int error;
+
+    while (used < size && (ws->state == WEBSOCKET_STATE_HEAD || ws->state == WEBSOCKET_STATE_PAYLOAD))
+    {
+        if (ws->state == WEBSOCKET_STATE_HEAD)
+        {
+            ws->head[ws->headSize++] = data[used++];
+            if (ws->headSize < 2 || ws->headSize < websocket_headSize(ws->head))
+                continue;
+
+            error = websocket_headDone(ws);
+            if (error != 0)
+            {
+                websocket_fail(ws, error);
+                break;
+            }
+            ws->state = WEBSOCKET_STATE_PAYLOAD;
+            if (ws->frameSize == 0)
+                websocket_frameDone(ws);
+            continue;
+        }
+
+        // payload, unmasked while copied
+        part = ws->frameSize - ws->framePos;
+        if (part > size - used)
+            part = size - used;
+        payload = ws->buffer + ws->messageSize + ws->framePos;
+        for (i = 0; i < part; i++)
+            payload[i] = data[used + i] ^ ws->mask[(ws->framePos + i) & 3];
+        ws->framePos += part;
+        used += part;
+        if (ws->framePos == ws->frameSize)
+            websocket_frameDone(ws);
+    }
+    return used;
+}
+
+/**
+ * @brief websocket_next continues after a received message
+ */
+void websocket_next(WEBSOCKET_DECODER *ws)
+{
+    if (ws->state == WEBSOCKET_STATE_MESSAGE)
+        ws->state = WEBSOCKET_STATE_HEAD;
+}
+
+#ifdef TEST
+// gcc -DTEST -I../../../include websocket.c
+#include <stdio.h>
+#include <assert.h>
+
+static uint16_t test_frame(char *frame, uint8_t head0, const char *payload, uint16_t size)
+{
+    static const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    uint16_t pos = 2, i;
+
+    frame[0] = head0;
+    if (size < 126)
+        frame[1] = 0x80 | size;
+    else
+    {
+        frame[1] = 0x80 | 126;
+        frame[2] = size >> 8;
+        frame[3] = size & 0xFF;
+        pos = 4;
+    }
+    memcpy(frame + pos, mask, 4);
+    pos += 4;
+    for (i = 0; i < size; i++)
+        frame[pos + i] = payload[i] ^ mask[i & 3];
+    return pos + size;
+}
+
+int main(void)
+{
+    WEBSOCKET_DECODER ws;
+    char accept[WEBSOCKET_ACCEPT_SIZE];
+    char buffer[300], data[600], big[200];
+    uint16_t size, pos;
+    char head[WEBSOCKET_HEAD_MAX];
+
+    // RFC 6455 example
+    assert(websocket_accept("dGhlIHNhbXBsZSBub25jZQ==", 24, accept) == 0);
+    assert(strcmp(accept, "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == 0);
+    assert(websocket_accept("dGhlIHNhbXBsZSBub25jZQ=", 23, accept) < 0);
+
+    assert(websocket_frame_head(head, WEBSOCKET_OPCODE_TEXT, 5) == 2 && head[0] == (char)0x81 && head[1] == 5);
+    assert(websocket_frame_head(head, WEBSOCKET_OPCODE_BINARY, 300) == 4 && head[1] == 126 && head[2] == 1 && head[3] == 44);
+
+    // masked "Hello", byte by byte
+    websocket_init(&ws, buffer, sizeof(buffer));
+    size = test_frame(data, 0x81, "Hello", 5);
+    for (pos = 0; pos < size; pos++)
+        assert(websocket_feed(&ws, data + pos, 1) == 1);
+    assert(ws.state == WEBSOCKET_STATE_MESSAGE && ws.opcode == WEBSOCKET_OPCODE_TEXT);
+    assert(ws.dataSize == 5 && memcmp(ws.data, "Hello", 5) == 0);
+    websocket_next(&ws);
+
+    // fragments with a ping between them, then a pipelined frame
+    memset(big, 'x', sizeof(big));
+    size = test_frame(data, 0x01, "Hel", 3);
+    size += test_frame(data + size, 0x89, "p", 1);
+    size += test_frame(data + size, 0x80, "lo", 2);
+    size += test_frame(data + size, 0x82, big, sizeof(big));
+    pos = websocket_feed(&ws, data, size);
+    assert(ws.state == WEBSOCKET_STATE_MESSAGE && ws.opcode == WEBSOCKET_OPCODE_PING && ws.dataSize == 1 && ws.data[0] == 'p');
+    websocket_next(&ws);
+    pos += websocket_feed(&ws, data + pos, size - pos);
+    assert(ws.state == WEBSOCKET_STATE_MESSAGE && ws.opcode == WEBSOCKET_OPCODE_TEXT && ws.dataSize == 5 && memcmp(ws.data, "Hello", 5) == 0);
+    websocket_next(&ws);
+    pos += websocket_feed(&ws, data + pos, size - pos);
+    assert(pos == size && ws.opcode == WEBSOCKET_OPCODE_BINARY && ws.dataSize == sizeof(big) && memcmp(ws.data, big, sizeof(big)) == 0);
+    websocket_next(&ws);
+
+    // errors
+    websocket_init(&ws, buffer, sizeof(buffer));
+    size = test_frame(data, 0x02, big, sizeof(big));
+    size += test_frame(data + size, 0x80, big, sizeof(big));
+    pos = websocket_feed(&ws, data, size);
+    assert(ws.state == WEBSOCKET_STATE_ERROR && ws.error == WEBSOCKET_CLOSE_TOO_BIG);
+
+    websocket_init(&ws, buffer, sizeof(buffer));
+    size = test_frame(data, 0x80, "a", 1);
+    websocket_feed(&ws, data, size);
+    assert(ws.state == WEBSOCKET_STATE_ERROR && ws.error == WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+
+    websocket_init(&ws, buffer, sizeof(buffer));
+    size = test_frame(data, 0x09, "a", 1);
+    websocket_feed(&ws, data, size);
+    assert(ws.state == WEBSOCKET_STATE_ERROR);
+
+    websocket_init(&ws, buffer, sizeof(buffer));
+    data[0] = 0x81;
+    data[1] = 0x01;     // not masked
+    websocket_feed(&ws, data, 3);
+    assert(ws.state == WEBSOCKET_STATE_ERROR && ws.error == WEBSOCKET_CLOSE_PROTOCOL_ERROR);
+
+    // close with status
+    websocket_init(&ws, buffer, sizeof(buffer));
+    size = test_frame(data, 0x88, "\x03\xe8", 2);
+    assert(websocket_feed(&ws, data, size) == size);
+    assert(ws.opcode == WEBSOCKET_OPCODE_CLOSE && ws.dataSize == 2 && ws.data[0] == 0x03);
+
+    printf("websocket OK\n");
+    return 0;
+}
+
+#endif // TEST
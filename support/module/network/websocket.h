@@ -0,0 +1,79 @@
+/**
+ * @file websocket.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief WebSocket protocol (RFC 6455) handshake and framing
+ */
+
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// frame opcodes
+#define WEBSOCKET_OPCODE_CONTINUATION 0x0
+#define WEBSOCKET_OPCODE_TEXT         0x1
+#define WEBSOCKET_OPCODE_BINARY       0x2
+#define WEBSOCKET_OPCODE_CLOSE        0x8
+#define WEBSOCKET_OPCODE_PING         0x9
+#define WEBSOCKET_OPCODE_PONG         0xA
+
+// close status codes
+#define WEBSOCKET_CLOSE_NORMAL         1000
+#define WEBSOCKET_CLOSE_GOING_AWAY     1001
+#define WEBSOCKET_CLOSE_PROTOCOL_ERROR 1002
+#define WEBSOCKET_CLOSE_TOO_BIG        1009
+
+// handshake, Sec-WebSocket-Accept value of a Sec-WebSocket-Key
+#define WEBSOCKET_ACCEPT_SIZE 29    // base64 of a SHA-1 and NUL
+int websocket_accept(const char *key, size_t keySize, char *accept);
+
+// server frames are not masked, the head is followed by the payload
+#define WEBSOCKET_HEAD_MAX 4        // head of payloads up to 65535 bytes
+#define WEBSOCKET_CONTROL_MAX 125   // payload of control frames
+uint8_t websocket_frame_head(char *head, uint8_t opcode, uint16_t size);
+
+// decoder of the frames sent by a client
+typedef enum
+{
+    WEBSOCKET_STATE_HEAD = 0,   ///< receiving a frame head
+    WEBSOCKET_STATE_PAYLOAD,    ///< receiving a frame payload
+    WEBSOCKET_STATE_MESSAGE,    ///< a message is received, call websocket_next after use
+    WEBSOCKET_STATE_ERROR       ///< protocol error, error is the close status
+} WEBSOCKET_STATE;
+
+/**
+ * @brief WEBSOCKET_DECODER incremental decoder of client frames, unmasked and
+ * reassembled in buffer. Control frames between fragments are stored after
+ * the received fragments
+ */
+typedef struct
+{
+    char *buffer;
+    uint16_t bufferSize;
+    uint8_t state;          ///< WEBSOCKET_STATE
+    uint8_t head[14];
+    uint8_t headSize;
+    uint8_t frameOpcode;
+    uint8_t frameFin;
+    uint8_t mask[4];
+    uint16_t frameSize;     ///< payload size of the current frame
+    uint16_t framePos;      ///< received payload of the current frame
+    uint16_t messageSize;   ///< received fragments of the current message
+    uint8_t messageOpcode;  ///< opcode of the fragmented message, 0 if none
+
+    // received message, valid in WEBSOCKET_STATE_MESSAGE
+    uint8_t opcode;
+    char *data;
+    uint16_t dataSize;
+
+    uint16_t error;         ///< close status in WEBSOCKET_STATE_ERROR
+} WEBSOCKET_DECODER;
+
+void websocket_init(WEBSOCKET_DECODER *ws, char *buffer, uint16_t size);
+int websocket_feed(WEBSOCKET_DECODER *ws, const char *data, uint16_t size);
+void websocket_next(WEBSOCKET_DECODER *ws);
+
+#endif // WEBSOCKET_H
@@ -6,7 +6,7 @@
 #include "robot.h"
 #include "archi.h"
 
-extern void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer);
+extern void rest_api_init();
 extern const Fs_FilesList file_list;
 
 //#include "a6channels.h"
@@ -40,7 +40,7 @@ int main(void)
 
     network_init();
     a6_init(uart(A6_UART), gpio_pin(A6_RW_PORT, A6_RW_PIN), 0);
-    web_server_setRestApi(rest_api_exec);
+    rest_api_init();
     web_server_setRootFS(&file_list);
 
     // ax12
@@ -13,34 +13,37 @@ void write_header_json(char *buffer)
     http_write_header_end(buffer);
 }
 
-void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer)
+void rest_status(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
 {
     JsonBuffer json;
     write_header_json(buffer);
     json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
 
-    if (strcmp(restUrl, "status") == 0)
-    {
-        if (querry_type==HTTP_QUERRY_TYPE_GET)
-        {
-            id++;
-            json_open_object(&json);
-            json_add_field_int(&json, "batteryLevel", id);
-            json_close_object(&json);
-        }
-    }
-    else if (strcmp(restUrl, "tof") == 0)
-    {
-        if (querry_type == HTTP_QUERRY_TYPE_GET)
-        {
-            json_open_object(&json);
-            //json_add_field_int(&json, "tof1", VL6180X_getDistance(board_i2c_tof(), TOF1_ADDR));
-            json_close_object(&json);
-        }
-    }
-    else
-    {
-        http_write_header_code(buffer, HTTP_NOT_FOUND);
-        http_write_header_end(buffer);
-    }
+    id++;
+    json_open_object(&json);
+    json_add_field_int(&json, "batteryLevel", id);
+    json_close_object(&json);
+}
+
+void rest_tof(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    JsonBuffer json;
+    write_header_json(buffer);
+    json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
+
+    json_open_object(&json);
+    //json_add_field_int(&json, "tof1", VL6180X_getDistance(board_i2c_tof(), TOF1_ADDR));
+    json_close_object(&json);
+}
+
+const RestRoute rest_api_routes[] = {
+    {HTTP_QUERRY_TYPE_GET, "status", rest_status},
+    {HTTP_QUERRY_TYPE_GET, "tof", rest_tof}
+};
+
+void rest_api_init()
+{
+    rest_init();
+    rest_addRoutes(rest_api_routes, sizeof(rest_api_routes) / sizeof(rest_api_routes[0]));
+    web_server_setRestApi(rest_exec);
 }
@@ -6,7 +6,7 @@
 #include "archi.h"
 #include "board.h"
 
-extern void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer);
+extern void rest_api_init();
 extern const Fs_FilesList file_list;
 
 int main(void)
@@ -15,15 +15,22 @@ int main(void)
     unsigned int i;
 #endif
     rt_dev_t uartDbg;
+    rt_dev_t timer;
 
     sysclock_setClock(120000000);
     board_init();
 
     // warning keep this init order before remap support
     network_init();
-    web_server_setRestApi(rest_api_exec);
+    rest_api_init();
     web_server_setRootFS(&file_list);
 
+    // time base of web server idle connections
+    timer = timer_getFreeDevice();
+    timer_setPeriodMs(timer, WEB_SERVER_TICK_MS);
+    timer_setHandler(timer, web_server_tick);
+    timer_enable(timer);
+
     // uart debug init
     uartDbg = uart_getFreeDevice();
     uart_setBaudSpeed(uartDbg, 115200);
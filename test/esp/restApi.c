@@ -5,6 +5,79 @@
 #include <module/network.h>
 
 int id = 0;
+int live_id = 0;
+
+#define TELEMETRY_SAMPLES 200
+
+typedef struct
+{
+    JsonWriter json;
+    uint16_t sample;
+} Telemetry;
+Telemetry telemetry[ESP8266_LINK_COUNT];   // streams of each link
+
+// telemetry document larger than the RAM buffers, written by parts in the
+// buffer of the web server stream
+uint16_t telemetry_stream(char *buffer, uint16_t size, void *arg)
+{
+    Telemetry *t = (Telemetry *)arg;
+
+    json_writer_setBuffer(&t->json, buffer, size);
+    if (t->sample == 0)
+    {
+        json_writer_open_object(&t->json, NULL);
+        json_writer_open_array(&t->json, "samples");
+    }
+    while (t->sample < TELEMETRY_SAMPLES && json_writer_free(&t->json) >= 48)
+    {
+        json_writer_open_object(&t->json, NULL);
+        json_writer_int(&t->json, "t", t->sample);
+        json_writer_fixed(&t->json, "battery", 3700 - t->sample, 3);
+        json_writer_bool(&t->json, "led", board_getLed(0));
+        json_writer_close_object(&t->json);
+        t->sample++;
+    }
+    if (t->sample == TELEMETRY_SAMPLES && json_writer_free(&t->json) >= 2)
+    {
+        json_writer_close_array(&t->json);
+        json_writer_close_object(&t->json);
+        t->sample++;
+    }
+    return json_writer_size(&t->json);
+}
+
+// live telemetry pushed to the WebSocket clients, one sample per frame
+uint16_t telemetry_live(char *buffer, uint16_t size, void *arg)
+{
+    JsonWriter json;
+
+    json_writer_init(&json, buffer, size, NULL, NULL);
+    json_writer_open_object(&json, NULL);
+    json_writer_int(&json, "t", live_id++);
+    json_writer_fixed(&json, "battery", 3700, 3);
+    json_writer_bool(&json, "led", board_getLed(0));
+    json_writer_close_object(&json);
+    if (json.error < 0)
+        return 0;
+    return json_writer_size(&json);
+}
+
+// "on" and "off" text messages set the led
+void telemetry_receive(uint8_t sock, uint8_t opcode, const char *data, uint16_t size)
+{
+    int8_t led;
+
+    if (opcode != WEBSOCKET_OPCODE_TEXT)
+        return;
+    if (size == 2 && strncmp(data, "on", 2) == 0)
+        led = 1;
+    else if (size == 3 && strncmp(data, "off", 3) == 0)
+        led = 0;
+    else
+        return;
+    if (board_getLed(0) != led)
+        board_toggleLed(0);
+}
 
 void write_header_json(char *buffer)
 {
@@ -13,39 +86,77 @@ void write_header_json(char *buffer)
     http_write_header_end(buffer);
 }
 
-void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer)
+void rest_status(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
 {
     JsonBuffer json;
     write_header_json(buffer);
     json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
 
-    if (strcmp(restUrl, "status") == 0)
-    {
-        if (querry_type==HTTP_QUERRY_TYPE_GET)
-        {
-            id++;
-            json_open_object(&json);
-            json_add_field_int(&json, "batteryLevel", id);
-            json_close_object(&json);
-        }
-    }
-    else if (strcmp(restUrl, "led") == 0)
+    id++;
+    json_open_object(&json);
+    json_add_field_int(&json, "batteryLevel", id);
+    json_close_object(&json);
+}
+
+// led/{id}, led 0 for led
+void rest_led(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    JsonBuffer json;
+    int32_t led = 0;
+    int8_t status = -1;
+
+    if (rest_param(params, "id") != NULL && rest_param_int(params, "id", &led) < 0)
     {
-        if (querry_type == HTTP_QUERRY_TYPE_POST)
-        {
-            http_write_header_code(buffer, HTTP_OK);
-
-        }
-        else if (querry_type == HTTP_QUERRY_TYPE_GET)
-        {
-            json_open_object(&json);
-            json_add_field_int(&json, "ledStatus", board_getLed(0));
-            json_close_object(&json);
-        }
+        http_write_header_code(buffer, HTTP_BAD_REQUEST);
+        http_write_header_end(buffer);
+        return;
     }
-    else
+    if (led >= 0 && led <= UINT8_MAX)
+        status = board_getLed(led);
+    if (status < 0)
     {
-        http_write_header_code(buffer, HTTP_NOT_FOUND);
+        http_write_header_code(buffer, HTTP_NOT_FOUND);    // no such led on the board
         http_write_header_end(buffer);
+        return;
     }
+    write_header_json(buffer);
+    json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
+
+    json_open_object(&json);
+    json_add_field_int(&json, "ledStatus", status);
+    json_close_object(&json);
+}
+
+void rest_ledSet(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    http_write_header_code(buffer, HTTP_OK);
+    http_write_header_end(buffer);
+}
+
+void rest_telemetry(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    Telemetry *t = &telemetry[web_server_currentSocket()];
+
+    write_header_json(buffer);
+    json_writer_init(&t->json, NULL, 0, NULL, NULL);
+    t->sample = 0;
+    web_server_stream(telemetry_stream, t);
+}
+
+const RestRoute rest_api_routes[] = {
+    {HTTP_QUERRY_TYPE_GET, "status", rest_status},
+    {HTTP_QUERRY_TYPE_GET, "led", rest_led},
+    {HTTP_QUERRY_TYPE_POST, "led", rest_ledSet},
+    {HTTP_QUERRY_TYPE_GET, "led/{id}", rest_led},
+    {HTTP_QUERRY_TYPE_GET, "telemetry", rest_telemetry}
+};
+
+void rest_api_init()
+{
+    rest_init();
+    rest_addRoutes(rest_api_routes, sizeof(rest_api_routes) / sizeof(rest_api_routes[0]));
+    web_server_setRestApi(rest_exec);
+
+    web_server_setWebSocket("/ws", telemetry_receive);
+    web_server_setPublisher(WEBSOCKET_OPCODE_TEXT, telemetry_live, NULL, 200);
 }
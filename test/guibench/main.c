@@ -0,0 +1,263 @@
+/**
+ * GUI rendering benchmark, runs a fixed set of scenes through the gui module
+ * on the simulator backend and reports controller accesses per primitive.
+ *
+ * Build and run with `make sim-exe && cd build && ./guibench_sim`. The
+ * controller call trace of the first iteration of each scene is written to
+ * guibench.trace, the final screen to guibench.ppm.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "modules.h"
+#include "board.h"
+#include "archi.h"
+
+#include "gui/console.h"
+#include "gui/sprite.h"
+#include "gui/widget.h"
+#include "gui/sim.h"
+#include "fonts.h"
+
+#ifndef SIMULATOR
+ #error guibench needs the simulator controller backend, use make sim-exe
+#endif
+
+#include <time.h>
+
+#define IMAGE_SIZE 64
+#define TRACE_FILE "guibench.trace"
+
+typedef struct
+{
+    const char *name;
+    void (*setup)(void);
+    void (*draw)(uint16_t i);
+    uint16_t count;
+} Scene;
+
+uint16_t imageRaw[IMAGE_SIZE * IMAGE_SIZE];
+uint16_t imageRle[IMAGE_SIZE * IMAGE_SIZE * 2];
+uint8_t imageIndexed[IMAGE_SIZE * IMAGE_SIZE / 2];
+uint16_t imagePalette[16];
+uint16_t imageSprite[IMAGE_SIZE * IMAGE_SIZE];
+Picture pictureRaw, pictureRle, pictureIndexed, pictureSprite;
+
+uint16_t spriteSave[IMAGE_SIZE * IMAGE_SIZE];
+Sprite sprite;
+Console console;
+Widget *labels[8];
+Widget *bars[8];
+
+const char paragraph[] = "The quick brown fox jumps over the lazy dog. "
+                         "Pack my box with five dozen liquor jugs.";
+
+/**
+ * pictures are generated in RAM, encoded like img2raw would do
+ */
+void buildPictures(void)
+{
+    uint16_t x, y, i, n, j;
+    int16_t dx, dy;
+
+    for (x = 0; x < IMAGE_SIZE; x++)
+    {
+        for (y = 0; y < IMAGE_SIZE; y++)
+        {
+            i = x * IMAGE_SIZE + y;
+            // flat bands with a gradient stripe, typical of UI artwork
+            imageRaw[i] = ((y / 16) & 1) ? gui_rgb(x * 4, 0, 255 - x * 4) : Gui_Gray3;
+            dx = x - IMAGE_SIZE / 2;
+            dy = y - IMAGE_SIZE / 2;
+            imageSprite[i] = (dx * dx + dy * dy < 28 * 28) ? gui_rgb(255, y * 4, 0) : Gui_Magenta;
+        }
+    }
+
+    // rle
+    n = 0;
+    for (i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i = j)
+    {
+        for (j = i + 1; j < IMAGE_SIZE * IMAGE_SIZE && imageRaw[j] == imageRaw[i]; j++)
+            ;
+        if (j - i > 1)
+        {
+            imageRle[n++] = PICTURE_RLE_RUN | (j - i - 1);
+            imageRle[n++] = imageRaw[i];
+        }
+        else
+        {
+            imageRle[n++] = 0;
+            imageRle[n++] = imageRaw[i];
+        }
+    }
+
+    // 16 colors indexed
+    for (i = 0; i < 16; i++)
+        imagePalette[i] = gui_rgb(i * 16, 255 - i * 16, 128);
+    for (i = 0; i < IMAGE_SIZE * IMAGE_SIZE; i++)
+        imageIndexed[i / 2] |= ((i / IMAGE_SIZE) & 0x0F) << ((i & 1) * 4);
+
+    pictureRaw = (Picture){IMAGE_SIZE, IMAGE_SIZE, imageRaw, PictureFormatRaw565};
+    pictureRle = (Picture){IMAGE_SIZE, IMAGE_SIZE, imageRle, PictureFormatRle565};
+    pictureIndexed = (Picture){IMAGE_SIZE, IMAGE_SIZE, (const uint16_t *)imageIndexed, PictureFormatIndexed4, imagePalette};
+    pictureSprite = (Picture){IMAGE_SIZE, IMAGE_SIZE, imageSprite, PictureFormatRaw565, 0, PictureTransparencyKey, Gui_Magenta};
+}
+
+void setupClear(void)
+{
+    gui_setPenColor(Gui_White);
+    gui_setBrushColor(Gui_Black);
+    gui_fillScreen(Gui_Black);
+}
+
+void setupWidgets(void)
+{
+    uint8_t i;
+    Widget *panel;
+
+    setupClear();
+    widget_init();
+    widget_setBackground(Gui_Black);
+    gui_setFont(&Lucida_Console10);
+    panel = widget_addPanel(NULL, 20, 20, 440, 280);
+    for (i = 0; i < 8; i++)
+    {
+        labels[i] = widget_addLabel(panel, 10, 10 + i * 32, 120, 24, "0");
+        bars[i] = widget_addBarGraph(panel, 140, 10 + i * 32, 280, 24, 0, 100);
+    }
+    widget_update();
+}
+
+void setupConsole(void)
+{
+    setupClear();
+    gui_setFont(&Lucida_Console10);
+    console_init(&console, 0, 0, 480, 320, &Lucida_Console10);
+}
+
+void setupSprite(void)
+{
+    setupClear();
+    gui_dispImage(100, 100, &pictureRaw);
+    sprite_init(&sprite, &pictureSprite, spriteSave);
+}
+
+// scenes
+void drawFillScreen(uint16_t i)  { gui_fillScreen(i); }
+void drawFillRect(uint16_t i)    { gui_drawFillRect((i * 37) % 440, (i * 53) % 280, 32, 32); }
+void drawRect(uint16_t i)        { gui_drawRect((i * 37) % 380, (i * 53) % 220, 96, 96); }
+void drawHLine(uint16_t i)       { gui_drawLine(0, i % 320, 479, i % 320); }
+void drawVLine(uint16_t i)       { gui_drawLine(i % 480, 0, i % 480, 319); }
+void drawLine(uint16_t i)        { gui_drawLine((i * 37) % 480, 0, (i * 91) % 480, 319); }
+void drawFillCircle(uint16_t i)  { gui_drawFillCircle(240, 160, 20 + (i & 63)); }
+void drawText(uint16_t i)        { gui_setFont(&Lucida_Console10); gui_drawText(10, (i * 13) % 300, "Hello uDevkit 0123456789"); }
+void drawTextRect(uint16_t i)    { gui_setFont(&Lucida_Console10); gui_drawTextRect(40, 40, 400, 240, paragraph, GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP); }
+void drawImageRaw(uint16_t i)    { gui_dispImage((i * 37) % 416, (i * 53) % 256, &pictureRaw); }
+void drawImageRle(uint16_t i)    { gui_dispImage((i * 37) % 416, (i * 53) % 256, &pictureRle); }
+void drawImageIndexed(uint16_t i){ gui_dispImage((i * 37) % 416, (i * 53) % 256, &pictureIndexed); }
+
+void drawImageClipped(uint16_t i)
+{
+    gui_pushClipRect(100, 100, 40, 40);
+    gui_dispImage(80 + (i & 31), 80 + (i & 31), &pictureRaw);
+    gui_popClipRect();
+}
+
+void drawSprite(uint16_t i)      { sprite_show(&sprite, 60 + (i % 200), 80 + (i % 100)); }
+
+void drawWidgets(uint16_t i)
+{
+    char text[8];
+
+    sprintf(text, "%d", i % 100);
+    widget_setText(labels[i & 7], text);
+    widget_setValue(bars[i & 7], (i * 7) % 100);
+    widget_update();
+}
+
+void drawConsole(uint16_t i)
+{
+    char text[32];
+
+    sprintf(text, "line %d of the bench\n", i);
+    console_write(&console, text);
+}
+
+const Scene scenes[] = {
+    {"fill screen",    setupClear,   drawFillScreen,   200},
+    {"fill rect 32",   setupClear,   drawFillRect,     5000},
+    {"rect 96",        setupClear,   drawRect,         5000},
+    {"hline",          setupClear,   drawHLine,        5000},
+    {"vline",          setupClear,   drawVLine,        5000},
+    {"line",           setupClear,   drawLine,         5000},
+    {"fill circle",    setupClear,   drawFillCircle,   2000},
+    {"text",           setupClear,   drawText,         2000},
+    {"text rect",      setupClear,   drawTextRect,     500},
+    {"image raw",      setupClear,   drawImageRaw,     2000},
+    {"image rle",      setupClear,   drawImageRle,     2000},
+    {"image indexed",  setupClear,   drawImageIndexed, 2000},
+    {"image clipped",  setupClear,   drawImageClipped, 2000},
+    {"sprite move",    setupSprite,  drawSprite,       2000},
+    {"widget update",  setupWidgets, drawWidgets,      2000},
+    {"console write",  setupConsole, drawConsole,      2000},
+};
+
+void runScene(const Scene *scene)
+{
+    const GuiSimStats *stats = gui_sim_stats();
+    FILE *trace;
+    clock_t start;
+    double seconds;
+    uint16_t i;
+
+    scene->setup();
+
+    // trace of one iteration, not timed
+    trace = fopen(TRACE_FILE, "a");
+    if (trace != NULL)
+    {
+        fprintf(trace, "# %s\n", scene->name);
+        fclose(trace);
+    }
+    gui_sim_record(TRACE_FILE);
+    scene->draw(0);
+    gui_sim_record(NULL);
+
+    gui_sim_resetStats();
+    start = clock();
+    for (i = 0; i < scene->count; i++)
+        scene->draw(i);
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0)
+        seconds = 1e-9;
+
+    printf("%-16s %6u %10.1f %10.1f %10.1f %10.0f %10.2f\n", scene->name, scene->count,
+           (double)(stats->setRect + stats->setPos + stats->writes + stats->reads + stats->scrolls) / scene->count,
+           (double)stats->bytes / scene->count,
+           (double)stats->pixels / scene->count,
+           scene->count / seconds,
+           stats->pixels / seconds / 1e6);
+}
+
+int main(void)
+{
+    uint8_t i;
+
+    board_init();
+
+    gui_init(0);
+    gui_sim_setHeadless(1);
+    // the bus of the main HMI display, console and sprites use their fallbacks
+    gui_sim_setModel(GuiSimD51e5ta7601);
+    buildPictures();
+    remove(TRACE_FILE);
+
+    printf("%-16s %6s %10s %10s %10s %10s %10s\n", "scene", "count", "calls/op", "bytes/op", "pixels/op", "ops/s", "Mpixels/s");
+    for (i = 0; i < sizeof(scenes) / sizeof(Scene); i++)
+        runScene(&scenes[i]);
+
+    gui_sim_saveImage("guibench.ppm");
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Shapes rendering test. On the simulator the shapes are compared to the
+ * reference image guishapes_ref.ppm and timed.
+ *
+ * Build and run with `make sim-exe && cd build && ./guishapes_sim`, it
+ * returns 1 if the rendering differs from the reference. The screen is
+ * written to guishapes.ppm, copy it over the reference after an intended
+ * rendering change.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "modules.h"
+#include "board.h"
+#include "archi.h"
+
+#ifdef SIMULATOR
+ #include <time.h>
+ #include "gui/sim.h"
+
+ #define REFERENCE_FILE "../guishapes_ref.ppm"
+#endif
+
+const GuiVertex star[] = {
+    {400, 180}, {412, 216}, {450, 216}, {420, 238}, {431, 274},
+    {400, 252}, {369, 274}, {380, 238}, {350, 216}, {388, 216}
+};
+
+const GuiVertex arrow[] = {
+    {250, 200}, {310, 240}, {250, 280}, {265, 240}
+};
+
+// one point more than GUI_POLYGON_MAX_POINTS, rejected by gui_drawFillPolygon
+const GuiVertex gear[] = {
+    {100, 250}, {110, 255}, {120, 250}, {125, 260}, {120, 270}, {125, 280},
+    {120, 290}, {110, 285}, {100, 290}, {90, 285},  {80, 290},  {75, 280},
+    {80, 270},  {75, 260},  {80, 250},  {90, 255},  {95, 245}
+};
+
+void drawShapes(void)
+{
+    gui_fillScreen(Gui_Black);
+
+    gui_setPenColor(Gui_White);
+    gui_setBrushColor(Gui_Blue);
+    gui_drawFillCircle(60, 60, 45);
+    gui_drawCircle(60, 60, 50);
+
+    gui_setBrushColor(Gui_Green);
+    gui_drawFillEllipse(180, 60, 60, 30);
+    gui_drawEllipse(180, 60, 66, 36);
+
+    gui_setBrushColor(Gui_Red);
+    gui_drawFillArc(320, 60, 20, 45, 30, 300);
+    gui_drawArc(320, 60, 50, -45, 225);
+
+    gui_setBrushColor(Gui_Yellow);
+    gui_drawFillRoundRect(10, 140, 200, 50, 12);
+    gui_drawRoundRect(5, 135, 210, 60, 16);
+
+    gui_setBrushColor(Gui_Cyan);
+    gui_drawFillPolygon(star, 10);
+    gui_drawPolygon(star, 10);
+    gui_setBrushColor(Gui_Magenta);
+    gui_drawFillPolygon(arrow, 4);
+    gui_drawFillPolygon(gear, sizeof(gear) / sizeof(GuiVertex));
+}
+
+#ifdef SIMULATOR
+void bench(const char *name, void (*draw)(uint16_t i), uint16_t count)
+{
+    clock_t start;
+    double seconds;
+    uint16_t i;
+
+    start = clock();
+    for (i = 0; i < count; i++)
+        draw(i);
+    seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    printf("%-16s %8.0f shapes/s\n", name, count / seconds);
+}
+
+void benchCircle(uint16_t i)     { gui_drawCircle(240, 160, 20 + (i & 63)); }
+void benchFillCircle(uint16_t i) { gui_drawFillCircle(240, 160, 20 + (i & 63)); }
+void benchEllipse(uint16_t i)    { gui_drawFillEllipse(240, 160, 100, 20 + (i & 63)); }
+void benchArc(uint16_t i)        { gui_drawFillArc(240, 160, 40, 80, i % 360, i % 360 + 120); }
+void benchRoundRect(uint16_t i)  { gui_drawFillRoundRect(100, 100, 200, 100, i & 31); }
+void benchPolygon(uint16_t i)    { gui_drawFillPolygon(star, 10); }
+#endif
+
+int main(void)
+{
+#ifdef SIMULATOR
+    int diff;
+#endif
+
+    board_init();
+
+    gui_init(0);
+    drawShapes();
+
+#ifdef SIMULATOR
+    gui_sim_saveImage("guishapes.ppm");
+    diff = gui_sim_compareImage(REFERENCE_FILE);
+    if (diff < 0)
+    {
+        printf("cannot read %s\n", REFERENCE_FILE);
+        return 1;
+    }
+    if (diff > 0)
+    {
+        printf("%d pixels differ from %s\n", diff, REFERENCE_FILE);
+        return 1;
+    }
+    if (gui_drawFillPolygon(gear, sizeof(gear) / sizeof(GuiVertex)) != -1)
+    {
+        printf("polygon of %d points not rejected\n", (int)(sizeof(gear) / sizeof(GuiVertex)));
+        return 1;
+    }
+    printf("shapes match %s\n", REFERENCE_FILE);
+
+    bench("circle", benchCircle, 2000);
+    bench("fill circle", benchFillCircle, 2000);
+    bench("fill ellipse", benchEllipse, 2000);
+    bench("fill arc", benchArc, 2000);
+    bench("fill round rect", benchRoundRect, 2000);
+    bench("fill polygon", benchPolygon, 2000);
+    drawShapes();
+    return 0;
+#endif
+
+    while (1)
+    {
+    }
+
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * GUI module checks on the simulator backend, console scrolling and sprite
+ * background restore with and without the controller scroll and read back.
+ *
+ * Build and run with `make sim-exe && cd build && ./guitest_sim`, it returns
+ * 1 if a check fails.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "modules.h"
+#include "board.h"
+#include "archi.h"
+
+#include "gui/console.h"
+#include "gui/sprite.h"
+#include "gui/sim.h"
+#include "fonts.h"
+
+#ifndef SIMULATOR
+ #error guitest needs the simulator controller backend, use make sim-exe
+#endif
+
+#define CONSOLE_X 10
+#define CONSOLE_Y 20
+#define CONSOLE_W 200
+#define CONSOLE_ROWS 6
+#define FONT_MAX_HEIGHT 32
+
+#define BACKGROUND_X 100
+#define BACKGROUND_Y 150
+#define BACKGROUND_SIZE 64
+#define SPRITE_SIZE 24
+
+Console console;
+char consoleText[3 * CONSOLE_ROWS][16];
+// pixels of the console rect, or of the sprite checks area
+uint16_t screen[CONSOLE_W * CONSOLE_ROWS * FONT_MAX_HEIGHT];
+uint16_t expected[CONSOLE_W * CONSOLE_ROWS * FONT_MAX_HEIGHT];
+
+uint16_t backgroundRaw[BACKGROUND_SIZE * BACKGROUND_SIZE];
+uint16_t spriteRaw[SPRITE_SIZE * SPRITE_SIZE];
+uint16_t spriteSave[SPRITE_SIZE * SPRITE_SIZE];
+Picture background, spritePicture;
+Sprite sprite;
+
+int failures = 0;
+
+void check(int ok, const char *name)
+{
+    printf("%-40s %s\n", name, ok ? "ok" : "FAILED");
+    if (!ok)
+        failures++;
+}
+
+/**
+ * lines of different lengths, they differ whatever the font glyphs are
+ */
+void buildConsoleText(void)
+{
+    uint8_t i, len;
+
+    for (i = 0; i < 3 * CONSOLE_ROWS; i++)
+    {
+        len = sprintf(consoleText[i], "%d ", i);
+        memset(consoleText[i] + len, '#', i % 7);
+        strcpy(consoleText[i] + len + i % 7, "\n");
+    }
+}
+
+/**
+ * compares the console rect to its last lines drawn by gui_drawTextRect, row
+ * by row from the visible origin of the console
+ */
+uint8_t consoleMatches(uint8_t lines)
+{
+    uint16_t height = console.font->height, h = CONSOLE_ROWS * height;
+    uint8_t row, screenRow;
+    char text[16];
+
+    if (height > FONT_MAX_HEIGHT)
+        return 0;
+    gui_readRect(CONSOLE_X, CONSOLE_Y, CONSOLE_W, h, screen);
+
+    gui_setFont(console.font);
+    gui_setPenColor(console.fgColor);
+    gui_setBrushColor(console.bgColor);
+    gui_drawFillRect(CONSOLE_X, CONSOLE_Y, CONSOLE_W, h);
+    for (row = 0; row < CONSOLE_ROWS; row++)
+    {
+        // last row is the empty line started by the last '\n'
+        text[0] = '\0';
+        if (row + 1 < CONSOLE_ROWS)
+            strcpy(text, consoleText[lines - CONSOLE_ROWS + 1 + row]);
+        text[strcspn(text, "\n")] = '\0';
+        screenRow = (console.origin + row) % CONSOLE_ROWS;
+        gui_drawTextRect(CONSOLE_X, CONSOLE_Y + screenRow * height, CONSOLE_W, height, text, GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
+    }
+    gui_readRect(CONSOLE_X, CONSOLE_Y, CONSOLE_W, h, expected);
+
+    return memcmp(screen, expected, (uint32_t)CONSOLE_W * h * sizeof(uint16_t)) == 0;
+}
+
+void checkConsole(GuiSimModel model)
+{
+    const GuiSimStats *stats = gui_sim_stats();
+    uint32_t rowPixels;
+    uint8_t i;
+
+    gui_fillScreen(Gui_Black);
+    gui_setPenColor(Gui_White);
+    gui_setBrushColor(Gui_Blue);
+    console_init(&console, CONSOLE_X, CONSOLE_Y, CONSOLE_W, CONSOLE_ROWS * Lucida_Console10.height, &Lucida_Console10);
+    rowPixels = (uint32_t)CONSOLE_W * console.font->height;
+
+    gui_sim_setModel(model);
+    for (i = 0; i < 3 * CONSOLE_ROWS - 1; i++)
+        console_write(&console, consoleText[i]);
+
+    // full console, a new line only draws the rows it changes
+    gui_sim_resetStats();
+    console_write(&console, consoleText[i]);
+    if (model == GuiSimMirror)
+    {
+        check(stats->scrolls == 1, "console scroll: one controller scroll");
+        check(stats->pixels <= 2 * rowPixels, "console scroll: two rows drawn");
+    }
+    else
+    {
+        check(stats->scrolls == 0, "console roll: no controller scroll");
+        check(stats->pixels <= 2 * rowPixels, "console roll: two rows drawn");
+        check(console.origin != 0, "console roll: origin moved");
+    }
+
+    gui_sim_setModel(GuiSimMirror);
+    check(consoleMatches(3 * CONSOLE_ROWS), (model == GuiSimMirror) ? "console scroll: last lines shown" : "console roll: last lines shown");
+}
+
+/**
+ * gradient background and a colour-keyed disc, generated in RAM
+ */
+void buildPictures(void)
+{
+    uint16_t x, y;
+    int16_t dx, dy;
+
+    for (x = 0; x < BACKGROUND_SIZE; x++)
+        for (y = 0; y < BACKGROUND_SIZE; y++)
+            backgroundRaw[x * BACKGROUND_SIZE + y] = gui_rgb(x * 4, y * 4, 128);
+    for (x = 0; x < SPRITE_SIZE; x++)
+    {
+        for (y = 0; y < SPRITE_SIZE; y++)
+        {
+            dx = x - SPRITE_SIZE / 2;
+            dy = y - SPRITE_SIZE / 2;
+            spriteRaw[x * SPRITE_SIZE + y] = (dx * dx + dy * dy < 10 * 10) ? Gui_Red : Gui_Magenta;
+        }
+    }
+    background = (Picture){BACKGROUND_SIZE, BACKGROUND_SIZE, backgroundRaw, PictureFormatRaw565};
+    spritePicture = (Picture){SPRITE_SIZE, SPRITE_SIZE, spriteRaw, PictureFormatRaw565, 0, PictureTransparencyKey, Gui_Magenta};
+}
+
+/**
+ * moves a keyed sprite over the background picture, then compares the
+ * background area to the background and the sprite painted directly
+ */
+void checkSprite(GuiSimModel model, uint8_t fullClipStack, const char *name)
+{
+    uint16_t w = BACKGROUND_SIZE + SPRITE_SIZE, h = BACKGROUND_SIZE + SPRITE_SIZE;
+    uint16_t x = BACKGROUND_X - SPRITE_SIZE / 2, y = BACKGROUND_Y - SPRITE_SIZE / 2;
+    uint8_t i;
+
+    gui_sim_setModel(model);
+    gui_fillScreen(Gui_Black);
+    gui_dispImage(BACKGROUND_X, BACKGROUND_Y, &background);
+    sprite_init(&sprite, &spritePicture, spriteSave);
+    sprite_setBackground(&sprite, &background, BACKGROUND_X, BACKGROUND_Y);
+    sprite_show(&sprite, BACKGROUND_X + 5, BACKGROUND_Y + 7);
+
+    // sprite_restore cannot push its clip rect
+    if (fullClipStack)
+        for (i = 0; i < GUI_CLIP_STACK_SIZE; i++)
+            gui_pushClipRect(0, 0, gui_screenWidth(), gui_screenHeight());
+    sprite_show(&sprite, BACKGROUND_X + 20, BACKGROUND_Y + 13);
+    sprite_show(&sprite, BACKGROUND_X + 30, BACKGROUND_Y + 40);
+    if (fullClipStack)
+        for (i = 0; i < GUI_CLIP_STACK_SIZE; i++)
+            gui_popClipRect();
+
+    gui_sim_setModel(GuiSimMirror);
+    gui_readRect(x, y, w, h, screen);
+
+    gui_fillScreen(Gui_Black);
+    gui_dispImage(BACKGROUND_X, BACKGROUND_Y, &background);
+    gui_dispImage(BACKGROUND_X + 30, BACKGROUND_Y + 40, &spritePicture);
+    gui_readRect(x, y, w, h, expected);
+
+    check(memcmp(screen, expected, (uint32_t)w * h * sizeof(uint16_t)) == 0, name);
+}
+
+int main(void)
+{
+    board_init();
+
+    gui_init(0);
+    gui_sim_setHeadless(1);
+
+    buildConsoleText();
+    checkConsole(GuiSimMirror);
+    checkConsole(GuiSimD51e5ta7601);
+
+    buildPictures();
+    checkSprite(GuiSimMirror, 0, "sprite: save-under restored");
+    checkSprite(GuiSimD51e5ta7601, 0, "sprite: background restored");
+    checkSprite(GuiSimD51e5ta7601, 1, "sprite: restored with full clip stack");
+
+    printf("%d check(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -6,7 +6,7 @@
 #include <stdint.h>
 
 #include "pictures.h"
-#include "console.h"
+#include "gui/console.h"
 #include "fonts.h"
 
 #define BARCOLOR 0x2965
@@ -148,7 +148,7 @@ int main(void)
         if(size > 0)
         {
             buff[size]=0;
-            console_write(&cmd, buff);
+            console_write(&console, buff);
             uart_write(uartDbg, buff, size);
             uart_write(uartDbg, "Type a word to add: ", 20);
         }*/
@@ -2,6 +2,7 @@
 
 #include "board.h"
 #include "module/gui.h"
+#include "gui/widget.h"
 #include "fonts.h"
 
 #include "module/network.h"
@@ -13,7 +14,7 @@ int ihm_count = 0;
 
 int ihm_d1, ihm_d2, ihm_d3;
 
-void ihm_screenClear();
+void ihm_screenShow(int8_t id);
 
 #define SCREEN_COUNT 4
 int8_t screen_id = 1;
@@ -23,22 +24,97 @@ void ihm_screenBatt();
 void ihm_screenCoder();
 void ihm_screenWifi();
 
+const char *ihm_titles[SCREEN_COUNT] = {
+    "<  swt2 : tof  >",
+    "< swt2 : battery >",
+    "< swt2 : coders >",
+    "< swt2 : wifi >"
+};
+
+// widgets, built once by ihm_init, screens are panels under the title
+Widget *ihm_title;
+Widget *ihm_screens[SCREEN_COUNT];
+Widget *ihm_tofText[3], *ihm_tofBar[3];
+Widget *ihm_battVoltage, *ihm_battGauge, *ihm_battPercent, *ihm_battCharge;
+Widget *ihm_coderState[4], *ihm_coderValue[2];
+Widget *ihm_wifiIp, *ihm_wifiMac;
+
 void ihm_init()
 {
+    int i;
+    Widget *frame, *screen;
+
     gui_init(board_i2c_ihm());
     gui_setFont(&Lucida_Console10);
     gui_setBrushColor(0);
     gui_setPenColor(1);
 
-    ihm_screenClear();
+    widget_init();
+    widget_setBackground(0);
+
+    frame = widget_addPanel(NULL, 0, 0, 128, 64);
+    widget_setFlag(frame, WIDGET_FLAG_BORDER, 1);
+    ihm_title = widget_addLabel(frame, 1, 1, 126, 14, "");
+    gui_setBrushColor(1);
+    widget_addPanel(frame, 0, 15, 128, 1);
+    gui_setBrushColor(0);
+
+    for (i = 0; i < SCREEN_COUNT; i++)
+        ihm_screens[i] = widget_addPanel(frame, 1, 16, 126, 47);
+
+    // tof
+    screen = ihm_screens[0];
+    for (i = 0; i < 3; i++)
+    {
+        ihm_tofText[i] = widget_addLabel(screen, i * 42, 34, 42, 13, "");
+        widget_setTextAlign(ihm_tofText[i], GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HTOP);
+        ihm_tofBar[i] = widget_addBarGraph(screen, 21 + i * 42, 3, 2, 30, 0, 240);
+    }
+
+    // battery
+    screen = ihm_screens[1];
+    ihm_battVoltage = widget_addLabel(screen, 4, 6, 118, 15, "");
+    ihm_battGauge = widget_addBarGraph(screen, 32, 26, 27, 13, 0, 100);
+    widget_setFlag(ihm_battGauge, WIDGET_FLAG_BORDER, 1);
+    gui_setBrushColor(1);
+    widget_addPanel(screen, 59, 29, 2, 5);
+    gui_setBrushColor(0);
+    ihm_battPercent = widget_addLabel(screen, 67, 26, 55, 14, "");
+    widget_setTextAlign(ihm_battPercent, GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
+    ihm_battCharge = widget_addLabel(screen, 2, 26, 30, 14, "");
+    widget_setTextAlign(ihm_battCharge, GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
+
+    // coders, left then right
+    screen = ihm_screens[2];
+    gui_setBrushColor(1);
+    widget_addPanel(screen, 62, 0, 1, 47);
+    gui_setBrushColor(0);
+    widget_addLabel(screen, 0, 2, 62, 14, "left");
+    widget_addLabel(screen, 63, 2, 62, 14, "right");
+    for (i = 0; i < 4; i++)
+    {
+        ihm_coderState[i] = widget_addBarGraph(screen, 14 + (i / 2) * 63 + (i % 2) * 20, 17, 10, 10, 0, 1);
+        widget_setFlag(ihm_coderState[i], WIDGET_FLAG_BORDER, 1);
+    }
+    ihm_coderValue[0] = widget_addLabel(screen, 1, 32, 60, 14, "");
+    ihm_coderValue[1] = widget_addLabel(screen, 63, 32, 48, 14, "");
+
+    // wifi
+    screen = ihm_screens[3];
+    ihm_wifiIp = widget_addLabel(screen, 4, 2, 118, 14, "");
+    ihm_wifiMac = widget_addLabel(screen, 4, 20, 118, 14, "");
+
+    ihm_screenShow(screen_id);
+    widget_update();
+    gui_ctrl_update();
 }
 
-void ihm_screenClear()
+void ihm_screenShow(int8_t id)
 {
-    gui_drawFillRect(0, 0, 127, 63);
-    gui_drawRect(0, 0, 127, 63);
-    gui_drawLine(0, 15, 127, 15);
-    gui_ctrl_update();
+    int8_t i;
+    for (i = 0; i < SCREEN_COUNT; i++)
+        widget_setVisible(ihm_screens[i], i == id);
+    widget_setText(ihm_title, ihm_titles[id]);
 }
 
 void ihm_task()
@@ -58,19 +134,14 @@ void ihm_task()
         // one button pressed
         //board_buzz(400);
         if (btn == 1)
-        {
             screen_id++;
-            ihm_screenClear();
-        }
         if (btn == 2)
-        {
             screen_id--;
-            ihm_screenClear();
-        }
         if (screen_id < 0)
             screen_id = SCREEN_COUNT - 1;
         if (screen_id >= SCREEN_COUNT)
             screen_id = 0;
+        ihm_screenShow(screen_id);
         screen_btn = btn;
     }
     else
@@ -86,7 +157,7 @@ void ihm_task()
         return;
     ihm_count = 0;
 
-    // call current ihm screen
+    // push values of current ihm screen
     switch (screen_id)
     {
     case 0:
@@ -102,119 +173,64 @@ void ihm_task()
         ihm_screenWifi();
         break;
     }
+
+    // only changed widgets are repainted, nothing sent if none changed
+    if (widget_update() != 0)
+        gui_ctrl_update();
 }
 
 void ihm_screenTof()
 {
     char text[60];
-    gui_drawTextRect(1, 1, 126, 14, "<  swt2 : tof  >", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    gui_setBrushColor(0);
-    sprintf(text, "%d", (int)ihm_d1);
-    gui_drawTextRect(1, 50, 42, 13, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HTOP);
-    gui_setBrushColor(0); gui_drawFillRect(22, 18, 2, 33); // clear bar
-    gui_setBrushColor(1); gui_drawFillRect(22, 19+30-ihm_d1/8, 2, ihm_d1/8);
+    int i, d[3] = {ihm_d1, ihm_d2, ihm_d3};
 
-    sprintf(text, "%d", (int)ihm_d2);
-    gui_setBrushColor(0);
-    gui_drawTextRect(43, 50, 42, 13, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HTOP);
-    gui_setBrushColor(0); gui_drawFillRect(40+24, 18, 2, 33); // clear bar
-    gui_setBrushColor(1); gui_drawFillRect(40+24, 19+30-ihm_d2/8, 2, ihm_d2/8);
-
-    sprintf(text, "%d", (int)ihm_d3);
-    gui_setBrushColor(0);
-    gui_drawTextRect(85, 50, 42, 13, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HTOP);
-    gui_setBrushColor(0); gui_drawFillRect(82+24, 18, 2, 33); // clear bar
-    gui_setBrushColor(1); gui_drawFillRect(82+24, 19+30-ihm_d3/8, 2, ihm_d3/8);
-
-    gui_setBrushColor(0);
-    gui_ctrl_update();
+    for (i = 0; i < 3; i++)
+    {
+        sprintf(text, "%d", d[i]);
+        widget_setText(ihm_tofText[i], text);
+        widget_setValue(ihm_tofBar[i], d[i]);
+    }
 }
 
 void ihm_screenBatt()
 {
     char text[60];
     float ihm_batt = board_getPowerVoltage();
-    gui_drawTextRect(1, 1, 126, 14, "< swt2 : battery >", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    sprintf(text, "voltage : %.2fv", ihm_batt);
-    gui_drawTextRect(5, 22, 118, 15, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    int i, x=33, y=42, percent=(ihm_batt-3.3)*100;
+    int percent=(ihm_batt-3.3)*100;
     if(percent > 100)
         percent = 100;
     if(percent < 0)
         percent = 0;
 
-    gui_setBrushColor(0);
-    gui_setPenColor(1);
-    gui_drawRect(x, y, 26, 12);
-    for (i=0; i<=percent/5; i++)
-    {
-        gui_drawLine(x+3+i,   y+4, x+3+i,   y+8);
-    }
-    gui_setPenColor(0);
-    for (; i<=20; i++)
-    {
-        gui_drawLine(x+3+i,   y+4, x+3+i,   y+8);
-    }
-
-    gui_setPenColor(1);
-    gui_drawLine(x+27, y+7, x+27, y+3);
-    gui_drawLine(x+28, y+7, x+28, y+3);
+    sprintf(text, "voltage : %.2fv", ihm_batt);
+    widget_setText(ihm_battVoltage, text);
 
+    widget_setValue(ihm_battGauge, percent);
     sprintf(text, "%d%%", percent);
-    gui_drawTextRect(x+35, y, 55, 14, text, GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
-
-    if (CHARGER_CHARGING == 0)
-        gui_drawTextRect(3, y, 30, 14, "chrg", GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
-    else
-        gui_drawTextRect(3, y, 30, 14, " ", GUI_FONT_ALIGN_VLEFT | GUI_FONT_ALIGN_HTOP);
+    widget_setText(ihm_battPercent, text);
 
-    gui_ctrl_update();
+    widget_setText(ihm_battCharge, (CHARGER_CHARGING == 0) ? "chrg" : "");
 }
 
 void ihm_screenCoder()
 {
     char text[60];
-    gui_drawTextRect(1, 1, 126, 14, "< swt2 : coders >", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-    gui_drawLine(63, 15, 63, 63);
 
     // left coder
-    gui_drawTextRect(1, 18, 62, 14, "left", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-    gui_setBrushColor(C2A);
-    gui_drawRect(20-5, 38-5, 9, 9);
-    gui_drawFillRect(20-3, 38-3, 6, 6);
-    gui_setBrushColor(C2B);
-    gui_drawRect(40-5, 38-5, 9, 9);
-    gui_drawFillRect(40-3, 38-3, 6, 6);
+    widget_setValue(ihm_coderState[0], C2A);
+    widget_setValue(ihm_coderState[1], C2B);
     sprintf(text, "%d", getC2());
-    gui_setBrushColor(0);
-    gui_drawTextRect(2, 48, 60, 14, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
+    widget_setText(ihm_coderValue[0], text);
 
     // right coder
-    gui_drawTextRect(64, 18, 62, 14, "right", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-    gui_setBrushColor(C1A);
-    gui_drawRect(63+20-5, 38-5, 9, 9);
-    gui_drawFillRect(63+20-3, 38-3, 6, 6);
-    gui_setBrushColor(C1B);
-    gui_drawRect(63+40-5, 38-5, 9, 9);
-    gui_drawFillRect(63+40-3, 38-3, 6, 6);
+    widget_setValue(ihm_coderState[2], C1A);
+    widget_setValue(ihm_coderState[3], C1B);
     sprintf(text, "%d", getC1());
-    gui_setBrushColor(0);
-    gui_drawTextRect(64, 48, 48, 14, text, GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    gui_ctrl_update();
+    widget_setText(ihm_coderValue[1], text);
 }
 
 void ihm_screenWifi()
 {
-    char text[60];
-    gui_drawTextRect(1, 1, 126, 14, "< swt2 : wifi >", GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    // ip
-    gui_drawTextRect(5, 18, 118, 14, esp8266_getIp(), GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-    gui_drawTextRect(5, 36, 118, 14, esp8266_getMac(), GUI_FONT_ALIGN_VMIDDLE | GUI_FONT_ALIGN_HMIDDLE);
-
-    gui_ctrl_update();
+    widget_setText(ihm_wifiIp, esp8266_getIp());
+    widget_setText(ihm_wifiMac, esp8266_getMac());
 }
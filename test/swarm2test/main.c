@@ -9,7 +9,7 @@
 #include "ihm.h"
 #include "motors.h"
 
-extern void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer);
+extern void rest_api_init();
 extern const Fs_FilesList file_list;
 
 extern int ihm_d1, ihm_d2, ihm_d3;
@@ -28,7 +28,7 @@ int main(void)
 
     // module init
     network_init();
-    web_server_setRestApi(rest_api_exec);
+    rest_api_init();
     web_server_setRootFS(&file_list);
 
     // screen test
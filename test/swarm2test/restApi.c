@@ -15,58 +15,72 @@ void write_header_json(char *buffer)
     http_write_header_end(buffer);
 }
 
-void rest_api_exec(char *restUrl, HTTP_QUERRY_TYPE querry_type, char *buffer)
+void rest_status(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
 {
     JsonBuffer json;
     write_header_json(buffer);
     json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
 
-    if (strcmp(restUrl, "status") == 0)
-    {
-        if (querry_type==HTTP_QUERRY_TYPE_GET)
-        {
-            id++;
-            json_open_object(&json);
-            json_add_field_int(&json, "batteryLevel", id);
-            json_close_object(&json);
-        }
-    }
-    else if (strcmp(restUrl, "tof") == 0)
-    {
-        if (querry_type == HTTP_QUERRY_TYPE_GET)
-        {
-            json_open_object(&json);
-            json_add_field_int(&json, "tof1", VL6180X_getDistance(board_i2c_tof(), TOF1_ADDR));
-            json_add_field_int(&json, "tof2", VL6180X_getDistance(board_i2c_tof(), TOF2_ADDR));
-            json_add_field_int(&json, "tof3", VL6180X_getDistance(board_i2c_tof(), TOF3_ADDR));
-            json_close_object(&json);
-        }
-    }
-    else if (strcmp(restUrl, "start60") == 0)
-    {
-        if (querry_type == HTTP_QUERRY_TYPE_POST)
-        {
-            motors_setSpeed(600);
-        }
-        else if (querry_type == HTTP_QUERRY_TYPE_GET)
-        {
-            motors_setSpeed(600);
-        }
-    }
-    else if (strcmp(restUrl, "start100") == 0)
-    {
-        if (querry_type == HTTP_QUERRY_TYPE_POST)
-        {
-            motors_setSpeed(1000);
-        }
-        else if (querry_type == HTTP_QUERRY_TYPE_GET)
-        {
-            motors_setSpeed(1000);
-        }
-    }
-    else
+    id++;
+    json_open_object(&json);
+    json_add_field_int(&json, "batteryLevel", id);
+    json_close_object(&json);
+}
+
+void rest_tof(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    JsonBuffer json;
+    write_header_json(buffer);
+    json_init(&json, buffer+strlen(buffer), 100, JSON_MONOBLOC);
+
+    json_open_object(&json);
+    json_add_field_int(&json, "tof1", VL6180X_getDistance(board_i2c_tof(), TOF1_ADDR));
+    json_add_field_int(&json, "tof2", VL6180X_getDistance(board_i2c_tof(), TOF2_ADDR));
+    json_add_field_int(&json, "tof3", VL6180X_getDistance(board_i2c_tof(), TOF3_ADDR));
+    json_close_object(&json);
+}
+
+// start60 and start100 for older clients
+void rest_start(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    int32_t speed;
+
+    if (rest_param_int(params, "speed", &speed) < 0 || speed < 0 || speed > 100)
     {
-        http_write_header_code(buffer, HTTP_NOT_FOUND);
+        http_write_header_code(buffer, HTTP_BAD_REQUEST);
         http_write_header_end(buffer);
+        return;
     }
+    motors_setSpeed(speed * 10);
+    http_write_header_code(buffer, HTTP_OK);
+    http_write_header_end(buffer);
+}
+
+void rest_start60(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    motors_setSpeed(600);
+    write_header_json(buffer);
+}
+
+void rest_start100(const RestParams *params, HTTP_QUERRY_TYPE method, char *buffer)
+{
+    motors_setSpeed(1000);
+    write_header_json(buffer);
+}
+
+const RestRoute rest_api_routes[] = {
+    {HTTP_QUERRY_TYPE_GET, "status", rest_status},
+    {HTTP_QUERRY_TYPE_GET, "tof", rest_tof},
+    {HTTP_QUERRY_TYPE_GET, "start60", rest_start60},
+    {HTTP_QUERRY_TYPE_POST, "start60", rest_start60},
+    {HTTP_QUERRY_TYPE_GET, "start100", rest_start100},
+    {HTTP_QUERRY_TYPE_POST, "start100", rest_start100},
+    {HTTP_QUERRY_TYPE_POST, "start/{speed}", rest_start}
+};
+
+void rest_api_init()
+{
+    rest_init();
+    rest_addRoutes(rest_api_routes, sizeof(rest_api_routes) / sizeof(rest_api_routes[0]));
+    web_server_setRestApi(rest_exec);
 }
@@ -0,0 +1,147 @@
+/**
+ * @file assetpack.h
+ * @author Sebastien CAUX (sebcaux)
+ * @copyright UniSwarm 2018
+ *
+ * @brief Binary asset pack writer shared by img2raw and htmlGen
+ * The layout is described in support/module/assets/assets.h
+ */
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QString>
+
+#include <algorithm>
+
+class AssetPack
+{
+public:
+    enum Type
+    {
+        TypeRaw = 0,
+        TypePicture = 1,
+        TypeFile = 2
+    };
+
+    static const quint32 Magic = 0x414B4455;  // "UDKA"
+    static const int Version = 1;
+    static const int NameSize = 32;
+    static const int HeaderSize = 16;
+    static const int EntrySize = 48;
+
+    explicit AssetPack(int align = 16)
+        : _align(align)
+    {
+    }
+
+    /**
+     * @brief add appends an asset, its blob is the metadata followed by the
+     * payload
+     * @return false if the name is too long or already used
+     */
+    bool add(const QByteArray &name, int type, const QByteArray &meta, const QByteArray &payload, int flags = 0)
+    {
+        if (name.isEmpty() || name.size() >= NameSize)
+            return false;
+        foreach (const Entry &entry, _entries)
+        {
+            if (entry.name == name)
+                return false;
+        }
+        Entry entry;
+        entry.name = name;
+        entry.type = type;
+        entry.flags = flags;
+        entry.meta = meta;
+        entry.payload = payload;
+        _entries.append(entry);
+        return true;
+    }
+
+    /**
+     * @brief data whole pack, entries sorted by name in strcmp order for the
+     * binary search of readers
+     */
+    QByteArray data() const
+    {
+        QList<Entry> entries = _entries;
+        std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b)
+        {
+            return a.name < b.name;
+        });
+
+        QByteArray index, blobs;
+        quint32 offset = alignUp(HeaderSize + EntrySize * entries.size());
+        foreach (const Entry &entry, entries)
+        {
+            QByteArray name = entry.name;
+            name.append(QByteArray(NameSize - name.size(), '\0'));
+            index += name;
+            append32(index, offset + blobs.size());
+            append32(index, entry.payload.size());
+            append16(index, entry.type);
+            append16(index, entry.meta.size());
+            append16(index, entry.flags);
+            append16(index, 0);
+
+            blobs += entry.meta + entry.payload;
+            blobs.append(QByteArray(alignUp(blobs.size()) - blobs.size(), '\0'));
+        }
+
+        QByteArray pack;
+        append32(pack, Magic);
+        append16(pack, Version);
+        append16(pack, entries.size());
+        append32(pack, offset + blobs.size());
+        append16(pack, _align);
+        append16(pack, EntrySize);
+        pack += index;
+        pack.append(QByteArray(offset - pack.size(), '\0'));
+        pack += blobs;
+        return pack;
+    }
+
+    bool save(const QString &fileName) const
+    {
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return false;
+        return file.write(data()) >= 0;
+    }
+
+    // little endian helpers
+    static void append16(QByteArray &bytes, quint16 value)
+    {
+        bytes.append(char(value & 0xFF));
+        bytes.append(char(value >> 8));
+    }
+
+    static void append32(QByteArray &bytes, quint32 value)
+    {
+        append16(bytes, value & 0xFFFF);
+        append16(bytes, value >> 16);
+    }
+
+protected:
+    struct Entry
+    {
+        QByteArray name;
+        int type;
+        int flags;
+        QByteArray meta;
+        QByteArray payload;
+    };
+    QList<Entry> _entries;
+    int _align;
+
+    quint32 alignUp(quint32 value) const
+    {
+        return (value + _align - 1) / _align * _align;
+    }
+};
+
+#endif // ASSETPACK_H
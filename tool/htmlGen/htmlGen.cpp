@@ -16,6 +16,11 @@
 #include <QDir>
 #include <QMimeDatabase>
 #include <QMimeType>
+#include <QVector>
+
+#include <algorithm>
+
+#include "assetpack.h"
 
 QString typeFromExtension(const QString &file_name)
 {
@@ -23,7 +28,136 @@ QString typeFromExtension(const QString &file_name)
     return database.mimeTypeForFile(file_name).name();
 }
 
-void exportPathToStruct(const QString &path, const QString &outputFile)
+/**
+ * @brief crc32 IEEE 802.3 CRC of data, as needed by the gzip trailer
+ */
+quint32 crc32(const QByteArray &data)
+{
+    quint32 crc = 0xFFFFFFFF;
+    foreach (char c, data)
+    {
+        crc ^= (unsigned char)c;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief gzip compresses data in a gzip stream (RFC 1952) to be served with
+ * Content-Encoding: gzip. qCompress gives a zlib stream, its deflate data is
+ * wrapped in the gzip header and trailer
+ */
+QByteArray gzip(const QByteArray &data)
+{
+    // qCompress : 4 bytes of size, 2 bytes zlib header, deflate, 4 bytes adler32
+    QByteArray zlib = qCompress(data, 9);
+    QByteArray gz("\x1F\x8B\x08\x00\x00\x00\x00\x00\x02\xFF", 10);
+    gz += zlib.mid(6, zlib.size() - 10);
+    AssetPack::append32(gz, crc32(data));
+    AssetPack::append32(gz, data.size());
+    return gz;
+}
+
+/**
+ * @brief fsHash seeded hash of file names, must stay identical to fs_hash of
+ * the network module
+ */
+quint16 fsHash(const QByteArray &name, quint16 seed)
+{
+    quint16 hash = 0x9DC5 ^ seed;
+    foreach (char c, name)
+    {
+        hash = quint16((hash ^ (unsigned char)c) * 0x0193);
+        hash ^= hash >> 7;
+    }
+    return hash;
+}
+
+/**
+ * @brief perfectHash builds the minimal perfect hash index used by getFile,
+ * with hash and displace : names are split in buckets, biggest first, each
+ * bucket gets the first seed that places all its names in free slots
+ * @param seeds seed of each bucket
+ * @param slots file names in slot order
+ * @return false if no seed is found for a bucket
+ */
+bool perfectHash(const QStringList &files, QVector<quint16> &seeds, QStringList &slots)
+{
+    int count = files.size();
+    int bucketCount = (count + 1) / 2;
+    if (count == 0)
+        return false;
+
+    QVector<QStringList> buckets(bucketCount);
+    foreach (const QString &file, files)
+        buckets[fsHash(file.toUtf8(), 0) % bucketCount].append(file);
+
+    QVector<int> order;
+    for (int bucket = 0; bucket < bucketCount; bucket++)
+        order.append(bucket);
+    std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b)
+    {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    seeds = QVector<quint16>(bucketCount, 0);
+    QVector<QString> slotFiles(count);
+    foreach (int bucket, order)
+    {
+        if (buckets[bucket].isEmpty())
+            break;
+
+        bool placed = false;
+        for (int seed = 0; seed <= 0xFFFF && !placed; seed++)
+        {
+            QList<int> used;
+            foreach (const QString &file, buckets[bucket])
+            {
+                int slot = fsHash(file.toUtf8(), seed) % count;
+                if (!slotFiles[slot].isEmpty() || used.contains(slot))
+                    break;
+                used.append(slot);
+            }
+            if (used.size() != buckets[bucket].size())
+                continue;
+
+            for (int i = 0; i < used.size(); i++)
+                slotFiles[used[i]] = buckets[bucket][i];
+            seeds[bucket] = seed;
+            placed = true;
+        }
+        if (!placed)
+            return false;
+    }
+    slots = slotFiles.toList();
+    return true;
+}
+
+void writeArray(QTextStream &text, const QString &name, const QByteArray &data)
+{
+    text << "const char " << name << "[] = " << endl
+         << "{" << endl
+         << "    ";
+    for (int addr = 0; addr < data.size(); addr++)
+    {
+        QString hexdat = QString::number((unsigned char)data[addr], 16);
+        if (hexdat.size() < 2)
+            hexdat.prepend('0');
+        text << "0x" << hexdat;
+        if (addr + 1 < data.size())
+            text << ", ";
+        if ((addr + 1) % 10 == 0)
+            text << endl << "    ";
+    }
+    text << endl << "};" << endl;
+}
+
+/**
+ * @brief exportPathToStruct writes the files of path as Fs_File structs
+ * @param compress also stores a gzip variant of files when it is smaller
+ */
+void exportPathToStruct(const QString &path, const QString &outputFile, bool compress)
 {
     QDir dir(path);
 
@@ -76,33 +210,53 @@ void exportPathToStruct(const QString &path, const QString &outputFile)
              << "\";" << endl;
         text << "const char " << filewodot << "_type[] = \""
              << typeFromExtension(file) << "\";" << endl;
-        text << "const char " << filewodot << "_data[] = " << endl
-             << "{" << endl
-             << "    ";
-        unsigned int addr = 0;
-        while (filebin.bytesAvailable() > 0)
+        QByteArray data = filebin.readAll();
+        writeArray(text, filewodot + "_data", data);
+
+        // entity tag, CRC of the content, shared by the gzip variant
+        QString etag = QString("\"\\\"%1\\\"\"").arg(crc32(data), 8, 16, QChar('0'));
+
+        QByteArray gz;
+        if (compress && !data.isEmpty())
+            gz = gzip(data);
+        if (!gz.isEmpty() && gz.size() < data.size())
         {
-            char data;
-            QString hexdat;
-            filebin.getChar(&data);
-            addr++;
-
-            hexdat = QString::number((unsigned char)data, 16);
-            if (hexdat.size() < 2)
-                hexdat.prepend('0');
-            text << "0x" << hexdat;
-            if (filebin.bytesAvailable() > 0)
-                text << ", ";
-            if (addr % 10 == 0)
-                text << endl << "    ";
+            writeArray(text, filewodot + "_gzip", gz);
+            text << "const Fs_File " << filewodot << " = {" << filewodot << "_name, "
+                 << filewodot << "_type, " << filewodot << "_data, " << data.size()
+                 << ", FS_FILE_GZIP, " << filewodot << "_gzip, " << gz.size()
+                 << ", " << etag << "};";
         }
-        text << endl << "};" << endl;
-        text << "const Fs_File " << filewodot << " = {" << filewodot << "_name, "
-             << filewodot << "_type, " << filewodot << "_data, " << addr << "};"
-             << endl
+        else
+        {
+            text << "const Fs_File " << filewodot << " = {" << filewodot << "_name, "
+                 << filewodot << "_type, " << filewodot << "_data, " << data.size()
+                 << ", 0, 0, 0, " << etag << "};";
+        }
+        text << endl
              << endl;
     }
 
+    // files in slot order of the perfect hash, in name order without index
+    QVector<quint16> seeds;
+    QStringList slots;
+    bool hashed = perfectHash(files, seeds, slots);
+    if (hashed)
+    {
+        text << "// ======== Perfect hash index ======== " << endl;
+        text << "const uint16_t files_hash[] = {" << endl;
+        for (int bucket = 0; bucket < seeds.size(); bucket++)
+        {
+            text << seeds[bucket];
+            if (bucket + 1 < seeds.size())
+                text << ", ";
+            if ((bucket + 1) % 16 == 0)
+                text << endl;
+        }
+        text << "};" << endl;
+        files = slots;
+    }
+
     text << "// ======== List of files ======== " << endl;
     text << "const Fs_File *files_ptr[] = {" << endl;
     int size = 0;
@@ -117,12 +271,45 @@ void exportPathToStruct(const QString &path, const QString &outputFile)
     }
     text << "};" << endl;
 
-    text << "const Fs_FilesList file_list = {files_ptr, " << files.count() << "};"
-         << endl;
+    if (hashed)
+        text << "const Fs_FilesList file_list = {files_ptr, " << files.count()
+             << ", files_hash, " << seeds.size() << "};" << endl;
+    else
+        text << "const Fs_FilesList file_list = {files_ptr, " << files.count()
+             << ", 0, 0};" << endl;
 
     output.close();
 }
 
+/**
+ * @brief exportPathToPack writes the files of path into a binary asset pack,
+ * the metadata of each file is its NUL terminated mime type
+ */
+bool exportPathToPack(const QString &path, const QString &packFile)
+{
+    QTextStream out(stdout);
+    QDir dir(path);
+    AssetPack pack;
+
+    foreach (QString file, dir.entryList(QDir::Files))
+    {
+        QFile filebin(dir.filePath(file));
+        if (!filebin.open(QIODevice::ReadOnly))
+        {
+            out << "Cannot read " << file << "." << endl;
+            return false;
+        }
+        QByteArray type = typeFromExtension(file).toUtf8();
+        type.append('\0');
+        if (!pack.add(file.toUtf8(), AssetPack::TypeFile, type, filebin.readAll()))
+        {
+            out << "File name " << file << " too long for the asset pack." << endl;
+            return false;
+        }
+    }
+    return pack.save(packFile);
+}
+
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
@@ -142,6 +329,12 @@ files into file struct system for web server");
     QCommandLineOption outputOption(QStringList() << "o" << "output",
         "Write generated data into <file>.", "html_data.c");
     parser.addOption(outputOption);
+    QCommandLineOption packOption(QStringList() << "p" << "pack",
+        "Also write the files into the binary asset pack <file>.", "file");
+    parser.addOption(packOption);
+    QCommandLineOption gzipOption(QStringList() << "z" << "gzip",
+        "Also store gzip variants of files, served to clients accepting them.");
+    parser.addOption(gzipOption);
 
     parser.process(app);
     
@@ -161,7 +354,12 @@ files into file struct system for web server");
     }
     QString outputFile = parser.value(outputOption);
 
-    exportPathToStruct(inputPath, outputFile);
+    exportPathToStruct(inputPath, outputFile, parser.isSet(gzipOption));
+    if (parser.isSet(packOption) && !exportPathToPack(inputPath, parser.value(packOption)))
+    {
+        out << "Cannot write asset pack " << parser.value(packOption) << "." << endl;
+        return 1;
+    }
 
     return 0;
 }
@@ -11,3 +11,6 @@ TARGET = htmlGen
 TEMPLATE = app
 
 SOURCES += htmlGen.cpp
+HEADERS += ../common/assetpack.h
+
+INCLUDEPATH += ../common
@@ -17,7 +17,20 @@
 #include <QTextStream>
 #include <QDebug>
 
+#include <QCryptographicHash>
+#include <QThreadPool>
+#include <QtConcurrent>
+
 #include <QImage>
+#include <QVector>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+
+#include <algorithm>
+#include <climits>
+
+#include "assetpack.h"
 
 #include <QFont>
 #include <QFontDatabase>
@@ -25,12 +38,484 @@
 #include <QPainter>
 #include <QRegExp>
 
+/**
+ * @brief pixels565 convert an image to RGB565 pixels in column order (x major,
+ * y minor), the order expected by screen controllers
+ */
+QVector<quint16> pixels565(const QImage &image)
+{
+    QVector<quint16> pixels;
+    pixels.reserve(image.width() * image.height());
+
+    for (int x = 0; x < image.width(); ++x)
+    {
+        for (int y = 0; y < image.height(); ++y)
+        {
+            QRgb color = image.pixel(x, y);
+
+            quint16 syscolor = 0;
+            syscolor |= (qRed(color) & 0xF8) << 8;
+            syscolor |= (qGreen(color) & 0xFC) << 3;
+            syscolor |= (qBlue(color) & 0xF8) >> 3;
+            pixels.append(syscolor);
+        }
+    }
+    return pixels;
+}
+
+/**
+ * @brief encodeRle565 run length encoding of pixels, see PictureFormatRle565
+ * in "gui/picture.h"
+ */
+QVector<quint16> encodeRle565(const QVector<quint16> &pixels)
+{
+    const int maxCount = 0x8000;
+    QVector<quint16> words;
+    int i = 0;
+
+    while (i < pixels.size())
+    {
+        // length of run starting at i
+        int run = 1;
+        while (i + run < pixels.size() && run < maxCount && pixels[i + run] == pixels[i])
+            run++;
+
+        if (run >= 3)
+        {
+            words.append(0x8000 | (run - 1));
+            words.append(pixels[i]);
+            i += run;
+            continue;
+        }
+
+        // literal until the next run of 3 identical pixels
+        int start = i;
+        while (i < pixels.size() && i - start < maxCount)
+        {
+            if (i + 2 < pixels.size() && pixels[i] == pixels[i + 1] && pixels[i] == pixels[i + 2])
+                break;
+            i++;
+        }
+        words.append(i - start - 1);
+        for (int j = start; j < i; j++)
+            words.append(pixels[j]);
+    }
+    return words;
+}
+
+/**
+ * @brief encodeQoi565 QOI like encoding of pixels, see PictureFormatQoi565
+ * in "gui/picture.h"
+ */
+QByteArray encodeQoi565(const QVector<quint16> &pixels)
+{
+    QByteArray bytes;
+    quint16 index[64] = {0};
+    quint16 prev = 0;
+    int run = 0;
+
+    for (int i = 0; i < pixels.size(); i++)
+    {
+        quint16 px = pixels[i];
+
+        if (px == prev)
+        {
+            run++;
+            if (run == 62 || i == pixels.size() - 1)
+            {
+                bytes.append(char(0xC0 | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0)
+        {
+            bytes.append(char(0xC0 | (run - 1)));
+            run = 0;
+        }
+
+        int hash = ((px >> 11) * 3 + ((px >> 5) & 0x3F) * 5 + (px & 0x1F) * 7) & 0x3F;
+        if (index[hash] == px)
+            bytes.append(char(hash));
+        else
+        {
+            index[hash] = px;
+
+            // component deltas wrapped to the component range
+            int dr = (((px >> 11) - (prev >> 11) + 16) & 0x1F) - 16;
+            int dg = ((((px >> 5) & 0x3F) - ((prev >> 5) & 0x3F) + 32) & 0x3F) - 32;
+            int db = (((px & 0x1F) - (prev & 0x1F) + 16) & 0x1F) - 16;
+            int dr_dg = ((dr - dg + 16) & 0x1F) - 16;
+            int db_dg = ((db - dg + 16) & 0x1F) - 16;
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+                bytes.append(char(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+            else if (dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+            {
+                bytes.append(char(0x80 | (dg + 32)));
+                bytes.append(char(((dr_dg + 8) << 4) | (db_dg + 8)));
+            }
+            else
+            {
+                bytes.append(char(0xFE));
+                bytes.append(char(px >> 8));
+                bytes.append(char(px & 0xFF));
+            }
+        }
+        prev = px;
+    }
+    return bytes;
+}
+
+/**
+ * @brief opaquePixels opacity of pixels in column order, pixels with an alpha
+ * lower than 128 are transparent
+ */
+QVector<bool> opaquePixels(const QImage &image)
+{
+    QVector<bool> opaque;
+    opaque.reserve(image.width() * image.height());
+
+    for (int x = 0; x < image.width(); ++x)
+        for (int y = 0; y < image.height(); ++y)
+            opaque.append(qAlpha(image.pixel(x, y)) >= 128);
+    return opaque;
+}
+
+/**
+ * @brief encodeMask pack the opacity of pixels with one bit per pixel, see
+ * PictureTransparencyMask in "gui/picture.h"
+ */
+QByteArray encodeMask(const QVector<bool> &opaque)
+{
+    QByteArray bytes((opaque.size() + 7) / 8, 0);
+    for (int i = 0; i < opaque.size(); i++)
+        if (opaque[i])
+            bytes[i / 8] = bytes[i / 8] | (1 << (i % 8));
+    return bytes;
+}
+
+/**
+ * @brief quantize565 median cut quantisation of pixels to at most maxColors
+ * colors, colors are kept exact if there is enough palette entries
+ */
+QVector<quint16> quantize565(const QVector<quint16> &pixels, int maxColors)
+{
+    QMap<quint16, int> histogram;
+    foreach (quint16 pixel, pixels)
+        histogram[pixel]++;
+
+    if (histogram.size() <= maxColors)
+        return histogram.keys().toVector();
+
+    // components scaled to 8 bits
+    auto component = [](quint16 color, int c) -> int
+    {
+        if (c == 0)
+            return (color >> 8) & 0xF8;
+        if (c == 1)
+            return (color >> 3) & 0xFC;
+        return (color << 3) & 0xF8;
+    };
+
+    QList<QVector<quint16> > boxes;
+    boxes << histogram.keys().toVector();
+    while (boxes.size() < maxColors)
+    {
+        // box with the widest component range
+        int bestBox = -1, bestComponent = 0, bestRange = 0;
+        for (int i = 0; i < boxes.size(); i++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                int min = 255, max = 0;
+                foreach (quint16 color, boxes[i])
+                {
+                    min = qMin(min, component(color, c));
+                    max = qMax(max, component(color, c));
+                }
+                if (max - min > bestRange)
+                {
+                    bestRange = max - min;
+                    bestBox = i;
+                    bestComponent = c;
+                }
+            }
+        }
+        if (bestBox == -1)
+            break;
+
+        // split it at the weighted median
+        QVector<quint16> box = boxes.takeAt(bestBox);
+        std::sort(box.begin(), box.end(), [&](quint16 a, quint16 b)
+        {
+            return component(a, bestComponent) < component(b, bestComponent);
+        });
+        int total = 0, sum = 0, split = 1;
+        foreach (quint16 color, box)
+            total += histogram[color];
+        for (int i = 0; i < box.size() - 1; i++)
+        {
+            sum += histogram[box[i]];
+            split = i + 1;
+            if (sum * 2 >= total)
+                break;
+        }
+        boxes << box.mid(0, split) << box.mid(split);
+    }
+
+    // palette entries are the weighted mean of boxes
+    QVector<quint16> palette;
+    foreach (const QVector<quint16> &box, boxes)
+    {
+        qint64 r = 0, g = 0, b = 0, count = 0;
+        foreach (quint16 color, box)
+        {
+            int weight = histogram[color];
+            r += component(color, 0) * weight;
+            g += component(color, 1) * weight;
+            b += component(color, 2) * weight;
+            count += weight;
+        }
+        palette.append(((r / count) & 0xF8) << 8 | ((g / count) & 0xFC) << 3 | ((b / count) & 0xF8) >> 3);
+    }
+    return palette;
+}
+
+/**
+ * @brief encodeIndexed pack palette indexes of pixels with bpp bits per pixel,
+ * see PictureFormatIndexed* in "gui/picture.h"
+ * @param keyIndex palette entry of the transparency key color, only used by
+ * pixels of this exact color, -1 if none
+ */
+QByteArray encodeIndexed(const QVector<quint16> &pixels, const QVector<quint16> &palette, int bpp, int keyIndex = -1)
+{
+    QHash<quint16, int> indexes;
+    QByteArray bytes;
+    quint8 byte = 0;
+    int bit = 0;
+
+    foreach (quint16 pixel, pixels)
+    {
+        // nearest palette color
+        if (!indexes.contains(pixel))
+        {
+            int best = 0, bestDist = INT_MAX;
+            for (int i = 0; i < palette.size(); i++)
+            {
+                if (i == keyIndex && pixel != palette[i])
+                    continue;
+                int dr = ((pixel >> 11) - (palette[i] >> 11)) * 2;
+                int dg = ((pixel >> 5) & 0x3F) - ((palette[i] >> 5) & 0x3F);
+                int db = ((pixel & 0x1F) - (palette[i] & 0x1F)) * 2;
+                int dist = dr * dr + dg * dg + db * db;
+                if (dist < bestDist)
+                {
+                    bestDist = dist;
+                    best = i;
+                }
+            }
+            indexes.insert(pixel, best);
+        }
+
+        byte |= indexes[pixel] << bit;
+        bit += bpp;
+        if (bit == 8)
+        {
+            bytes.append(char(byte));
+            byte = 0;
+            bit = 0;
+        }
+    }
+    if (bit != 0)
+        bytes.append(char(byte));
+    return bytes;
+}
+
+/**
+ * @brief EncodedImage an image converted to one of the Picture formats
+ */
+struct EncodedImage
+{
+    int width;
+    int height;
+    QString format;             // raw, rle, qoi or index
+    int bpp;                    // index format depth
+    QVector<quint16> pixels;    // raw
+    QVector<quint16> rle;
+    QByteArray qoi;
+    QVector<quint16> palette;   // index
+    QByteArray indexed;
+    QString transparency;       // none, key or mask
+    quint16 key;
+    QByteArray mask;
+};
+
+/**
+ * @brief encodeImage convert an image to one of the Picture formats
+ * @param format one of "raw", "rle", "qoi", "index" or "auto" to keep the
+ * smallest lossless one
+ * @param bpp bits per pixel of "index" format (1, 2, 4 or 8), 0 for the
+ * smallest depth able to store all colors
+ * @param transparency one of "none", "key" (transparent pixels replaced by
+ * the key color) or "mask" (one bit per pixel opacity mask)
+ */
+EncodedImage encodeImage(const QImage &image, const QString &format, int bpp, const QString &transparency, quint16 key)
+{
+    EncodedImage encoded;
+    encoded.width = image.width();
+    encoded.height = image.height();
+    encoded.transparency = transparency;
+    encoded.key = key;
+
+    QVector<quint16> &pixels = encoded.pixels;
+    QVector<quint16> &rle = encoded.rle;
+    QByteArray &qoi = encoded.qoi;
+    QVector<quint16> &palette = encoded.palette;
+    QByteArray &indexed = encoded.indexed;
+    QString &pictureFormat = encoded.format;
+
+    pixels = pixels565(image.mirrored(false, false));
+    QVector<bool> opaque = opaquePixels(image);
+    bool hasKey = false;
+    pictureFormat = format;
+
+    if (transparency == "key")
+    {
+        // opaque pixels of the key color get their lowest green bit flipped
+        for (int i = 0; i < pixels.size(); i++)
+        {
+            if (!opaque[i])
+            {
+                pixels[i] = key;
+                hasKey = true;
+            }
+            else if (pixels[i] == key)
+                pixels[i] = key ^ 0x0020;
+        }
+    }
+
+    if (format == "rle" || format == "auto")
+        rle = encodeRle565(pixels);
+    if (format == "qoi" || format == "auto")
+        qoi = encodeQoi565(pixels);
+    if (format == "index" || format == "auto")
+    {
+        if (hasKey)
+        {
+            // key color kept exact in its own palette entry
+            QVector<quint16> opaqueColors;
+            foreach (quint16 pixel, pixels)
+                if (pixel != key)
+                    opaqueColors.append(pixel);
+            palette = quantize565(opaqueColors, ((bpp == 0) ? 256 : (1 << bpp)) - 1);
+            for (int i = 0; i < palette.size(); i++)
+                if (palette[i] == key)
+                    palette[i] = key ^ 0x0020;
+            palette.append(key);
+        }
+        else
+            palette = quantize565(pixels, (bpp == 0) ? 256 : (1 << bpp));
+        if (bpp == 0)
+        {
+            bpp = 1;
+            while ((1 << bpp) < palette.size())
+                bpp *= 2;
+        }
+        while (palette.size() < (1 << bpp))
+            palette.append(0);
+        indexed = encodeIndexed(pixels, palette, bpp, hasKey ? palette.indexOf(key) : -1);
+    }
+    if (format == "auto")
+    {
+        pictureFormat = "raw";
+        int size = pixels.size() * 2;
+        if (rle.size() * 2 < size)
+        {
+            pictureFormat = "rle";
+            size = rle.size() * 2;
+        }
+        if (qoi.size() < size)
+        {
+            pictureFormat = "qoi";
+            size = qoi.size();
+        }
+        // lossless only if all colors fit in 256 entries
+        int colorCount = QSet<quint16>::fromList(pixels.toList()).size();
+        if (colorCount <= 256 && indexed.size() + palette.size() * 2 < size)
+            pictureFormat = "index";
+    }
+
+    if (transparency == "mask")
+        encoded.mask = encodeMask(opaque);
+    encoded.bpp = bpp;
+    return encoded;
+}
+
+/**
+ * @brief packImage add an encoded image to an asset pack, metadata is an
+ * AssetsPicture struct and payload the picture data followed by the palette
+ * and the mask, see "assets.h"
+ */
+bool packImage(AssetPack &pack, const QString &name, const EncodedImage &encoded)
+{
+    QByteArray payload;
+    if (encoded.format == "qoi")
+        payload = encoded.qoi;
+    else if (encoded.format == "index")
+        payload = encoded.indexed;
+    else
+    {
+        foreach (quint16 word, (encoded.format == "rle") ? encoded.rle : encoded.pixels)
+            AssetPack::append16(payload, word);
+    }
+    if (payload.size() % 2 != 0)
+        payload.append('\0');
+
+    quint32 paletteOffset = 0, maskOffset = 0;
+    if (encoded.format == "index")
+    {
+        paletteOffset = payload.size();
+        foreach (quint16 color, encoded.palette)
+            AssetPack::append16(payload, color);
+    }
+    if (encoded.transparency == "mask")
+    {
+        maskOffset = payload.size();
+        payload += encoded.mask;
+    }
+
+    int format = 0; // PictureFormatRaw565
+    if (encoded.format == "rle")
+        format = 1;
+    else if (encoded.format == "qoi")
+        format = 2;
+    else if (encoded.format == "index")
+        format = 3 + ((encoded.bpp == 1) ? 0 : (encoded.bpp == 2) ? 1 : (encoded.bpp == 4) ? 2 : 3);
+    int transparency = 0; // PictureTransparencyNone
+    if (encoded.transparency == "key")
+        transparency = 1;
+    else if (encoded.transparency == "mask")
+        transparency = 2;
+
+    QByteArray meta;
+    AssetPack::append16(meta, encoded.width);
+    AssetPack::append16(meta, encoded.height);
+    meta.append(char(format));
+    meta.append(char(transparency));
+    AssetPack::append16(meta, encoded.key);
+    AssetPack::append32(meta, paletteOffset);
+    AssetPack::append32(meta, maskOffset);
+
+    return pack.add(name.toUtf8(), AssetPack::TypePicture, meta, payload);
+}
+
 /**
  * @brief exportImage convert an image to a structure containing metadata and
  * data
- * To read the arguments list of the Picture struc, see "/module/gui.gui.h"
+ * To read the arguments list of the Picture struc, see "gui/picture.h"
  */
-void exportImage(const QImage &image, const QString &filename)
+void exportImage(const EncodedImage &encoded, const QString &filename)
 {
     QFileInfo finfo(filename);
     QFile file(filename);
@@ -38,39 +523,117 @@ void exportImage(const QImage &image, const QString &filename)
 
     QTextStream stream(&file);
 
+    const QVector<quint16> &pixels = encoded.pixels;
+    const QVector<quint16> &rle = encoded.rle;
+    const QByteArray &qoi = encoded.qoi;
+    const QVector<quint16> &palette = encoded.palette;
+    const QByteArray &indexed = encoded.indexed;
+    const QString &pictureFormat = encoded.format;
+    const QString &transparency = encoded.transparency;
+    int bpp = encoded.bpp;
+    quint16 key = encoded.key;
+
     // starting preprocessor instructions
     stream << "#include <gui/picture.h>" << endl;
     stream << endl;
 
     // creating an array containnig the image data
-    stream << "// an array containnig the image data" << endl;
-    stream << "__prog__ const uint16_t " << finfo.baseName()
-           << "_data[] __space_prog__ = {";
-
-    QImage mirrored = image.mirrored(false, false);
+    stream << "// an array containnig the image data (" << pictureFormat << ")" << endl;
+    if (pictureFormat == "qoi" || pictureFormat == "index")
+    {
+        const QByteArray &bytes = (pictureFormat == "qoi") ? qoi : indexed;
+        stream << "__prog__ const uint8_t " << finfo.baseName()
+               << "_data[] __space_prog__ = {";
+        for (int i = 0; i < bytes.size(); ++i)
+        {
+            if (i % 16 == 0)
+                stream << endl;
+            stream << "0x" << QString::number((quint8)bytes[i], 16);
+            if (i != bytes.size() - 1)
+                stream << ", ";
+        }
+    }
+    else if (pictureFormat == "rle")
+    {
+        stream << "__prog__ const uint16_t " << finfo.baseName()
+               << "_data[] __space_prog__ = {";
+        for (int i = 0; i < rle.size(); ++i)
+        {
+            if (i % 16 == 0)
+                stream << endl;
+            stream << "0x" << QString::number(rle[i], 16);
+            if (i != rle.size() - 1)
+                stream << ", ";
+        }
+    }
+    else
+    {
+        stream << "__prog__ const uint16_t " << finfo.baseName()
+               << "_data[] __space_prog__ = {";
+        for (int i = 0; i < pixels.size(); ++i)
+        {
+            if (i % encoded.height == 0)
+                stream << endl;
+            stream << "0x" << QString::number(pixels[i], 16);
+            if (i != pixels.size() - 1)
+                stream << ", ";
+        }
+    }
+    stream << endl << "};\n" << endl;
 
-    for (int x = 0; x < mirrored.width(); ++x)
+    if (pictureFormat == "index")
     {
-        stream << endl;
-        for (int y = 0; y < mirrored.height(); ++y)
+        stream << "// palette of colors" << endl;
+        stream << "__prog__ const uint16_t " << finfo.baseName()
+               << "_palette[] __space_prog__ = {";
+        for (int i = 0; i < palette.size(); ++i)
         {
-            QRgb color = mirrored.pixel(x, y);
+            if (i % 16 == 0)
+                stream << endl;
+            stream << "0x" << QString::number(palette[i], 16);
+            if (i != palette.size() - 1)
+                stream << ", ";
+        }
+        stream << endl << "};\n" << endl;
+    }
 
-            unsigned short syscolor = 0;
-            syscolor |= (qRed(color) & 0xF8) << 8;
-            syscolor |= (qGreen(color) & 0xFC) << 3;
-            syscolor |= (qBlue(color) & 0xF8) >> 3;
-            stream << "0x" << QString::number(syscolor, 16);
-            if (x != mirrored.width() - 1 || y != mirrored.height() - 1)
+    if (transparency == "mask")
+    {
+        const QByteArray &mask = encoded.mask;
+        stream << "// opacity mask, one bit per pixel" << endl;
+        stream << "__prog__ const uint8_t " << finfo.baseName()
+               << "_mask[] __space_prog__ = {";
+        for (int i = 0; i < mask.size(); ++i)
+        {
+            if (i % 16 == 0)
+                stream << endl;
+            stream << "0x" << QString::number((quint8)mask[i], 16);
+            if (i != mask.size() - 1)
                 stream << ", ";
         }
+        stream << endl << "};\n" << endl;
     }
-    stream << endl << "};\n" << endl;
 
     // creating the Picture structure
-    stream << "// the image structure {width, height, data}" << endl;
-    stream << "const Picture " << finfo.baseName() << " = {" << image.width()
-           << ", " << image.height() << ", " << finfo.baseName() << "_data};";
+    stream << "// the image structure {width, height, data, format, palette, transparency, key, mask}" << endl;
+    stream << "const Picture " << finfo.baseName() << " = {" << encoded.width
+           << ", " << encoded.height << ", ";
+    if (pictureFormat == "qoi")
+        stream << "(__prog__ const uint16_t *)" << finfo.baseName() << "_data, PictureFormatQoi565";
+    else if (pictureFormat == "index")
+        stream << "(__prog__ const uint16_t *)" << finfo.baseName() << "_data, PictureFormatIndexed"
+               << bpp << ", " << finfo.baseName() << "_palette";
+    else if (pictureFormat == "rle")
+        stream << finfo.baseName() << "_data, PictureFormatRle565";
+    else
+        stream << finfo.baseName() << "_data, PictureFormatRaw565";
+    if (pictureFormat != "index" && transparency != "none")
+        stream << ", 0";
+    if (transparency == "key")
+        stream << ", PictureTransparencyKey, 0x" << QString::number(key, 16);
+    else if (transparency == "mask")
+        stream << ", PictureTransparencyMask, 0, " << finfo.baseName() << "_mask";
+    stream << "};";
 
     file.close();
 }
@@ -207,6 +770,220 @@ void exportFont(QFont font, QString outFileName)
     letters.save(outFileName + ".png");
 }
 
+/**
+ * @brief BatchJob one image of a directory batch
+ */
+struct BatchJob
+{
+    QString input;
+    QString output;
+    QString name;       // C symbol of the Picture
+    QByteArray hash;    // hash of the image content and export options
+    bool convert;       // false if unchanged since the last batch
+    bool ok;
+    QSize size;
+    EncodedImage encoded;   // kept for the asset pack
+};
+
+/**
+ * @brief writeIfChanged writes content to fileName only if it differs from the
+ * current content, files which do not change keep their date for make
+ */
+bool writeIfChanged(const QString &fileName, const QByteArray &content)
+{
+    QFile file(fileName);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        if (file.readAll() == content)
+            return true;
+        file.close();
+    }
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    file.write(content);
+    return true;
+}
+
+/**
+ * @brief exportDirectory converts every image of inputDir into
+ * outputDir/<image file>.c on all cores, then writes one header and one index
+ * of all the pictures (<indexName>.h and <indexName>_index.c).
+ * Images whose content and export options did not change since the last batch
+ * are skipped, their hashes are kept in outputDir/img2raw.manifest.
+ * @param jobs count of parallel conversions, 0 for one per core
+ * @param packFile binary asset pack of all the images, not written if empty
+ * @return 0 if all images were converted, 1 otherwise
+ */
+int exportDirectory(const QString &inputDir, const QString &outputDir, const QString &indexName, const QString &format,
+                    int bpp, const QString &transparency, quint16 key, int jobs, const QString &packFile)
+{
+    QTextStream out(stdout);
+    QDir input(inputDir);
+    QDir output(outputDir);
+    if (!input.exists())
+    {
+        out << "Directory " << inputDir << " does not exist." << endl;
+        return 1;
+    }
+    if (!output.exists() && !output.mkpath("."))
+    {
+        out << "Cannot create directory " << outputDir << "." << endl;
+        return 1;
+    }
+
+    // previous hashes
+    QHash<QString, QByteArray> manifest;
+    QString manifestName = output.filePath("img2raw.manifest");
+    QFile manifestFile(manifestName);
+    if (manifestFile.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        while (!manifestFile.atEnd())
+        {
+            QList<QByteArray> fields = manifestFile.readLine().trimmed().split(' ');
+            if (fields.size() == 2)
+                manifest.insert(QString::fromUtf8(fields[1]), fields[0]);
+        }
+        manifestFile.close();
+    }
+
+    // jobs list, sorted by name for stable outputs
+    QByteArray options = QString("%1 %2 %3 %4 %5").arg(QCoreApplication::applicationVersion(), format)
+                             .arg(bpp).arg(transparency).arg(key).toUtf8();
+    QStringList files = input.entryList(QStringList() << "*.jpg" << "*.jpeg" << "*.png" << "*.bmp",
+                                        QDir::Files, QDir::Name);
+    QVector<BatchJob> batch;
+    QSet<QString> names;
+    foreach (const QString &fileName, files)
+    {
+        BatchJob job;
+        job.input = input.filePath(fileName);
+        job.output = output.filePath(fileName + ".c");
+        job.name = QFileInfo(fileName).baseName();
+        if (names.contains(job.name))
+        {
+            out << "Picture name " << job.name << " of " << fileName << " already used." << endl;
+            return 1;
+        }
+        names.insert(job.name);
+
+        QFile file(job.input);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            out << "Cannot read " << job.input << "." << endl;
+            return 1;
+        }
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(options);
+        hash.addData(file.readAll());
+        job.hash = hash.result().toHex();
+        job.convert = (manifest.value(fileName) != job.hash || !QFile::exists(job.output));
+        job.ok = true;
+        batch.append(job);
+    }
+
+    // outputs of removed images
+    bool changed = false;
+    foreach (const QString &fileName, manifest.keys())
+    {
+        if (!files.contains(fileName))
+        {
+            QFile::remove(output.filePath(fileName + ".c"));
+            changed = true;
+        }
+    }
+
+    // the pack holds every image, all of them are encoded if it changes
+    foreach (const BatchJob &job, batch)
+        changed |= job.convert;
+    bool packing = !packFile.isEmpty() && (changed || !QFile::exists(packFile));
+
+    // parallel conversion
+    if (jobs > 0)
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    QtConcurrent::blockingMap(batch, [&](BatchJob &job)
+    {
+        if (!job.convert && !packing)
+            return;
+        QImage image(job.input);
+        job.size = image.size();
+        if (image.width() == 0 || image.height() == 0)
+        {
+            job.ok = false;
+            return;
+        }
+        EncodedImage encoded = encodeImage(image, format, bpp, transparency, key);
+        if (job.convert)
+            exportImage(encoded, job.output);
+        if (packing)
+            job.encoded = encoded;
+    });
+
+    // manifest, header, index and pack
+    AssetPack pack;
+    int converted = 0, failed = 0;
+    QByteArray manifestContent;
+    QString header, index, namesTable;
+    QString guard = indexName.toUpper() + "_H";
+    header += "#ifndef " + guard + "\n#define " + guard + "\n\n";
+    header += "#include <stdint.h>\n#include <gui/picture.h>\n\n";
+    index += "#include \"" + indexName + ".h\"\n\n";
+    index += "const Picture *const " + indexName + "[] = {\n";
+    namesTable += "const char *const " + indexName + "_names[] = {\n";
+    foreach (const BatchJob &job, batch)
+    {
+        QString fileName = QFileInfo(job.input).fileName();
+        if (!job.ok)
+        {
+            out << "Invalid image file format " << job.input << "." << endl;
+            QFile::remove(job.output);
+            failed++;
+            continue;
+        }
+        if (job.convert)
+        {
+            out << "Image " << fileName << " " << job.size.width() << " x " << job.size.height() << " px" << endl;
+            converted++;
+        }
+        if (packing && !packImage(pack, job.name, job.encoded))
+        {
+            out << "Picture name " << job.name << " too long for the asset pack." << endl;
+            failed++;
+            continue;
+        }
+        manifestContent += job.hash + " " + fileName.toUtf8() + "\n";
+        header += "extern const Picture " + job.name + ";\n";
+        index += "    &" + job.name + ",\n";
+        namesTable += "    \"" + job.name + "\",\n";
+    }
+    int count = batch.size() - failed;
+    header += "\n#define " + indexName.toUpper() + "_COUNT " + QString::number(count) + "\n";
+    header += "extern const Picture *const " + indexName + "[" + QString::number(qMax(count, 1)) + "];\n";
+    header += "extern const char *const " + indexName + "_names[" + QString::number(qMax(count, 1)) + "];\n";
+    header += "\n#endif // " + guard + "\n";
+    if (count == 0)
+    {
+        // C forbids empty initializers
+        index += "    0,\n";
+        namesTable += "    0,\n";
+    }
+    index += "};\n\n" + namesTable + "};\n";
+
+    if (!writeIfChanged(output.filePath(indexName + ".h"), header.toUtf8())
+        || !writeIfChanged(output.filePath(indexName + "_index.c"), index.toUtf8())
+        || !writeIfChanged(manifestName, manifestContent)
+        || (packing && !pack.save(packFile)))
+    {
+        out << "Cannot write in " << outputDir << "." << endl;
+        return 1;
+    }
+
+    out << converted << " converted, " << (count - converted) << " unchanged";
+    if (failed > 0)
+        out << ", " << failed << " failed";
+    out << endl;
+    return (failed > 0) ? 1 : 0;
+}
+
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
@@ -229,9 +1006,83 @@ int main(int argc, char *argv[])
                                     "Write generated data into <file>.",
                                     "image.c");
     parser.addOption(outputOption);
+    QCommandLineOption formatOption(QStringList() << "f"
+                                                  << "format",
+                                    "Picture data format (raw, rle, qoi, index or auto).",
+                                    "format", "raw");
+    parser.addOption(formatOption);
+    QCommandLineOption bppOption(QStringList() << "b"
+                                               << "bpp",
+                                 "Bits per pixel of index format (1, 2, 4 or 8), smallest lossless if not set.",
+                                 "bpp", "0");
+    parser.addOption(bppOption);
+    QCommandLineOption transparencyOption(QStringList() << "t"
+                                                        << "transparency",
+                                          "Transparency of pixels with alpha < 128 (none, key or mask).",
+                                          "transparency", "none");
+    parser.addOption(transparencyOption);
+    QCommandLineOption keyOption(QStringList() << "k"
+                                               << "key",
+                                 "RGB565 transparency key color in hexadecimal.",
+                                 "key", "f81f");
+    parser.addOption(keyOption);
+    QCommandLineOption dirOption(QStringList() << "d"
+                                               << "dir",
+                                 "Convert every image of <dir> in parallel, <output> is then a directory.",
+                                 "dir");
+    parser.addOption(dirOption);
+    QCommandLineOption jobsOption(QStringList() << "j"
+                                                << "jobs",
+                                  "Count of parallel conversions in directory mode, one per core if not set.",
+                                  "jobs", "0");
+    parser.addOption(jobsOption);
+    QCommandLineOption indexOption(QStringList() << "index",
+                                   "Name of the header and table of pictures written in directory mode.",
+                                   "name", "pictures");
+    parser.addOption(indexOption);
+    QCommandLineOption packOption(QStringList() << "p"
+                                                << "pack",
+                                  "Also write the pictures into the binary asset pack <file>.",
+                                  "file");
+    parser.addOption(packOption);
 
     parser.process(app);
 
+    // image options
+    QString format = parser.value(formatOption);
+    if (!QStringList({"raw", "rle", "qoi", "index", "auto"}).contains(format))
+    {
+        out << "Invalid picture format " << format << "." << endl;
+        return 1;
+    }
+    int bpp = parser.value(bppOption).toInt();
+    if (bpp != 0 && bpp != 1 && bpp != 2 && bpp != 4 && bpp != 8)
+    {
+        out << "Invalid bits per pixel " << bpp << "." << endl;
+        return 1;
+    }
+    QString transparency = parser.value(transparencyOption);
+    if (!QStringList({"none", "key", "mask"}).contains(transparency))
+    {
+        out << "Invalid transparency " << transparency << "." << endl;
+        return 1;
+    }
+    bool keyOk;
+    quint16 key = parser.value(keyOption).toUShort(&keyOk, 16);
+    if (!keyOk)
+    {
+        out << "Invalid key color " << parser.value(keyOption) << "." << endl;
+        return 1;
+    }
+
+    // directory mode
+    if (parser.isSet(dirOption))
+    {
+        QString outputDir = parser.isSet(outputOption) ? parser.value(outputOption) : QString(".");
+        return exportDirectory(parser.value(dirOption), outputDir, parser.value(indexOption), format, bpp,
+                               transparency, key, parser.value(jobsOption).toInt(), parser.value(packOption));
+    }
+
     /*QFontDatabase db;
     foreach(QString family, db.families())
         out << family << endl;*/
@@ -268,7 +1119,17 @@ int main(int argc, char *argv[])
             out << "Invalid image file format." << endl;
             return 1;
         }
-        exportImage(image, outputFile);
+        EncodedImage encoded = encodeImage(image, format, bpp, transparency, key);
+        exportImage(encoded, outputFile);
+        if (parser.isSet(packOption))
+        {
+            AssetPack pack;
+            if (!packImage(pack, QFileInfo(outputFile).baseName(), encoded) || !pack.save(parser.value(packOption)))
+            {
+                out << "Cannot write asset pack " << parser.value(packOption) << "." << endl;
+                return 1;
+            }
+        }
         out << "Image " << inputFile << " " << image.size().width() << " x "
             << image.size().height() << " px" << endl;
 
@@ -1,6 +1,6 @@
 QT += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 CONFIG += c++11
 
@@ -11,3 +11,6 @@ TARGET = img2raw
 TEMPLATE = app
 
 SOURCES += img2raw.cpp
+HEADERS += ../common/assetpack.h
+
+INCLUDEPATH += ../common